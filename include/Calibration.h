@@ -0,0 +1,58 @@
+/*
+  Calibration.h - frequency to motor position table.
+
+  Points are kept sorted by frequency; positions in between are linearly
+  interpolated. Frequencies outside the table are rejected rather than
+  extrapolated, so a bad table cannot drive the carriage past the range
+  it was measured over. The table is kept in NVS. It is set from the web
+  server task and read from the rigctl task, under a lock.
+*/
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+#ifndef CALIBRATION_MAX_POINTS
+#define CALIBRATION_MAX_POINTS 32
+#endif
+
+struct CalibrationPoint
+{
+  uint32_t freq; // Hz
+  int32_t position;
+};
+
+class Calibration
+{
+public:
+  Calibration();
+
+  /*
+   * Load the stored table. Returns false if there is none.
+   */
+  bool begin();
+  /*
+   * Replace the table and store it. Points need not be sorted; duplicate
+   * frequencies are rejected.
+   */
+  bool set(const CalibrationPoint *points, size_t count);
+  /*
+   * Copy the table, sorted, into points (CALIBRATION_MAX_POINTS long).
+   * Returns the number of points.
+   */
+  size_t get(CalibrationPoint *points);
+
+  /*
+   * Position for freq. Returns false if freq is outside the table.
+   */
+  bool position(uint32_t freq, long &position);
+
+private:
+  Preferences _prefs;
+  SemaphoreHandle_t _lock;
+  CalibrationPoint _points[CALIBRATION_MAX_POINTS];
+  size_t _count;
+};
+
+#endif // CALIBRATION_H
@@ -0,0 +1,86 @@
+/*
+  Commands.h - transport independent command dispatcher.
+
+  Each transport (HTTP, UDP, serial) decodes its own wire format into a
+  Command once and hands it to execute(), which validates it against the
+  endstop and the soft limits and runs it through Motion. The result and
+  the status snapshot are plain values the transport encodes back. Nothing
+  here touches the network, so the dispatcher runs on the host build too.
+*/
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include <Arduino.h>
+#include "Motion.h"
+
+// The values 1..5 double as the frame type of the binary protocols
+enum CommandType : uint8_t
+{
+  CMD_MOVE = 1,     // arg: steps relative to the current target
+  CMD_MOVE_TO = 2,  // arg: absolute target
+  CMD_VELOCITY = 3, // arg: steps/s, sign is direction, 0 brakes
+  CMD_STOP = 4,     // brake to a stop, CMD_FLAG_HARD stops at once
+  CMD_STATUS = 5,
+  CMD_STEP = 6,     // arg: steps, waits; the legacy /move, refused past max only
+  CMD_PROGRAM = 7,  // segments/count, waits for the whole program
+  CMD_PARK = 8      // creep toward the endstop until it triggers, waits
+};
+
+// Also the result byte of the binary protocols
+enum CommandResult : uint8_t
+{
+  CMD_OK = 0,
+  CMD_BUSY = 1,
+  CMD_OUT_OF_RANGE = 2,
+  CMD_ENDSTOP = 3,
+  CMD_STALE = 4, // set by transports that sequence commands
+  CMD_UNKNOWN = 5,
+  CMD_INVALID = 6,
+  CMD_MAX_POSITION = 7
+};
+
+#define CMD_FLAG_HARD 0x0001
+
+struct Command
+{
+  uint8_t type;   // CommandType
+  uint16_t flags;
+  int32_t arg;
+  short accel;    // 0 uses the default
+  short decel;
+  MotionSegment *segments; // CMD_PROGRAM, results are written back
+  size_t count;
+};
+
+struct CommandStatus
+{
+  uint8_t state; // Motion::State
+  int32_t position;
+  int32_t target;
+  uint8_t endstop;
+};
+
+class Commands
+{
+public:
+  Commands(Motion &motion, uint8_t endstopPin, short accel, short decel);
+
+  /*
+   * Validate and run cmd. Moves that wait return once the carriage stops.
+   * On CMD_OUT_OF_RANGE for a program, rejected() is the offending segment.
+   */
+  CommandResult execute(const Command &cmd);
+  void status(CommandStatus &status);
+  bool idle() { return _motion.state() == Motion::IDLE; }
+  size_t rejected() { return _motion.rejected(); }
+
+private:
+  CommandResult _result(Motion::Error err);
+
+  Motion &_motion;
+  uint8_t _endstopPin;
+  short _accel;
+  short _decel;
+};
+
+#endif // COMMANDS_H
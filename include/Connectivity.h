@@ -0,0 +1,108 @@
+/*
+  Connectivity.h - network supervisor with graded recovery.
+
+  The link is checked with a single ping every CONNECTIVITY_PROBE_INTERVAL,
+  and right away when WiFi reports a disconnect. Once a check fails the
+  supervisor escalates one step at a time, waiting with exponential
+  backoff between attempts:
+
+    PROBING         probe again, the gateway may just have missed one
+    RECONNECTING    ask the station to reassociate
+    REINITIALIZING  take WiFi down and bring it up from scratch
+    REBOOTING       flush every axis's position and restart
+
+  Nothing beyond a probe is done while the carriage moves; the attempt is
+  postponed until it is idle. Outage durations are kept for the mean time
+  to recover.
+*/
+#ifndef CONNECTIVITY_H
+#define CONNECTIVITY_H
+
+#include <Arduino.h>
+#include <IPAddress.h>
+#include <WiFi.h>
+#include "Motion.h"
+
+#ifndef CONNECTIVITY_PROBE_INTERVAL
+#define CONNECTIVITY_PROBE_INTERVAL 60000
+#endif
+
+#ifndef CONNECTIVITY_BACKOFF_MIN
+#define CONNECTIVITY_BACKOFF_MIN 2000
+#endif
+
+#ifndef CONNECTIVITY_BACKOFF_MAX
+#define CONNECTIVITY_BACKOFF_MAX 60000
+#endif
+
+// Failed attempts at each level before moving to the next one
+#ifndef CONNECTIVITY_PROBES
+#define CONNECTIVITY_PROBES 3
+#endif
+
+#ifndef CONNECTIVITY_RECONNECTS
+#define CONNECTIVITY_RECONNECTS 3
+#endif
+
+#ifndef CONNECTIVITY_REINITS
+#define CONNECTIVITY_REINITS 2
+#endif
+
+class Connectivity
+{
+public:
+  enum State
+  {
+    ONLINE,
+    PROBING,
+    RECONNECTING,
+    REINITIALIZING,
+    REBOOTING
+  };
+
+  Connectivity(Motion &motion, const IPAddress &probeHost);
+
+  /*
+   * Subscribe to WiFi events. ssid and pass are used to bring the
+   * station back up after a reinit and must stay valid.
+   */
+  void begin(const char *ssid, const char *pass);
+  /*
+   * Wait for the next check and act on it. Call forever from its task.
+   */
+  void loop();
+
+  State state() { return _state; }
+  uint32_t outages() { return _outages; }
+  /*
+   * Mean and last outage duration in ms, over recovered outages.
+   */
+  uint32_t meanTimeToRecover() { return _recoveries ? _downtime / _recoveries : 0; }
+  uint32_t lastOutage() { return _lastOutage; }
+
+  static const char *stateName(State state);
+
+private:
+  void _onEvent(arduino_event_id_t event);
+  bool _probe();
+  void _act();
+  void _recovered();
+
+  Motion &_motion;
+  IPAddress _host;
+  const char *_ssid;
+  const char *_pass;
+  SemaphoreHandle_t _wake;
+  volatile bool _linkDown;
+  volatile State _state;
+  uint8_t _attempts;
+  uint32_t _backoff;
+  uint32_t _due;
+  uint32_t _downSince;
+  uint32_t _outages;
+  uint32_t _recoveries;
+  uint64_t _downtime;
+  uint32_t _lastOutage;
+};
+
+#endif // CONNECTIVITY_H
@@ -0,0 +1,55 @@
+/*
+  ControlFrame.h - fixed-size binary frames shared by the UDP and serial
+  control channels.
+
+  All fields are little-endian. A client sends a ControlCommandFrame whose
+  type is a CommandType and gets a ControlStatusFrame back carrying the
+  same seq and a CommandResult. Only CMD_MOVE..CMD_STATUS are frame types;
+  anything else is answered with CMD_INVALID without running.
+*/
+#ifndef CONTROL_FRAME_H
+#define CONTROL_FRAME_H
+
+#include <stdint.h>
+#include "Commands.h"
+
+#define CONTROL_FRAME_MAGIC 0xCA
+
+enum ControlMessage : uint8_t
+{
+  CONTROL_MSG_REPLY = 0x81,
+  CONTROL_MSG_STATUS = 0x82
+};
+
+struct __attribute__((packed)) ControlCommandFrame
+{
+  uint8_t magic;
+  uint8_t type;   // CommandType
+  uint16_t flags; // CMD_FLAG_*
+  uint32_t seq;
+  int32_t arg;
+  uint16_t accel; // 0 uses the firmware default
+  uint16_t decel;
+};
+
+struct __attribute__((packed)) ControlStatusFrame
+{
+  uint8_t magic;
+  uint8_t type;   // ControlMessage
+  uint8_t result; // CommandResult, replies only
+  uint8_t state;  // Motion::State
+  uint32_t seq;   // seq of the command answered, 0 for status
+  int32_t position;
+  int32_t target;
+  uint8_t endstop;
+  uint8_t reserved[3];
+  uint32_t millis;
+};
+
+/*
+ * Decode a command frame for Commands::execute(). False, leaving cmd
+ * untouched, if the type is not a frame type or accel/decel do not fit.
+ */
+bool controlFrameCommand(const ControlCommandFrame &frame, Command &cmd);
+
+#endif // CONTROL_FRAME_H
@@ -0,0 +1,90 @@
+/*
+  EventStream.h - Server-Sent Events push of position and status.
+
+  A GET on the events route hands its connection over to EventStream,
+  which keeps it open after the WebServer has moved on and writes a
+  "status" event whenever the snapshot changed, at most rate times per
+  second. An unchanged snapshot is not resent; a comment line goes out
+  every EVENT_STREAM_HEARTBEAT_MS instead so proxies keep the connection
+  and dead peers are noticed. Events are only written when the peer's
+  send buffer takes them whole, so a slow reader misses intermediate
+  states instead of stalling the others, and is dropped once it has
+  taken nothing for EVENT_STREAM_STALL_MS.
+*/
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include "Motion.h"
+
+#ifndef EVENT_STREAM_CLIENTS
+#define EVENT_STREAM_CLIENTS 4
+#endif
+
+#ifndef EVENT_STREAM_DEFAULT_RATE
+#define EVENT_STREAM_DEFAULT_RATE 10
+#endif
+
+#ifndef EVENT_STREAM_MAX_RATE
+#define EVENT_STREAM_MAX_RATE 50
+#endif
+
+#ifndef EVENT_STREAM_HEARTBEAT_MS
+#define EVENT_STREAM_HEARTBEAT_MS 15000
+#endif
+
+#ifndef EVENT_STREAM_STALL_MS
+#define EVENT_STREAM_STALL_MS 5000
+#endif
+
+class EventStream
+{
+public:
+  EventStream(Motion &motion, uint8_t endstopPin);
+
+  void begin();
+  /*
+   * Take over an accepted request's connection and send the stream
+   * headers. rate is in events per second. Returns false when all
+   * slots are taken. Safe to call from the WebServer task.
+   */
+  bool add(WiFiClient client, uint8_t rate = EVENT_STREAM_DEFAULT_RATE);
+  uint8_t count();
+  /*
+   * Push due events and drop closed connections. Call often from the
+   * event task; it must not share the WebServer task, which blocks for
+   * the length of a /move or /moves program.
+   */
+  void loop();
+
+private:
+  struct Snapshot
+  {
+    long position;
+    long target;
+    uint8_t state;
+    uint8_t endstop;
+    uint8_t segment;
+    uint8_t segments;
+  };
+  struct Subscriber
+  {
+    WiFiClient client;
+    bool active;
+    uint16_t interval;
+    unsigned long lastSent;
+    unsigned long lastWrite;
+    Snapshot last;
+  };
+
+  void _snapshot(Snapshot &snap);
+  static const char *_stateName(uint8_t state);
+
+  Motion &_motion;
+  uint8_t _endstopPin;
+  SemaphoreHandle_t _lock;
+  Subscriber _subscribers[EVENT_STREAM_CLIENTS];
+};
+
+#endif // EVENT_STREAM_H
@@ -0,0 +1,106 @@
+/*
+  Inputs.h - debounced digital inputs delivered from interrupts to a task.
+
+  Each registered pin gets a CHANGE interrupt that only stamps the edge
+  with micros() and pushes it into a ring shared by all pins, then wakes
+  the input task. The pushes are serialized by a spinlock, as pin
+  interrupts can nest or run on another core; the task pops without one.
+  The task debounces on the leading edge: the first change is delivered
+  at once and later edges inside the debounce window are ignored. When
+  the window closes the pin is read again, so a level that settled
+  elsewhere is still reported; after the ring overflowed every pin is.
+  Nothing sleeps, so an input is never deaf to its first edge.
+
+  Subscribers are called from the input task in registration order.
+  The time from the interrupt to the first subscriber call is measured.
+*/
+#ifndef INPUTS_H
+#define INPUTS_H
+
+#include <Arduino.h>
+#include <atomic>
+
+#ifndef INPUTS_MAX
+#define INPUTS_MAX 4
+#endif
+
+#ifndef INPUTS_MAX_SUBSCRIBERS
+#define INPUTS_MAX_SUBSCRIBERS 8
+#endif
+
+// Ring capacity in edges, a power of two
+#ifndef INPUTS_RING_SIZE
+#define INPUTS_RING_SIZE 32
+#endif
+
+struct InputEvent
+{
+  uint8_t input;
+  uint8_t level;
+  uint32_t micros; // when the edge was seen, in the interrupt
+};
+
+typedef void (*InputCallback)(const InputEvent &event, void *context);
+
+class Inputs
+{
+public:
+  Inputs();
+
+  /*
+   * Register a pin, before begin(). Returns the input index, -1 when full.
+   */
+  int add(uint8_t pin, uint8_t mode, uint32_t debounceUs);
+  bool subscribe(int input, InputCallback callback, void *context = NULL);
+  /*
+   * Attach the interrupts; events go to the calling task from here on,
+   * so call it at the start of the input task.
+   */
+  void begin();
+  /*
+   * Wait for edges or a closing debounce window and dispatch.
+   * Call forever from the input task.
+   */
+  void loop();
+
+  uint8_t level(int input) { return _inputs[input].stable; }
+  uint32_t dropped() { return _dropped; }
+  uint32_t maxLatency() { return _maxLatency; }
+
+private:
+  struct Input
+  {
+    Inputs *owner;
+    uint8_t index;
+    uint8_t pin;
+    uint32_t debounce;
+    uint8_t stable;
+    bool settling;
+    uint32_t changed;
+  };
+  struct Subscriber
+  {
+    uint8_t input;
+    InputCallback callback;
+    void *context;
+  };
+
+  static void IRAM_ATTR _isr(void *arg);
+  bool _pop(InputEvent &event);
+  void _accept(Input &in, uint8_t level, uint32_t at);
+
+  Input _inputs[INPUTS_MAX];
+  uint8_t _count;
+  Subscriber _subscribers[INPUTS_MAX_SUBSCRIBERS];
+  uint8_t _subscriberCount;
+  InputEvent _ring[INPUTS_RING_SIZE];
+  std::atomic<uint16_t> _head; // written by the interrupts only, under _push
+  std::atomic<uint16_t> _tail; // written by the task only
+  portMUX_TYPE _push;
+  volatile uint32_t _dropped;
+  uint32_t _droppedSeen;
+  uint32_t _maxLatency;
+  TaskHandle_t _task;
+};
+
+#endif // INPUTS_H
@@ -0,0 +1,156 @@
+/*
+  Metrics.h - counters, gauges and histograms with Prometheus text output.
+
+  Metrics are global objects that link themselves into a registry when
+  constructed, so declaring one is all it takes to have it exported.
+  Updates are single 32-bit atomic operations and never allocate (a
+  histogram's 64-bit sum, not lock-free on RV32, is kept under a
+  spinlock); memory is fixed at compile time (labelled counters have a
+  fixed number of label slots, extra label values are folded into
+  "other").
+
+  Gauges are either set explicitly or read through a callback at scrape
+  time, which suits values like free heap that are cheaper to sample on
+  demand than to keep current.
+*/
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <atomic>
+
+#ifndef METRICS_MAX_LABELS
+#define METRICS_MAX_LABELS 12
+#endif
+
+#ifndef METRICS_LABEL_LEN
+#define METRICS_LABEL_LEN 24
+#endif
+
+class Metric
+{
+public:
+  Metric(const char *name, const char *help, const char *type);
+  virtual ~Metric() {}
+
+  /*
+   * Write every registered metric to out in Prometheus text format.
+   */
+  static void renderAll(Print &out);
+
+protected:
+  virtual void render(Print &out) = 0;
+  void header(Print &out);
+
+  const char *_name;
+  const char *_help;
+  const char *_type;
+
+private:
+  Metric *_next;
+  static Metric *_first;
+};
+
+class Counter : public Metric
+{
+public:
+  Counter(const char *name, const char *help) : Metric(name, help, "counter"), _value(0) {}
+  void inc(uint32_t n = 1) { _value.fetch_add(n, std::memory_order_relaxed); }
+  uint32_t value() { return _value.load(std::memory_order_relaxed); }
+
+protected:
+  void render(Print &out) override;
+
+private:
+  std::atomic<uint32_t> _value;
+};
+
+/*
+ * Counter with one label. Label values are copied on first use.
+ */
+class LabeledCounter : public Metric
+{
+public:
+  LabeledCounter(const char *name, const char *help, const char *label);
+  void inc(const char *value, uint32_t n = 1);
+
+protected:
+  void render(Print &out) override;
+
+private:
+  struct Slot
+  {
+    char value[METRICS_LABEL_LEN];
+    std::atomic<uint32_t> count;
+  };
+
+  const char *_label;
+  Slot _slots[METRICS_MAX_LABELS];
+  std::atomic<uint8_t> _used;
+  portMUX_TYPE _lock;
+};
+
+class Gauge : public Metric
+{
+public:
+  typedef double (*ReadFunction)();
+
+  Gauge(const char *name, const char *help, ReadFunction read = NULL)
+      : Metric(name, help, "gauge"), _value(0), _read(read) {}
+  void set(int32_t value) { _value.store(value, std::memory_order_relaxed); }
+  int32_t value() { return _value.load(std::memory_order_relaxed); }
+
+protected:
+  void render(Print &out) override;
+
+private:
+  std::atomic<int32_t> _value;
+  ReadFunction _read;
+};
+
+/*
+ * Gauge with one label whose values are produced at scrape time:
+ * the callback calls emit() once per label value.
+ */
+class LabeledGauge : public Metric
+{
+public:
+  typedef void (*CollectFunction)(LabeledGauge &gauge, Print &out);
+
+  LabeledGauge(const char *name, const char *help, const char *label, CollectFunction collect)
+      : Metric(name, help, "gauge"), _label(label), _collect(collect) {}
+  void emit(Print &out, const char *value, double reading);
+
+protected:
+  void render(Print &out) override;
+
+private:
+  const char *_label;
+  CollectFunction _collect;
+};
+
+/*
+ * Histogram over fixed, ascending bucket bounds. Observations above the
+ * last bound only land in +Inf.
+ */
+class Histogram : public Metric
+{
+public:
+  Histogram(const char *name, const char *help, const uint32_t *bounds, uint8_t count);
+  void observe(uint32_t value);
+
+protected:
+  void render(Print &out) override;
+
+private:
+  static const uint8_t MAX_BUCKETS = 16;
+
+  const uint32_t *_bounds;
+  uint8_t _count;
+  std::atomic<uint32_t> _buckets[MAX_BUCKETS + 1];
+  std::atomic<uint32_t> _observations;
+  uint64_t _sum;
+  portMUX_TYPE _lock; // for _sum
+};
+
+#endif // METRICS_H
@@ -0,0 +1,214 @@
+/*
+  Motion.h - motion programs executed by a dedicated task.
+
+  A program is a short list of segments, each an absolute target or an
+  offset from the previous target, with an optional dwell once the target
+  is reached. The whole program is resolved and checked against the soft
+  limits before the first step is made, then runs back to back with the
+  driver enabled throughout. If a move is cut short (endstop, stop()) the
+  rest of the program is skipped.
+
+  Up to MOTION_MAX_AXES axes can be configured, each with its own limits
+  and position store. A segment names the axes it moves; when it moves
+  more than axis 0 they are driven by a SyncDriver so they all arrive
+  together, and an axis cut short stops the others.
+
+  moveTo() and jog() are the non-blocking entry points for remote knobs
+  and act on axis 0: a new target arriving while the carriage is moving
+  brakes the current move and replans toward the latest target only, so a
+  burst of updates collapses into a single move.
+*/
+#ifndef MOTION_H
+#define MOTION_H
+
+#include <Arduino.h>
+#include "BasicStepperDriver.h"
+#include "PositionStore.h"
+#include "SyncDriver.h"
+
+#ifndef MOTION_MAX_SEGMENTS
+#define MOTION_MAX_SEGMENTS 32
+#endif
+
+// SyncDriver drives at most MAX_MOTORS
+#ifndef MOTION_MAX_AXES
+#define MOTION_MAX_AXES MAX_MOTORS
+#endif
+#if MOTION_MAX_AXES > MAX_MOTORS
+#error "MOTION_MAX_AXES is limited to MAX_MOTORS"
+#endif
+
+struct MotionSegment
+{
+  long target[MOTION_MAX_AXES]; // absolute position, or offset from the previous target
+  bool relative;
+  uint8_t axes;   // bit per axis moved, 0 moves axis 0 only
+  uint32_t dwell; // ms to hold once the target is reached
+  float rpm;      // 0 keeps the driver's configured speed
+  // Filled in as the program runs
+  long reached[MOTION_MAX_AXES];
+  uint8_t status;
+};
+
+class Motion
+{
+public:
+  enum State
+  {
+    IDLE,
+    MOVING,
+    DWELLING
+  };
+  enum SegmentStatus
+  {
+    SEGMENT_PENDING,
+    SEGMENT_DONE,
+    SEGMENT_STOPPED,
+    SEGMENT_SKIPPED
+  };
+  enum Error
+  {
+    OK,
+    BUSY,
+    EMPTY,
+    TOO_LONG,
+    OUT_OF_RANGE
+  };
+
+  Motion(BasicStepperDriver &stepper, PositionStore &store);
+
+  /*
+   * Add a further axis, before begin(). Returns its index, -1 when full.
+   */
+  int addAxis(BasicStepperDriver &stepper, PositionStore &store);
+  uint8_t axes() { return _axes; }
+  /*
+   * Start every axis at its restored position, 0 when there is none.
+   */
+  void begin();
+  void setLimits(long min, long max, uint8_t axis = 0);
+  long minLimit(uint8_t axis = 0) { return _axis[axis].min; }
+  long maxLimit(uint8_t axis = 0) { return _axis[axis].max; }
+
+  long position(uint8_t axis = 0);
+  /*
+   * Where the carriage is headed: the current segment's target while
+   * moving, the position otherwise.
+   */
+  long target(uint8_t axis = 0);
+  State state() { return _state; }
+  /*
+   * Ramp phase of the move in progress, STOPPED when not moving.
+   */
+  BasicStepperDriver::State phase();
+  /*
+   * Index of the segment being executed and length of the running program.
+   */
+  size_t segment() { return _current; }
+  size_t segments() { return _count; }
+
+  /*
+   * Resolve and validate the program, run it on the motion task and wait
+   * for it to finish. Results are written back into segments.
+   * With limits == false the soft limits are not checked (legacy /move).
+   * On OUT_OF_RANGE, rejected() is the index of the offending segment and
+   * rejectedAxis() the axis outside its limits or not configured.
+   */
+  Error run(MotionSegment *segments, size_t count, short accel, short decel, bool limits = true);
+  size_t rejected() { return _rejected; }
+  uint8_t rejectedAxis() { return _rejectedAxis; }
+  /*
+   * Head for an absolute target without waiting. If a non-blocking move
+   * is already running it is braked and replaced; a program started by
+   * run() is never interrupted (BUSY).
+   */
+  Error moveTo(long target, short accel, short decel, float rpm = 0);
+  /*
+   * Run toward the soft limit at velocity steps/s (sign is direction).
+   * Zero brakes to a stop.
+   */
+  Error jog(long velocity, short accel, short decel);
+  /*
+   * Decelerate to a stop and skip the rest of the program.
+   */
+  void brake();
+  /*
+   * Stop the current move immediately and skip the rest of the program.
+   * With endstop the move is accounted as cut short by the endstop.
+   */
+  void stop(bool endstop = false);
+
+  /*
+   * Wait for a program and execute it. Call forever from the motion task.
+   */
+  void loop();
+  /*
+   * Commit every axis's pending position checkpoint once motion has been
+   * quiet long enough. Call periodically from a housekeeping task.
+   */
+  void checkpoint();
+  /*
+   * Commit every axis's pending checkpoint right away (e.g. before a
+   * reboot). False if any write failed.
+   */
+  bool flush();
+
+  static const char *stateName(State state);
+  static const char *segmentStatusName(uint8_t status);
+
+private:
+  struct Axis
+  {
+    BasicStepperDriver *stepper;
+    PositionStore *store;
+    long min;
+    long max;
+    float rpm;
+    volatile long position;
+    volatile long from;
+  };
+  // SyncDriver only has constructors for two or three motors in public
+  class Group : public SyncDriver
+  {
+  public:
+    Group(unsigned short count, Motor *const *motors) : SyncDriver(count, motors) {}
+  };
+
+  Error _load(MotionSegment *segments, size_t count, short accel, short decel, bool limits);
+  bool _runSegment(MotionSegment &seg);
+  void _runSingle(long *planned, bool &braked);
+  void _runGroup(const long *steps, uint8_t moving, bool &braked);
+
+  Axis _axis[MOTION_MAX_AXES];
+  uint8_t _axes;
+  BasicStepperDriver *_drivers[MOTION_MAX_AXES];
+  Group *_group;
+  SemaphoreHandle_t _lock;
+  SemaphoreHandle_t _start;
+  SemaphoreHandle_t _done;
+  SemaphoreHandle_t _wake;
+  volatile uint8_t _moving; // axes stepping in the current segment
+  volatile State _state;
+  volatile bool _abort;
+  volatile bool _endstop; // _abort came from the endstop
+  volatile bool _brake;
+  bool _running;
+  MotionSegment *_results;
+  MotionSegment _program[MOTION_MAX_SEGMENTS];
+  volatile size_t _count;
+  volatile size_t _current;
+  size_t _rejected;
+  uint8_t _rejectedAxis;
+  uint8_t _used; // axes touched since the task woke up
+  short _accel;
+  short _decel;
+  // Steps to add to the running move, see moveTo()
+  volatile long _extend;
+  // Latest non-blocking target, picked up when the current move ends
+  bool _retarget;
+  MotionSegment _next;
+  short _nextAccel;
+  short _nextDecel;
+};
+
+#endif // MOTION_H
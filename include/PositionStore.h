@@ -0,0 +1,112 @@
+/*
+  PositionStore.h - checkpoint of the absolute motor position in
+  non-volatile storage.
+
+  Records rotate over a small ring of slots so repeated checkpoints do not
+  hammer the same key, and every record carries a sequence number and a
+  CRC so a write torn by power loss is simply skipped on the next boot.
+  A "dirty" record is written once when motion starts after a clean
+  checkpoint; the clean record is written only after motion has been
+  quiet for POSITION_COMMIT_DELAY_MS, so bursts of moves coalesce into a
+  single write.
+*/
+#ifndef POSITION_STORE_H
+#define POSITION_STORE_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+#ifndef POSITION_STORE_SLOTS
+#define POSITION_STORE_SLOTS 8
+#endif
+
+#ifndef POSITION_COMMIT_DELAY_MS
+#define POSITION_COMMIT_DELAY_MS 3000
+#endif
+
+/*
+ * Storage the checkpoint slots live in.
+ * read() returns false for a slot that was never written.
+ */
+class PositionBackend
+{
+public:
+  virtual ~PositionBackend() {}
+  virtual bool read(uint8_t slot, void *data, size_t len) = 0;
+  virtual bool write(uint8_t slot, const void *data, size_t len) = 0;
+};
+
+/*
+ * NVS backend, one key per slot in its own namespace.
+ */
+class NvsPositionBackend : public PositionBackend
+{
+public:
+  explicit NvsPositionBackend(const char *ns = "position") : _ns(ns) {}
+  bool begin() { return _prefs.begin(_ns, false); }
+  bool read(uint8_t slot, void *data, size_t len) override;
+  bool write(uint8_t slot, const void *data, size_t len) override;
+
+private:
+  const char *_ns;
+  Preferences _prefs;
+};
+
+class PositionStore
+{
+public:
+  explicit PositionStore(PositionBackend &backend);
+
+  /*
+   * Scan the slots for the newest valid record.
+   * Returns true when the last shutdown was clean and position() is valid.
+   */
+  bool begin();
+  bool restored() { return _restored; }
+  long position() { return _position; }
+
+  /*
+   * Motion hooks. Safe to call from any task.
+   */
+  void motionStarted(long position);
+  void motionStopped(long position);
+  /*
+   * Commit a pending clean checkpoint once motion has been quiet long enough,
+   * and retry a dirty marker the backend refused.
+   * Call periodically from a housekeeping task.
+   */
+  void loop();
+  /*
+   * Commit a pending clean checkpoint right away (e.g. before a reboot).
+   */
+  bool flush();
+
+private:
+  struct Record
+  {
+    uint32_t seq;
+    int32_t position;
+    uint8_t clean;
+    uint8_t reserved[3];
+    uint32_t crc;
+  };
+
+  static uint32_t _crc32(const uint8_t *data, size_t len);
+  bool _commit(long position, bool clean);
+
+  PositionBackend &_backend;
+  SemaphoreHandle_t _lock;
+  uint32_t _seq;
+  uint8_t _slot;
+  bool _persistedClean;
+  long _persistedPosition;
+  bool _unmarked; // motion started but the dirty marker is not on flash
+  long _unmarkedPosition;
+  bool _pending;
+  long _pendingPosition;
+  unsigned long _pendingSince;
+  bool _restored;
+  long _position;
+};
+
+#endif // POSITION_STORE_H
@@ -0,0 +1,75 @@
+/*
+  RigctlServer.h - Hamlib rigctld-compatible TCP listener.
+
+  Logging and rig-control programs that talk to rigctld (NET rigctl,
+  model 2) can point at the controller directly. A set_freq is turned
+  into an absolute move through the calibration table; every other
+  command gets a harmless fixed answer so clients are happy to connect.
+
+  Frequency updates are coalesced: all lines already received are
+  processed before anything moves, and only the last frequency is handed
+  to Motion, which in turn retargets a move in progress.
+*/
+#ifndef RIGCTL_SERVER_H
+#define RIGCTL_SERVER_H
+
+#include <Arduino.h>
+#include <WiFiServer.h>
+#include "Calibration.h"
+#include "Motion.h"
+
+#ifndef RIGCTL_CLIENTS
+#define RIGCTL_CLIENTS 2
+#endif
+
+#ifndef RIGCTL_LINE_MAX
+#define RIGCTL_LINE_MAX 64
+#endif
+
+// Hamlib status codes
+#define RIG_OK 0
+#define RIG_EINVAL -1
+#define RIG_ENIMPL -4
+
+class RigctlServer
+{
+public:
+  RigctlServer(Motion &motion, Calibration &calibration, uint8_t endstopPin, short accel, short decel);
+
+  void begin(uint16_t port);
+  /*
+   * Accept, read and answer, then apply the latest frequency.
+   * Call often from the rigctl task.
+   */
+  void loop();
+  uint32_t frequency() { return _freq; }
+
+private:
+  struct Session
+  {
+    WiFiClient client;
+    bool active;
+    char line[RIGCTL_LINE_MAX];
+    uint8_t len;
+    bool overflow;
+  };
+
+  void _accept();
+  void _read(Session &session);
+  void _command(Session &session, char *line);
+  int _setFrequency(const char *arg);
+  void _report(Session &session, int code);
+
+  Motion &_motion;
+  Calibration &_calibration;
+  uint8_t _endstopPin;
+  short _accel;
+  short _decel;
+  WiFiServer _server;
+  Session _sessions[RIGCTL_CLIENTS];
+  uint32_t _freq;
+  bool _pending;
+  long _pendingTarget;
+};
+
+#endif // RIGCTL_SERVER_H
@@ -0,0 +1,40 @@
+/*
+  SerialControl.h - binary control channel on a serial stream.
+
+  Uses the ControlFrame.h frames, each followed by a CRC-8 (poly 0x07) of
+  the frame bytes. The stream is shared with the text console, so the
+  receiver hunts for the frame magic and drops bytes until a frame passes
+  its CRC; console text on the way back is skipped the same way by the
+  client. Every command is answered with one status frame. There is no
+  sequence check: the link does not reorder or duplicate.
+*/
+#ifndef SERIAL_CONTROL_H
+#define SERIAL_CONTROL_H
+
+#include <Arduino.h>
+#include "Commands.h"
+#include "ControlFrame.h"
+
+class SerialControl
+{
+public:
+  SerialControl(Commands &commands, Stream &stream);
+
+  /*
+   * Read what has arrived and run complete frames.
+   * Call often from the serial control task.
+   */
+  void loop();
+
+  static uint8_t crc8(const uint8_t *data, size_t len);
+
+private:
+  void _handle(const ControlCommandFrame &frame);
+
+  Commands &_commands;
+  Stream &_stream;
+  uint8_t _buf[sizeof(ControlCommandFrame) + 1];
+  size_t _len;
+};
+
+#endif // SERIAL_CONTROL_H
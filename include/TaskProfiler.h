@@ -0,0 +1,106 @@
+/*
+  TaskProfiler.h - per-task CPU share, stack headroom and scheduling report.
+
+  snapshot() lists every FreeRTOS task with its stack high water mark and,
+  when the kernel keeps run-time stats, its run-time counter and CPU share
+  since the previous snapshot.
+
+  Sampling mode adds a timer interrupt that notes which task it cut into,
+  tagged with whether a move was in progress. On the single-core C3 this
+  shows what takes the CPU away from step generation. A switch is counted
+  when two consecutive samples land in different tasks, so switch counts
+  are a lower bound limited by the sample rate.
+*/
+#ifndef TASK_PROFILER_H
+#define TASK_PROFILER_H
+
+#include <Arduino.h>
+#include "Motion.h"
+
+#ifndef PROFILER_MAX_TASKS
+#define PROFILER_MAX_TASKS 24
+#endif
+
+#ifndef PROFILER_SAMPLE_HZ
+#define PROFILER_SAMPLE_HZ 2000
+#endif
+
+#ifndef PROFILER_TIMER
+#define PROFILER_TIMER 0
+#endif
+
+struct TaskProfile
+{
+  const char *name;
+  UBaseType_t priority;
+  eTaskState state;
+  uint32_t stackFree; // bytes never touched since the task started
+  uint32_t runtime;   // run-time counter, 0 without run-time stats
+  float cpu;          // % since the previous snapshot, or of all samples
+  uint32_t samples;
+  uint32_t movingSamples;
+  uint32_t switches;
+};
+
+class TaskProfiler
+{
+public:
+  TaskProfiler(Motion &motion);
+
+  void begin();
+  /*
+   * Fill profiles with up to max tasks, returns how many were written.
+   */
+  size_t snapshot(TaskProfile *profiles, size_t max);
+  static bool runTimeStats();
+  /*
+   * Free the slots of deleted tasks; snapshot() does so too. Call it
+   * now and then while sampling, when tasks come and go between
+   * snapshots.
+   */
+  void reclaim();
+
+  /*
+   * Start (and reset) or stop interrupt sampling.
+   */
+  void startSampling(uint32_t hz = PROFILER_SAMPLE_HZ);
+  void stopSampling();
+  bool sampling() { return _sampling; }
+  uint32_t sampleRate() { return _rate; }
+  uint32_t samples() { return _samples; }
+  uint32_t movingSamples() { return _movingSamples; }
+
+  static const char *stateName(eTaskState state);
+
+private:
+  struct Slot
+  {
+    TaskHandle_t handle;
+    uint32_t samples;
+    uint32_t moving;
+    uint32_t switches;
+    uint32_t runtime;
+  };
+
+  static void IRAM_ATTR _onSample();
+  void _sample();
+  Slot *_slot(TaskHandle_t handle);
+  void _reclaim(size_t count);
+
+  static TaskProfiler *_instance;
+
+  Motion &_motion;
+  hw_timer_t *_timer;
+  SemaphoreHandle_t _lock;
+  portMUX_TYPE _mux;
+  TaskStatus_t _status[PROFILER_MAX_TASKS];
+  Slot _slots[PROFILER_MAX_TASKS];
+  TaskHandle_t _last;
+  uint32_t _lastTotal;
+  volatile bool _sampling;
+  uint32_t _rate;
+  volatile uint32_t _samples;
+  volatile uint32_t _movingSamples;
+};
+
+#endif // TASK_PROFILER_H
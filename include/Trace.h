@@ -0,0 +1,74 @@
+/*
+  Trace.h - binary trace log kept in a RAM ring.
+
+  A trace record is a timestamp, an event id and three integer arguments.
+  Writing one is a sequence number claim and a handful of stores, with no
+  lock, no formatting and no I/O. That makes it cheap enough for the
+  motion, input and request paths, and safe from interrupts. The format
+  strings live in the event table below and are only applied by dump().
+
+  Records are numbered; the ring keeps the last TRACE_RING_SIZE of them and
+  dump() can resume from a number to read only what is new.
+*/
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Records kept, a power of two
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE 256
+#endif
+
+// Event id and the printf format for its three int arguments
+#define TRACE_EVENTS(X)                                                  \
+  X(TRACE_BOOT_PHASE, "boot phase %d done at %d ms")                     \
+  X(TRACE_ENDSTOP, "endstop level %d")                                   \
+  X(TRACE_MOVE_START, "move from %d to %d, axes %d")                     \
+  X(TRACE_MOVE_DONE, "move done at %d, %d steps")                        \
+  X(TRACE_MOVE_BRAKED, "move braked at %d, %d steps")                    \
+  X(TRACE_MOVE_STOPPED, "move stopped at %d, %d steps")                  \
+  X(TRACE_MOVE_ENDSTOP, "move cut by endstop at %d, %d steps")           \
+  X(TRACE_HTTP_REQUEST, "http method %d: parse %d us, handle %d us")     \
+  X(TRACE_WIFI_DISCONNECTED, "wifi disconnected")                        \
+  X(TRACE_WIFI_GOT_IP, "wifi got ip")                                    \
+  X(TRACE_NET_LOST, "network lost, outage %d")                           \
+  X(TRACE_NET_RECONNECT, "network reconnect, attempt %d")                \
+  X(TRACE_NET_REINIT, "network reinit, attempt %d")                      \
+  X(TRACE_NET_REBOOT, "network unrecoverable, rebooting")                \
+  X(TRACE_NET_RECOVERED, "network recovered after %d ms at level %d")
+
+enum TraceEvent
+{
+#define TRACE_ENUM(id, format) id,
+  TRACE_EVENTS(TRACE_ENUM)
+#undef TRACE_ENUM
+  TRACE_EVENT_COUNT
+};
+
+class Trace
+{
+public:
+  static void log(TraceEvent event, int32_t a = 0, int32_t b = 0, int32_t c = 0);
+  /*
+   * Print records numbered from since on, oldest first, one per line.
+   * Returns the number to pass next time.
+   */
+  static uint32_t dump(Print &out, uint32_t since = 0);
+  static uint32_t next() { return _next.load(std::memory_order_relaxed); }
+
+private:
+  struct Record
+  {
+    std::atomic<uint32_t> seq;
+    uint32_t micros;
+    uint16_t event;
+    int32_t args[3];
+  };
+
+  static Record _ring[TRACE_RING_SIZE];
+  static std::atomic<uint32_t> _next;
+};
+
+#endif // TRACE_H
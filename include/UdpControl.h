@@ -0,0 +1,69 @@
+/*
+  UdpControl.h - compact binary control protocol over UDP.
+
+  Every datagram is one ControlFrame.h frame; commands run through the
+  shared Commands dispatcher. Sequence numbers make commands idempotent:
+  a repeated seq is answered from the reply cache without running the
+  command again, and an older seq (reordered or late) is answered with
+  CMD_STALE. Any client heard from recently also receives unsolicited
+  status frames (seq 0), fast while moving and slow while idle.
+*/
+#ifndef UDP_CONTROL_H
+#define UDP_CONTROL_H
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include "Commands.h"
+#include "ControlFrame.h"
+
+#ifndef UDP_CONTROL_CLIENTS
+#define UDP_CONTROL_CLIENTS 4
+#endif
+
+#ifndef UDP_CONTROL_CLIENT_TIMEOUT_MS
+#define UDP_CONTROL_CLIENT_TIMEOUT_MS 30000
+#endif
+
+#ifndef UDP_STATUS_INTERVAL_MS
+#define UDP_STATUS_INTERVAL_MS 50
+#endif
+
+#ifndef UDP_STATUS_IDLE_INTERVAL_MS
+#define UDP_STATUS_IDLE_INTERVAL_MS 1000
+#endif
+
+class UdpControl
+{
+public:
+  UdpControl(Commands &commands);
+
+  bool begin(uint16_t port);
+  /*
+   * Drain pending datagrams and send status frames that are due.
+   * Call often from the UDP task.
+   */
+  void loop();
+
+private:
+  struct Client
+  {
+    IPAddress ip;
+    uint16_t port;
+    bool valid;
+    uint32_t seq;
+    unsigned long lastSeen;
+    ControlStatusFrame reply;
+  };
+
+  void _handle(const ControlCommandFrame &frame);
+  Client &_client(IPAddress ip, uint16_t port);
+  void _fillStatus(ControlStatusFrame &frame, uint8_t type);
+  void _send(IPAddress ip, uint16_t port, const ControlStatusFrame &frame);
+
+  Commands &_commands;
+  WiFiUDP _udp;
+  Client _clients[UDP_CONTROL_CLIENTS];
+  unsigned long _lastStatus;
+};
+
+#endif // UDP_CONTROL_H
@@ -0,0 +1,128 @@
+#include <sched.h>
+#include <signal.h>
+#include <random>
+
+#include "Arduino.h"
+
+unsigned long millis()
+{
+  return (unsigned long)(NativeClock::nowMicros() / 1000);
+}
+
+unsigned long micros()
+{
+  return (unsigned long)NativeClock::nowMicros();
+}
+
+void delay(uint32_t ms)
+{
+  vTaskDelay(ms);
+}
+
+void delayMicroseconds(uint32_t us)
+{
+  uint64_t start = NativeClock::nowMicros();
+  while (NativeClock::nowMicros() - start < us)
+    ;
+}
+
+void yield()
+{
+  sched_yield();
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  NativePlant::pinMode(pin, mode);
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  NativePlant::write(pin, val);
+}
+
+int digitalRead(uint8_t pin)
+{
+  return NativePlant::read(pin);
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode)
+{
+  NativePlant::attachInterrupt(pin, isr, mode);
+}
+
+void attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int mode)
+{
+  NativePlant::attachInterruptArg(pin, isr, arg, mode);
+}
+
+void detachInterrupt(uint8_t pin)
+{
+  NativePlant::detachInterrupt(pin);
+}
+
+void ledcSetup(uint8_t channel, double freq, uint8_t resolution_bits)
+{
+  (void)channel;
+  (void)freq;
+  (void)resolution_bits;
+}
+
+void ledcAttachPin(uint8_t pin, uint8_t channel)
+{
+  (void)pin;
+  (void)channel;
+}
+
+void ledcWrite(uint8_t channel, uint32_t duty)
+{
+  (void)channel;
+  (void)duty;
+}
+
+static std::mt19937 &rng()
+{
+  static std::mt19937 gen(std::random_device{}());
+  return gen;
+}
+
+long random(long max)
+{
+  return max > 0 ? (long)(rng()() % (unsigned long)max) : 0;
+}
+
+long random(long min, long max)
+{
+  return max > min ? min + random(max - min) : min;
+}
+
+uint32_t esp_random()
+{
+  return rng()();
+}
+
+void btStop()
+{
+}
+
+int main(int argc, char **argv)
+{
+  (void)argc;
+  (void)argv;
+  signal(SIGPIPE, SIG_IGN);
+  if (getenv("NATIVE_CLOCK") && !strcmp(getenv("NATIVE_CLOCK"), "manual"))
+    NativeClock::setMode(NativeClock::MANUAL);
+  setup();
+  for (;;)
+  {
+    loop();
+    delay(1);
+  }
+  return 0;
+}
+
+void analogWrite(uint8_t pin, int value)
+{
+  (void)pin;
+  (void)value;
+}
@@ -0,0 +1,85 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "ESP32Ping.h"
+
+PingClass Ping;
+
+static bool probe(uint32_t addr, float &ms)
+{
+  // Simulated link: a probe fails while NATIVE_LINK_DOWN names an existing file
+  const char *down = getenv("NATIVE_LINK_DOWN");
+  if (down && access(down, F_OK) == 0)
+  {
+    usleep(1000 * 1000);
+    ms = 1000;
+    return false;
+  }
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0)
+    return false;
+  fcntl(fd, F_SETFL, O_NONBLOCK);
+  struct sockaddr_in sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_port = htons(NATIVE_PING_PORT);
+  sa.sin_addr.s_addr = addr;
+  // Lets a test point the firmware's hard-coded gateway somewhere reachable
+  const char *redirect = getenv("NATIVE_PING_REDIRECT");
+  if (redirect)
+    sa.sin_addr.s_addr = inet_addr(redirect);
+  unsigned long start = micros();
+  bool ok = false;
+  if (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) == 0)
+  {
+    ok = true;
+  }
+  else if (errno == ECONNREFUSED)
+  {
+    ok = true;
+  }
+  else if (errno == EINPROGRESS)
+  {
+    struct pollfd pfd = {fd, POLLOUT, 0};
+    if (poll(&pfd, 1, 1000) > 0)
+    {
+      int err = 0;
+      socklen_t len = sizeof(err);
+      getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+      ok = err == 0 || err == ECONNREFUSED;
+    }
+  }
+  ms = (micros() - start) / 1000.0f;
+  close(fd);
+  return ok;
+}
+
+bool PingClass::ping(IPAddress dest, byte count)
+{
+  float total = 0;
+  byte success = 0;
+  for (byte i = 0; i < count; i++)
+  {
+    float ms;
+    if (probe((uint32_t)dest, ms))
+    {
+      total += ms;
+      success++;
+    }
+  }
+  _avg_time = success ? total / success : 0;
+  return success > 0;
+}
+
+bool PingClass::ping(const char *host, byte count)
+{
+  struct hostent *he = gethostbyname(host);
+  if (!he)
+    return false;
+  return ping(IPAddress(*(uint32_t *)he->h_addr_list[0]), count);
+}
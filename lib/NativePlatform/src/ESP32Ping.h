@@ -0,0 +1,31 @@
+/*
+  ESP32Ping.h - host build replacement for the ICMP ping library.
+
+  Raw ICMP needs privileges on Linux, so a probe is a TCP connect to
+  NATIVE_PING_PORT: an accepted or refused connection both prove the host
+  is reachable, a timeout does not.
+*/
+#ifndef ESP32PING_H
+#define ESP32PING_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+#ifndef NATIVE_PING_PORT
+#define NATIVE_PING_PORT 7
+#endif
+
+class PingClass
+{
+public:
+  bool ping(IPAddress dest, byte count = 5);
+  bool ping(const char *host, byte count = 5);
+  float averageTime() { return _avg_time; }
+
+private:
+  float _avg_time = 0;
+};
+
+extern PingClass Ping;
+
+#endif
@@ -0,0 +1,43 @@
+#include <malloc.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "Arduino.h"
+
+EspClass ESP;
+
+static uint32_t minFree = NATIVE_HEAP_SIZE;
+
+void EspClass::restart()
+{
+  fprintf(stderr, "ESP.restart()\n");
+  fflush(stdout);
+  // Exit code 3 lets a supervising script tell a restart from a crash
+  _exit(3);
+}
+
+uint32_t EspClass::getHeapSize()
+{
+  return NATIVE_HEAP_SIZE;
+}
+
+uint32_t EspClass::getFreeHeap()
+{
+  struct mallinfo2 mi = mallinfo2();
+  uint32_t used = mi.uordblks > NATIVE_HEAP_SIZE ? NATIVE_HEAP_SIZE : (uint32_t)mi.uordblks;
+  uint32_t free = NATIVE_HEAP_SIZE - used;
+  if (free < minFree)
+    minFree = free;
+  return free;
+}
+
+uint32_t EspClass::getMinFreeHeap()
+{
+  getFreeHeap();
+  return minFree;
+}
+
+uint32_t EspClass::getMaxAllocHeap()
+{
+  return getFreeHeap();
+}
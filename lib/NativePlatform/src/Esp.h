@@ -0,0 +1,30 @@
+/*
+  Esp.h - ESP object for the host build. Heap figures come from the host
+  allocator against an emulated ESP32-C3 heap of NATIVE_HEAP_SIZE bytes.
+*/
+#ifndef ESP_H
+#define ESP_H
+
+#include <stdint.h>
+
+#ifndef NATIVE_HEAP_SIZE
+#define NATIVE_HEAP_SIZE (320 * 1024)
+#endif
+
+class EspClass
+{
+public:
+  void restart();
+  uint32_t getHeapSize();
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap();
+  uint32_t getCpuFreqMHz() { return 160; }
+  const char *getChipModel() { return "native"; }
+  const char *getSdkVersion() { return "native"; }
+  uint64_t getEfuseMac() { return 0x0000deadbeef0000ULL; }
+};
+
+extern EspClass ESP;
+
+#endif // ESP_H
@@ -0,0 +1,100 @@
+/*
+  FS.h - file system API on top of stdio for the host build. Paths are
+  resolved against the root directory handed to the FS.
+*/
+#ifndef FS_H
+#define FS_H
+
+#include <memory>
+#include <sys/stat.h>
+
+#include "Arduino.h"
+
+namespace fs
+{
+
+class File : public Stream
+{
+public:
+  File() : _fp(nullptr), _dir(false), _size(0) {}
+  File(const String &path, const char *mode) : _fp(nullptr), _dir(false), _size(0), _path(path)
+  {
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+    {
+      _dir = true;
+      return;
+    }
+    FILE *fp = fopen(path.c_str(), mode);
+    if (fp)
+    {
+      _fp.reset(fp, fclose);
+      if (stat(path.c_str(), &st) == 0)
+        _size = st.st_size;
+    }
+  }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buf, size_t size) override { return _fp ? fwrite(buf, 1, size, _fp.get()) : 0; }
+  int available() override { return _fp ? (int)(_size - ftell(_fp.get())) : 0; }
+  int read() override { return _fp ? fgetc(_fp.get()) : -1; }
+  size_t read(uint8_t *buf, size_t size) { return _fp ? fread(buf, 1, size, _fp.get()) : 0; }
+  size_t readBytes(char *buffer, size_t length) override { return read((uint8_t *)buffer, length); }
+  int peek() override
+  {
+    if (!_fp)
+      return -1;
+    int c = fgetc(_fp.get());
+    if (c >= 0)
+      ungetc(c, _fp.get());
+    return c;
+  }
+  void flush() override
+  {
+    if (_fp)
+      fflush(_fp.get());
+  }
+  size_t size() const { return _size; }
+  void close() { _fp.reset(); }
+  operator bool() const { return _fp != nullptr || _dir; }
+  bool isDirectory() const { return _dir; }
+  const char *name() const
+  {
+    int slash = _path.lastIndexOf('/');
+    return _path.c_str() + slash + 1;
+  }
+  const char *path() const { return _path.c_str(); }
+  using Print::write;
+
+private:
+  std::shared_ptr<FILE> _fp;
+  bool _dir;
+  size_t _size;
+  String _path;
+};
+
+class FS
+{
+public:
+  explicit FS(const char *root = ".") : _root(root) {}
+  File open(const String &path, const char *mode = "r") { return File(_root + path, mode); }
+  File open(const char *path, const char *mode = "r") { return open(String(path), mode); }
+  bool exists(const String &path)
+  {
+    struct stat st;
+    return stat((_root + path).c_str(), &st) == 0;
+  }
+
+private:
+  String _root;
+};
+
+} // namespace fs
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+using fs::File;
+using fs::FS;
+
+#endif // FS_H
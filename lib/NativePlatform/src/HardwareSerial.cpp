@@ -0,0 +1,59 @@
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "Arduino.h"
+
+HardwareSerial Serial;
+
+void HardwareSerial::begin(unsigned long baud)
+{
+  (void)baud;
+  setvbuf(stdout, NULL, _IONBF, 0);
+}
+
+int HardwareSerial::available()
+{
+  if (_peeked >= 0)
+    return 1;
+  struct pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+  if (poll(&pfd, 1, 0) <= 0 || !(pfd.revents & POLLIN))
+    return 0;
+  return 1;
+}
+
+int HardwareSerial::read()
+{
+  if (_peeked >= 0)
+  {
+    int c = _peeked;
+    _peeked = -1;
+    return c;
+  }
+  if (!available())
+    return -1;
+  uint8_t c;
+  return ::read(STDIN_FILENO, &c, 1) == 1 ? c : -1;
+}
+
+int HardwareSerial::peek()
+{
+  if (_peeked < 0)
+    _peeked = read();
+  return _peeked;
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+  return fwrite(&c, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+  return fwrite(buffer, 1, size, stdout);
+}
+
+void HardwareSerial::flush()
+{
+  fflush(stdout);
+}
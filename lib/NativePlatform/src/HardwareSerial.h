@@ -0,0 +1,29 @@
+/*
+  HardwareSerial.h - Serial on stdin/stdout for the host build.
+*/
+#ifndef HardwareSerial_h
+#define HardwareSerial_h
+
+#include "Stream.h"
+
+class HardwareSerial : public Stream
+{
+public:
+  void begin(unsigned long baud);
+  void end() {}
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  void flush() override;
+  operator bool() const { return true; }
+  using Print::write;
+
+private:
+  int _peeked = -1;
+};
+
+extern HardwareSerial Serial;
+
+#endif // HardwareSerial_h
@@ -0,0 +1,47 @@
+#include "Arduino.h"
+#include "IPAddress.h"
+
+const IPAddress INADDR_NONE(0, 0, 0, 0);
+
+bool IPAddress::fromString(const char *address)
+{
+  uint16_t acc = 0;
+  uint8_t dots = 0;
+  while (*address)
+  {
+    char c = *address++;
+    if (c >= '0' && c <= '9')
+    {
+      acc = acc * 10 + (c - '0');
+      if (acc > 255)
+        return false;
+    }
+    else if (c == '.')
+    {
+      if (dots == 3)
+        return false;
+      _address.bytes[dots++] = acc;
+      acc = 0;
+    }
+    else
+    {
+      return false;
+    }
+  }
+  if (dots != 3)
+    return false;
+  _address.bytes[3] = acc;
+  return true;
+}
+
+size_t IPAddress::printTo(Print &p) const
+{
+  return p.print(toString());
+}
+
+String IPAddress::toString() const
+{
+  char szRet[16];
+  snprintf(szRet, sizeof(szRet), "%u.%u.%u.%u", _address.bytes[0], _address.bytes[1], _address.bytes[2], _address.bytes[3]);
+  return String(szRet);
+}
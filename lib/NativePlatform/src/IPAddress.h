@@ -0,0 +1,61 @@
+/*
+  IPAddress.h - IPv4 address for the host build.
+*/
+#ifndef IPAddress_h
+#define IPAddress_h
+
+#include <stdint.h>
+
+#include "Printable.h"
+#include "WString.h"
+
+class IPAddress : public Printable
+{
+private:
+  union {
+    uint8_t bytes[4];
+    uint32_t dword;
+  } _address;
+
+public:
+  IPAddress() { _address.dword = 0; }
+  IPAddress(uint8_t first_octet, uint8_t second_octet, uint8_t third_octet, uint8_t fourth_octet)
+  {
+    _address.bytes[0] = first_octet;
+    _address.bytes[1] = second_octet;
+    _address.bytes[2] = third_octet;
+    _address.bytes[3] = fourth_octet;
+  }
+  IPAddress(uint32_t address) { _address.dword = address; }
+  IPAddress(const uint8_t *address) { memcpy(_address.bytes, address, 4); }
+
+  bool fromString(const char *address);
+  bool fromString(const String &address) { return fromString(address.c_str()); }
+
+  operator uint32_t() const { return _address.dword; }
+  bool operator==(const IPAddress &addr) const { return _address.dword == addr._address.dword; }
+  bool operator==(const uint8_t *addr) const { return memcmp(addr, _address.bytes, 4) == 0; }
+
+  uint8_t operator[](int index) const { return _address.bytes[index]; }
+  uint8_t &operator[](int index) { return _address.bytes[index]; }
+
+  IPAddress &operator=(const uint8_t *address)
+  {
+    memcpy(_address.bytes, address, 4);
+    return *this;
+  }
+  IPAddress &operator=(uint32_t address)
+  {
+    _address.dword = address;
+    return *this;
+  }
+
+  virtual size_t printTo(Print &p) const;
+  String toString() const;
+};
+
+// netinet/in.h defines INADDR_NONE as a macro
+#undef INADDR_NONE
+extern const IPAddress INADDR_NONE;
+
+#endif // IPAddress_h
@@ -0,0 +1,65 @@
+#include <condition_variable>
+#include <mutex>
+#include <time.h>
+
+#include "NativeClock.h"
+
+static NativeClock::Mode clockMode = NativeClock::REALTIME;
+static uint64_t manualNow = 0;
+static std::mutex manualLock;
+static std::condition_variable manualTick;
+
+static uint64_t monotonicMicros()
+{
+  static uint64_t origin = 0;
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  uint64_t now = (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+  if (!origin)
+    origin = now;
+  return now - origin;
+}
+
+void NativeClock::setMode(Mode mode)
+{
+  std::lock_guard<std::mutex> guard(manualLock);
+  if (mode == MANUAL && clockMode == REALTIME)
+    manualNow = monotonicMicros();
+  clockMode = mode;
+  manualTick.notify_all();
+}
+
+NativeClock::Mode NativeClock::mode()
+{
+  return clockMode;
+}
+
+uint64_t NativeClock::nowMicros()
+{
+  if (clockMode == REALTIME)
+    return monotonicMicros();
+  std::lock_guard<std::mutex> guard(manualLock);
+  return manualNow;
+}
+
+void NativeClock::advance(uint64_t us)
+{
+  std::lock_guard<std::mutex> guard(manualLock);
+  manualNow += us;
+  manualTick.notify_all();
+}
+
+void NativeClock::sleepMicros(uint64_t us)
+{
+  if (clockMode == REALTIME)
+  {
+    struct timespec ts;
+    ts.tv_sec = us / 1000000;
+    ts.tv_nsec = (us % 1000000) * 1000;
+    nanosleep(&ts, NULL);
+    return;
+  }
+  std::unique_lock<std::mutex> guard(manualLock);
+  uint64_t deadline = manualNow + us;
+  manualTick.wait(guard, [deadline] { return clockMode == REALTIME || manualNow >= deadline; });
+}
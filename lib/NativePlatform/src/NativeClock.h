@@ -0,0 +1,29 @@
+/*
+  NativeClock.h - time base behind millis()/micros() in the host build.
+
+  REALTIME follows the monotonic clock. MANUAL only moves when advance() is
+  called, so a test driver can step simulated time deterministically; tasks
+  sleeping in delay()/vTaskDelay() wake up as the clock passes their deadline.
+*/
+#ifndef NATIVE_CLOCK_H
+#define NATIVE_CLOCK_H
+
+#include <stdint.h>
+
+class NativeClock
+{
+public:
+  enum Mode
+  {
+    REALTIME,
+    MANUAL
+  };
+
+  static void setMode(Mode mode);
+  static Mode mode();
+  static uint64_t nowMicros();
+  static void advance(uint64_t us);
+  static void sleepMicros(uint64_t us);
+};
+
+#endif // NATIVE_CLOCK_H
@@ -0,0 +1,157 @@
+#include <atomic>
+#include <mutex>
+#include <stdlib.h>
+
+#include "Arduino.h"
+#include "NativePlant.h"
+
+struct PinState
+{
+  uint8_t mode;
+  uint8_t level;
+  void (*isr)(void);
+  void (*isrArg)(void *);
+  void *arg;
+  int isrMode;
+};
+
+static PinState pins[NUM_DIGITAL_PINS];
+static std::recursive_mutex pinLock;
+static std::atomic<long> carriage(0);
+static std::atomic<long> endstopAt(PLANT_ENDSTOP_POSITION);
+static std::atomic<unsigned long> steps(0);
+static bool plantReady = false;
+
+static void plantInit()
+{
+  if (plantReady)
+    return;
+  plantReady = true;
+  for (auto &p : pins)
+    p.level = HIGH;
+  const char *start = getenv("PLANT_POSITION");
+  if (start)
+    carriage = atol(start);
+  const char *endstop = getenv("PLANT_ENDSTOP_POSITION");
+  if (endstop)
+    endstopAt = atol(endstop);
+}
+
+static void setLevel(uint8_t pin, uint8_t level)
+{
+  void (*isr)(void) = NULL;
+  void (*isrArg)(void *) = NULL;
+  void *arg = NULL;
+  {
+    std::lock_guard<std::recursive_mutex> guard(pinLock);
+    PinState &p = pins[pin];
+    if (p.level == level)
+      return;
+    p.level = level;
+    if (p.isrMode == CHANGE || (p.isrMode == RISING && level) || (p.isrMode == FALLING && !level))
+    {
+      isr = p.isr;
+      isrArg = p.isrArg;
+      arg = p.arg;
+    }
+  }
+  if (isr)
+    isr();
+  if (isrArg)
+    isrArg(arg);
+}
+
+static void updateEndstop()
+{
+  setLevel(PLANT_ENDSTOP_PIN, carriage.load() >= endstopAt.load() ? LOW : HIGH);
+}
+
+void NativePlant::pinMode(uint8_t pin, uint8_t mode)
+{
+  if (pin >= NUM_DIGITAL_PINS)
+    return;
+  std::lock_guard<std::recursive_mutex> guard(pinLock);
+  plantInit();
+  pins[pin].mode = mode;
+  if (pin == PLANT_ENDSTOP_PIN)
+    updateEndstop();
+}
+
+void NativePlant::write(uint8_t pin, uint8_t level)
+{
+  if (pin >= NUM_DIGITAL_PINS)
+    return;
+  plantInit();
+  bool rising = level && !pins[pin].level;
+  pins[pin].level = level ? HIGH : LOW;
+  if (pin == PLANT_STEP_PIN && rising && pins[PLANT_EN_PIN].level == PLANT_EN_ACTIVE)
+  {
+    carriage += pins[PLANT_DIR_PIN].level ? 1 : -1;
+    steps++;
+    updateEndstop();
+  }
+}
+
+int NativePlant::read(uint8_t pin)
+{
+  if (pin >= NUM_DIGITAL_PINS)
+    return LOW;
+  plantInit();
+  return pins[pin].level;
+}
+
+void NativePlant::inject(uint8_t pin, uint8_t level)
+{
+  if (pin >= NUM_DIGITAL_PINS)
+    return;
+  plantInit();
+  setLevel(pin, level ? HIGH : LOW);
+}
+
+void NativePlant::attachInterrupt(uint8_t pin, void (*isr)(void), int mode)
+{
+  if (pin >= NUM_DIGITAL_PINS)
+    return;
+  std::lock_guard<std::recursive_mutex> guard(pinLock);
+  pins[pin].isr = isr;
+  pins[pin].isrArg = NULL;
+  pins[pin].isrMode = mode;
+}
+
+void NativePlant::attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int mode)
+{
+  if (pin >= NUM_DIGITAL_PINS)
+    return;
+  std::lock_guard<std::recursive_mutex> guard(pinLock);
+  pins[pin].isr = NULL;
+  pins[pin].isrArg = isr;
+  pins[pin].arg = arg;
+  pins[pin].isrMode = mode;
+}
+
+void NativePlant::detachInterrupt(uint8_t pin)
+{
+  if (pin >= NUM_DIGITAL_PINS)
+    return;
+  std::lock_guard<std::recursive_mutex> guard(pinLock);
+  pins[pin].isr = NULL;
+  pins[pin].isrArg = NULL;
+}
+
+long NativePlant::position() { return carriage; }
+
+void NativePlant::setPosition(long position)
+{
+  carriage = position;
+  updateEndstop();
+}
+
+long NativePlant::endstopPosition() { return endstopAt; }
+
+void NativePlant::setEndstopPosition(long position)
+{
+  endstopAt = position;
+  updateEndstop();
+}
+
+unsigned long NativePlant::stepsTaken() { return steps; }
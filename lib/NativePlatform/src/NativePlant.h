@@ -0,0 +1,55 @@
+/*
+  NativePlant.h - simulated GPIO and carriage for the host build.
+
+  Pin writes and reads land in a pin table. The STEP/DIR/EN pins drive a
+  simulated carriage; the endstop pin reads LOW while the carriage sits at
+  or beyond endstopPosition(), and edges on it fire attached interrupts
+  from the thread that moved the carriage, just like a real ISR would
+  preempt the stepping task.
+*/
+#ifndef NATIVE_PLANT_H
+#define NATIVE_PLANT_H
+
+#include <stdint.h>
+
+#ifndef PLANT_DIR_PIN
+#define PLANT_DIR_PIN 6
+#endif
+#ifndef PLANT_STEP_PIN
+#define PLANT_STEP_PIN 7
+#endif
+#ifndef PLANT_EN_PIN
+#define PLANT_EN_PIN 8
+#endif
+#ifndef PLANT_EN_ACTIVE
+#define PLANT_EN_ACTIVE 0
+#endif
+#ifndef PLANT_ENDSTOP_PIN
+#define PLANT_ENDSTOP_PIN 10
+#endif
+#ifndef PLANT_ENDSTOP_POSITION
+#define PLANT_ENDSTOP_POSITION 7500
+#endif
+
+class NativePlant
+{
+public:
+  static void pinMode(uint8_t pin, uint8_t mode);
+  static void write(uint8_t pin, uint8_t level);
+  static int read(uint8_t pin);
+  /*
+   * Drive an input pin from the outside (button, sensor), firing interrupts.
+   */
+  static void inject(uint8_t pin, uint8_t level);
+  static void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+  static void attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int mode);
+  static void detachInterrupt(uint8_t pin);
+
+  static long position();
+  static void setPosition(long position);
+  static long endstopPosition();
+  static void setEndstopPosition(long position);
+  static unsigned long stepsTaken();
+};
+
+#endif // NATIVE_PLANT_H
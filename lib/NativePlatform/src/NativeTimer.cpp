@@ -0,0 +1,60 @@
+// Hardware timer emulation: one thread per timer, firing while enabled.
+#include "Arduino.h"
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+struct hw_timer_s
+{
+  std::atomic<void (*)(void)> fn{nullptr};
+  std::atomic<uint64_t> alarm{1000000};
+  std::atomic<bool> enabled{false};
+  std::atomic<bool> alive{true};
+  uint16_t divider = 80;
+  std::thread thread;
+};
+
+static void timerThread(hw_timer_t *t)
+{
+  while (t->alive)
+  {
+    // ticks at 80 MHz / divider
+    uint64_t us = t->alarm * t->divider / 80;
+    std::this_thread::sleep_for(std::chrono::microseconds(us ? us : 1));
+    void (*fn)(void) = t->fn;
+    if (t->enabled && fn)
+      fn();
+  }
+}
+
+hw_timer_t *timerBegin(uint8_t num, uint16_t divider, bool countUp)
+{
+  (void)num;
+  (void)countUp;
+  hw_timer_t *t = new hw_timer_t;
+  t->divider = divider ? divider : 1;
+  t->thread = std::thread(timerThread, t);
+  return t;
+}
+
+void timerEnd(hw_timer_t *timer)
+{
+  timer->alive = false;
+  timer->thread.join();
+  delete timer;
+}
+
+void timerAttachInterrupt(hw_timer_t *timer, void (*fn)(void), bool edge)
+{
+  (void)edge;
+  timer->fn = fn;
+}
+
+void timerDetachInterrupt(hw_timer_t *timer) { timer->fn = nullptr; }
+void timerAlarmWrite(hw_timer_t *timer, uint64_t alarm_value, bool autoreload)
+{
+  (void)autoreload;
+  timer->alarm = alarm_value;
+}
+void timerAlarmEnable(hw_timer_t *timer) { timer->enabled = true; }
+void timerAlarmDisable(hw_timer_t *timer) { timer->enabled = false; }
@@ -0,0 +1,114 @@
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Preferences.h"
+
+bool Preferences::begin(const char *name, bool readOnly, const char *partition_label)
+{
+  (void)partition_label;
+  const char *root = getenv("NATIVE_NVS_DIR");
+  String base = root ? root : ".nvs";
+  mkdir(base.c_str(), 0755);
+  _dir = base + "/" + name;
+  if (mkdir(_dir.c_str(), 0755) != 0 && errno != EEXIST)
+    return false;
+  _readOnly = readOnly;
+  _started = true;
+  return true;
+}
+
+void Preferences::end()
+{
+  _started = false;
+}
+
+String Preferences::path(const char *key)
+{
+  return _dir + "/" + key;
+}
+
+bool Preferences::clear()
+{
+  if (!_started || _readOnly)
+    return false;
+  DIR *dir = opendir(_dir.c_str());
+  if (!dir)
+    return false;
+  struct dirent *ent;
+  while ((ent = readdir(dir)) != NULL)
+  {
+    if (ent->d_name[0] != '.')
+      unlink(path(ent->d_name).c_str());
+  }
+  closedir(dir);
+  return true;
+}
+
+bool Preferences::remove(const char *key)
+{
+  if (!_started || _readOnly)
+    return false;
+  return unlink(path(key).c_str()) == 0;
+}
+
+bool Preferences::isKey(const char *key)
+{
+  struct stat st;
+  return _started && stat(path(key).c_str(), &st) == 0;
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len)
+{
+  if (!_started || _readOnly || !key)
+    return 0;
+  String tmp = path(key) + ".tmp";
+  FILE *f = fopen(tmp.c_str(), "wb");
+  if (!f)
+    return 0;
+  size_t written = fwrite(value, 1, len, f);
+  fflush(f);
+  fsync(fileno(f));
+  fclose(f);
+  if (written != len || rename(tmp.c_str(), path(key).c_str()) != 0)
+    return 0;
+  return len;
+}
+
+size_t Preferences::getBytesLength(const char *key)
+{
+  struct stat st;
+  if (!_started || stat(path(key).c_str(), &st) != 0)
+    return 0;
+  return st.st_size;
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen)
+{
+  size_t len = getBytesLength(key);
+  if (!len || !buf || len > maxLen)
+    return 0;
+  FILE *f = fopen(path(key).c_str(), "rb");
+  if (!f)
+    return 0;
+  size_t n = fread(buf, 1, len, f);
+  fclose(f);
+  return n;
+}
+
+String Preferences::getString(const char *key, const String &defaultValue)
+{
+  size_t len = getBytesLength(key);
+  if (!len)
+    return defaultValue;
+  char *buf = (char *)malloc(len + 1);
+  if (!buf)
+    return defaultValue;
+  size_t n = getBytes(key, buf, len);
+  buf[n] = 0;
+  String value(buf);
+  free(buf);
+  return value;
+}
@@ -0,0 +1,62 @@
+/*
+  Preferences.h - NVS stand-in for the host build.
+
+  Each key is a file under $NATIVE_NVS_DIR/<namespace>/ (default ".nvs"),
+  replaced atomically with rename() the way an NVS entry is either fully
+  written or not at all.
+*/
+#ifndef _PREFERENCES_H_
+#define _PREFERENCES_H_
+
+#include "Arduino.h"
+
+class Preferences
+{
+public:
+  Preferences() : _started(false), _readOnly(false) {}
+  ~Preferences() { end(); }
+
+  bool begin(const char *name, bool readOnly = false, const char *partition_label = NULL);
+  void end();
+
+  bool clear();
+  bool remove(const char *key);
+  bool isKey(const char *key);
+
+  size_t putBytes(const char *key, const void *value, size_t len);
+  size_t getBytes(const char *key, void *buf, size_t maxLen);
+  size_t getBytesLength(const char *key);
+
+  size_t putUChar(const char *key, uint8_t value) { return putBytes(key, &value, sizeof(value)); }
+  size_t putUShort(const char *key, uint16_t value) { return putBytes(key, &value, sizeof(value)); }
+  size_t putInt(const char *key, int32_t value) { return putBytes(key, &value, sizeof(value)); }
+  size_t putUInt(const char *key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+  size_t putLong(const char *key, int32_t value) { return putBytes(key, &value, sizeof(value)); }
+  size_t putULong(const char *key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+  size_t putBool(const char *key, bool value) { return putUChar(key, value ? 1 : 0); }
+  size_t putString(const char *key, const String &value) { return putBytes(key, value.c_str(), value.length()); }
+
+  uint8_t getUChar(const char *key, uint8_t defaultValue = 0) { return getValue(key, defaultValue); }
+  uint16_t getUShort(const char *key, uint16_t defaultValue = 0) { return getValue(key, defaultValue); }
+  int32_t getInt(const char *key, int32_t defaultValue = 0) { return getValue(key, defaultValue); }
+  uint32_t getUInt(const char *key, uint32_t defaultValue = 0) { return getValue(key, defaultValue); }
+  int32_t getLong(const char *key, int32_t defaultValue = 0) { return getValue(key, defaultValue); }
+  uint32_t getULong(const char *key, uint32_t defaultValue = 0) { return getValue(key, defaultValue); }
+  bool getBool(const char *key, bool defaultValue = false) { return getUChar(key, defaultValue ? 1 : 0) != 0; }
+  String getString(const char *key, const String &defaultValue = String());
+
+private:
+  template <typename T>
+  T getValue(const char *key, T defaultValue)
+  {
+    T value;
+    return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+  }
+  String path(const char *key);
+
+  bool _started;
+  bool _readOnly;
+  String _dir;
+};
+
+#endif // _PREFERENCES_H_
@@ -0,0 +1,74 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Print.h"
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  size_t n = 0;
+  while (size--)
+  {
+    n += write(*buffer++);
+  }
+  return n;
+}
+
+size_t Print::printf(const char *format, ...)
+{
+  char loc_buf[64];
+  char *temp = loc_buf;
+  va_list arg;
+  va_list copy;
+  va_start(arg, format);
+  va_copy(copy, arg);
+  int len = vsnprintf(temp, sizeof(loc_buf), format, copy);
+  va_end(copy);
+  if (len < 0)
+  {
+    va_end(arg);
+    return 0;
+  }
+  if (len >= (int)sizeof(loc_buf))
+  {
+    temp = (char *)malloc(len + 1);
+    if (temp == NULL)
+    {
+      va_end(arg);
+      return 0;
+    }
+    len = vsnprintf(temp, len + 1, format, arg);
+  }
+  va_end(arg);
+  len = write((uint8_t *)temp, len);
+  if (temp != loc_buf)
+  {
+    free(temp);
+  }
+  return len;
+}
+
+size_t Print::print(const __FlashStringHelper *ifsh) { return print(reinterpret_cast<const char *>(ifsh)); }
+size_t Print::print(const String &s) { return write(s.c_str(), s.length()); }
+size_t Print::print(const char str[]) { return write(str); }
+size_t Print::print(char c) { return write((uint8_t)c); }
+size_t Print::print(unsigned char b, int base) { return print(String(b, (unsigned char)base)); }
+size_t Print::print(int n, int base) { return print(String(n, (unsigned char)base)); }
+size_t Print::print(unsigned int n, int base) { return print(String(n, (unsigned char)base)); }
+size_t Print::print(long n, int base) { return print(String(n, (unsigned char)base)); }
+size_t Print::print(unsigned long n, int base) { return print(String(n, (unsigned char)base)); }
+size_t Print::print(double n, int digits) { return print(String(n, (unsigned int)digits)); }
+size_t Print::print(const Printable &x) { return x.printTo(*this); }
+
+size_t Print::println(void) { return print("\r\n"); }
+size_t Print::println(const __FlashStringHelper *ifsh) { return print(ifsh) + println(); }
+size_t Print::println(const String &s) { return print(s) + println(); }
+size_t Print::println(const char c[]) { return print(c) + println(); }
+size_t Print::println(char c) { return print(c) + println(); }
+size_t Print::println(unsigned char b, int base) { return print(b, base) + println(); }
+size_t Print::println(int num, int base) { return print(num, base) + println(); }
+size_t Print::println(unsigned int num, int base) { return print(num, base) + println(); }
+size_t Print::println(long num, int base) { return print(num, base) + println(); }
+size_t Print::println(unsigned long num, int base) { return print(num, base) + println(); }
+size_t Print::println(double num, int digits) { return print(num, digits) + println(); }
+size_t Print::println(const Printable &x) { return print(x) + println(); }
@@ -0,0 +1,102 @@
+#include "Arduino.h"
+#include "Stream.h"
+
+int Stream::timedRead()
+{
+  unsigned long start = millis();
+  do
+  {
+    int c = read();
+    if (c >= 0)
+      return c;
+    delay(1);
+  } while (millis() - start < _timeout);
+  return -1;
+}
+
+int Stream::timedPeek()
+{
+  unsigned long start = millis();
+  do
+  {
+    int c = peek();
+    if (c >= 0)
+      return c;
+    delay(1);
+  } while (millis() - start < _timeout);
+  return -1;
+}
+
+bool Stream::find(const char *target)
+{
+  size_t len = strlen(target);
+  size_t index = 0;
+  if (!len)
+    return true;
+  int c;
+  while ((c = timedRead()) >= 0)
+  {
+    if (c == target[index])
+    {
+      if (++index >= len)
+        return true;
+    }
+    else
+    {
+      index = (c == target[0]) ? 1 : 0;
+    }
+  }
+  return false;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length)
+{
+  size_t count = 0;
+  while (count < length)
+  {
+    int c = timedRead();
+    if (c < 0)
+      break;
+    *buffer++ = (char)c;
+    count++;
+  }
+  return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length)
+{
+  size_t index = 0;
+  while (index < length)
+  {
+    int c = timedRead();
+    if (c < 0 || c == terminator)
+      break;
+    *buffer++ = (char)c;
+    index++;
+  }
+  return index;
+}
+
+String Stream::readString()
+{
+  String ret;
+  int c = timedRead();
+  while (c >= 0)
+  {
+    ret += (char)c;
+    c = timedRead();
+  }
+  return ret;
+}
+
+String Stream::readStringUntil(char terminator)
+{
+  String ret;
+  int c = timedRead();
+  while (c >= 0 && c != terminator)
+  {
+    ret += (char)c;
+    c = timedRead();
+  }
+  return ret;
+}
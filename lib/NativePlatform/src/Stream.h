@@ -0,0 +1,32 @@
+/*
+  Stream.h - Arduino Stream for the host build.
+*/
+#ifndef Stream_h
+#define Stream_h
+
+#include "Print.h"
+
+class Stream : public Print
+{
+protected:
+  unsigned long _timeout = 1000;
+  int timedRead();
+  int timedPeek();
+
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout) { _timeout = timeout; }
+  unsigned long getTimeout(void) { return _timeout; }
+
+  bool find(const char *target);
+  virtual size_t readBytes(char *buffer, size_t length);
+  virtual size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+  size_t readBytesUntil(char terminator, char *buffer, size_t length);
+  virtual String readString();
+  String readStringUntil(char terminator);
+};
+
+#endif // Stream_h
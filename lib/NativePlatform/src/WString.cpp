@@ -0,0 +1,185 @@
+#include "WString.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static std::string formatInteger(unsigned long long value, bool negative, unsigned char base)
+{
+  if (base < 2 || base > 36)
+    base = 10;
+  char buf[72];
+  char *p = buf + sizeof(buf) - 1;
+  *p = 0;
+  do
+  {
+    unsigned digit = value % base;
+    *--p = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    value /= base;
+  } while (value);
+  if (negative)
+    *--p = '-';
+  return std::string(p);
+}
+
+String::String(unsigned char value, unsigned char base) : _s(formatInteger(value, false, base)) {}
+String::String(int value, unsigned char base)
+    : _s(base == 10 && value < 0 ? formatInteger(-(long long)value, true, base) : formatInteger((unsigned int)value, false, base)) {}
+String::String(unsigned int value, unsigned char base) : _s(formatInteger(value, false, base)) {}
+String::String(long value, unsigned char base)
+    : _s(base == 10 && value < 0 ? formatInteger(-(long long)value, true, base) : formatInteger((unsigned long)value, false, base)) {}
+String::String(unsigned long value, unsigned char base) : _s(formatInteger(value, false, base)) {}
+
+String::String(float value, unsigned int decimalPlaces)
+{
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", decimalPlaces, (double)value);
+  _s = buf;
+}
+
+String::String(double value, unsigned int decimalPlaces)
+{
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", decimalPlaces, value);
+  _s = buf;
+}
+
+bool String::equalsIgnoreCase(const String &s) const
+{
+  if (_s.length() != s._s.length())
+    return false;
+  for (size_t i = 0; i < _s.length(); i++)
+  {
+    if (tolower((unsigned char)_s[i]) != tolower((unsigned char)s._s[i]))
+      return false;
+  }
+  return true;
+}
+
+bool String::equalsConstantTime(const String &s) const
+{
+  if (_s.length() != s._s.length())
+    return false;
+  unsigned char diff = 0;
+  for (size_t i = 0; i < _s.length(); i++)
+    diff |= _s[i] ^ s._s[i];
+  return diff == 0;
+}
+
+bool String::startsWith(const String &prefix, unsigned int offset) const
+{
+  if (offset > _s.length() || prefix._s.length() > _s.length() - offset)
+    return false;
+  return _s.compare(offset, prefix._s.length(), prefix._s) == 0;
+}
+
+bool String::endsWith(const String &suffix) const
+{
+  if (suffix._s.length() > _s.length())
+    return false;
+  return _s.compare(_s.length() - suffix._s.length(), suffix._s.length(), suffix._s) == 0;
+}
+
+void String::getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index) const
+{
+  if (!bufsize || !buf)
+    return;
+  if (index >= _s.length())
+  {
+    buf[0] = 0;
+    return;
+  }
+  unsigned int n = std::min<unsigned int>(bufsize - 1, _s.length() - index);
+  memcpy(buf, _s.data() + index, n);
+  buf[n] = 0;
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const
+{
+  size_t pos = _s.find(ch, fromIndex);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String &str, unsigned int fromIndex) const
+{
+  size_t pos = _s.find(str._s, fromIndex);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char ch) const
+{
+  size_t pos = _s.rfind(ch);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(const String &str) const
+{
+  size_t pos = _s.rfind(str._s);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int left, unsigned int right) const
+{
+  if (left > right)
+    std::swap(left, right);
+  if (left >= _s.length())
+    return String();
+  if (right > _s.length())
+    right = _s.length();
+  return String(_s.data() + left, right - left);
+}
+
+void String::replace(char find, char replace)
+{
+  for (char &c : _s)
+  {
+    if (c == find)
+      c = replace;
+  }
+}
+
+void String::replace(const String &find, const String &replace)
+{
+  if (find._s.empty())
+    return;
+  size_t pos = 0;
+  while ((pos = _s.find(find._s, pos)) != std::string::npos)
+  {
+    _s.replace(pos, find._s.length(), replace._s);
+    pos += replace._s.length();
+  }
+}
+
+void String::remove(unsigned int index, unsigned int count)
+{
+  if (index >= _s.length())
+    return;
+  _s.erase(index, count);
+}
+
+void String::toLowerCase()
+{
+  for (char &c : _s)
+    c = tolower((unsigned char)c);
+}
+
+void String::toUpperCase()
+{
+  for (char &c : _s)
+    c = toupper((unsigned char)c);
+}
+
+void String::trim()
+{
+  size_t b = 0;
+  while (b < _s.length() && isspace((unsigned char)_s[b]))
+    b++;
+  size_t e = _s.length();
+  while (e > b && isspace((unsigned char)_s[e - 1]))
+    e--;
+  _s = _s.substr(b, e - b);
+}
+
+long String::toInt() const { return atol(_s.c_str()); }
+float String::toFloat() const { return (float)atof(_s.c_str()); }
+double String::toDouble() const { return atof(_s.c_str()); }
@@ -0,0 +1,187 @@
+/*
+  WString.h - Arduino String for the host build, backed by std::string.
+*/
+#ifndef WString_h
+#define WString_h
+
+#include <stdint.h>
+#include <string>
+
+class __FlashStringHelper;
+class StringSumHelper;
+
+class String
+{
+public:
+  String(const char *cstr = "") : _s(cstr ? cstr : "") {}
+  String(const char *cstr, unsigned int length) : _s(cstr, length) {}
+  String(const String &str) = default;
+  String(String &&rval) = default;
+  String(const __FlashStringHelper *str) : _s(reinterpret_cast<const char *>(str)) {}
+  explicit String(char c) : _s(1, c) {}
+  explicit String(unsigned char value, unsigned char base = 10);
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(float value, unsigned int decimalPlaces = 2);
+  explicit String(double value, unsigned int decimalPlaces = 2);
+  ~String() {}
+
+  bool reserve(unsigned int size)
+  {
+    _s.reserve(size);
+    return true;
+  }
+  unsigned int length() const { return _s.length(); }
+  bool isEmpty() const { return _s.empty(); }
+
+  String &operator=(const String &rhs) = default;
+  String &operator=(String &&rval) = default;
+  String &operator=(const char *cstr)
+  {
+    _s = cstr ? cstr : "";
+    return *this;
+  }
+  String &operator=(const __FlashStringHelper *str)
+  {
+    _s = reinterpret_cast<const char *>(str);
+    return *this;
+  }
+
+  bool concat(const String &str)
+  {
+    _s += str._s;
+    return true;
+  }
+  bool concat(const char *cstr)
+  {
+    if (!cstr)
+      return false;
+    _s += cstr;
+    return true;
+  }
+  bool concat(const char *cstr, unsigned int length)
+  {
+    _s.append(cstr, length);
+    return true;
+  }
+  bool concat(char c)
+  {
+    _s += c;
+    return true;
+  }
+  bool concat(unsigned char num) { return concat(String(num)); }
+  bool concat(int num) { return concat(String(num)); }
+  bool concat(unsigned int num) { return concat(String(num)); }
+  bool concat(long num) { return concat(String(num)); }
+  bool concat(unsigned long num) { return concat(String(num)); }
+  bool concat(float num) { return concat(String(num)); }
+  bool concat(double num) { return concat(String(num)); }
+  bool concat(const __FlashStringHelper *str) { return concat(reinterpret_cast<const char *>(str)); }
+
+  template <typename T>
+  String &operator+=(const T &rhs)
+  {
+    concat(rhs);
+    return *this;
+  }
+
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, const String &rhs);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, const char *rhs);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, char rhs);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, const __FlashStringHelper *rhs);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, int rhs);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, unsigned int rhs);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, long rhs);
+  friend StringSumHelper &operator+(const StringSumHelper &lhs, unsigned long rhs);
+
+  int compareTo(const String &s) const { return _s.compare(s._s); }
+  bool equals(const String &s) const { return _s == s._s; }
+  bool equals(const char *cstr) const { return _s == (cstr ? cstr : ""); }
+  bool operator==(const String &rhs) const { return equals(rhs); }
+  bool operator==(const char *cstr) const { return equals(cstr); }
+  bool operator!=(const String &rhs) const { return !equals(rhs); }
+  bool operator!=(const char *cstr) const { return !equals(cstr); }
+  bool operator<(const String &rhs) const { return _s < rhs._s; }
+  bool operator>(const String &rhs) const { return _s > rhs._s; }
+  bool equalsIgnoreCase(const String &s) const;
+  bool equalsConstantTime(const String &s) const;
+  bool startsWith(const String &prefix) const { return startsWith(prefix, 0); }
+  bool startsWith(const String &prefix, unsigned int offset) const;
+  bool endsWith(const String &suffix) const;
+
+  char charAt(unsigned int index) const { return index < _s.length() ? _s[index] : 0; }
+  void setCharAt(unsigned int index, char c)
+  {
+    if (index < _s.length())
+      _s[index] = c;
+  }
+  char operator[](unsigned int index) const { return charAt(index); }
+  char &operator[](unsigned int index) { return _s[index]; }
+  void getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index = 0) const;
+  void toCharArray(char *buf, unsigned int bufsize, unsigned int index = 0) const
+  {
+    getBytes((unsigned char *)buf, bufsize, index);
+  }
+  const char *c_str() const { return _s.c_str(); }
+  char *begin() { return &_s[0]; }
+  char *end() { return &_s[0] + _s.length(); }
+
+  int indexOf(char ch) const { return indexOf(ch, 0); }
+  int indexOf(char ch, unsigned int fromIndex) const;
+  int indexOf(const String &str) const { return indexOf(str, 0); }
+  int indexOf(const String &str, unsigned int fromIndex) const;
+  int lastIndexOf(char ch) const;
+  int lastIndexOf(const String &str) const;
+  String substring(unsigned int beginIndex) const { return substring(beginIndex, _s.length()); }
+  String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+  void replace(char find, char replace);
+  void replace(const String &find, const String &replace);
+  void remove(unsigned int index) { remove(index, (unsigned int)-1); }
+  void remove(unsigned int index, unsigned int count);
+  void toLowerCase();
+  void toUpperCase();
+  void trim();
+
+  long toInt() const;
+  float toFloat() const;
+  double toDouble() const;
+
+private:
+  std::string _s;
+};
+
+// As in the Arduino core, concatenation returns an lvalue so the result can
+// bind to the String& parameters the libraries take.
+class StringSumHelper : public String
+{
+public:
+  StringSumHelper(const String &s) : String(s) {}
+  StringSumHelper(const char *p) : String(p) {}
+  StringSumHelper(char c) : String(c) {}
+  StringSumHelper(int num) : String(num) {}
+  StringSumHelper(unsigned int num) : String(num) {}
+  StringSumHelper(long num) : String(num) {}
+  StringSumHelper(unsigned long num) : String(num) {}
+};
+
+#define STRING_SUM_OPERATOR(type)                                            \
+  inline StringSumHelper &operator+(const StringSumHelper &lhs, type rhs)  \
+  {                                                                          \
+    StringSumHelper &a = const_cast<StringSumHelper &>(lhs);                 \
+    a.concat(rhs);                                                           \
+    return a;                                                                \
+  }
+STRING_SUM_OPERATOR(const String &)
+STRING_SUM_OPERATOR(const char *)
+STRING_SUM_OPERATOR(char)
+STRING_SUM_OPERATOR(const __FlashStringHelper *)
+STRING_SUM_OPERATOR(int)
+STRING_SUM_OPERATOR(unsigned int)
+STRING_SUM_OPERATOR(long)
+STRING_SUM_OPERATOR(unsigned long)
+#undef STRING_SUM_OPERATOR
+
+#endif // WString_h
@@ -0,0 +1,248 @@
+#include <netdb.h>
+#include <unistd.h>
+#include <vector>
+
+#include "WiFi.h"
+#include "Preferences.h"
+#include "freertos/event_groups.h"
+
+WiFiClass WiFi;
+
+struct EventHandler
+{
+  wifi_event_id_t id;
+  WiFiEventCb cb;
+  WiFiEventFuncCb fcb;
+  arduino_event_id_t event;
+};
+
+static std::vector<EventHandler> handlers;
+static wifi_event_id_t nextEventId = 1;
+static wifi_mode_t currentMode = WIFI_MODE_NULL;
+static wl_status_t currentStatus = WL_DISCONNECTED;
+static String currentSsid;
+static String currentHostname = "native";
+static uint8_t currentBssid[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+static int32_t currentChannel = 1;
+static IPAddress staticIp;
+static EventGroupHandle_t statusBits = NULL;
+
+static EventGroupHandle_t bits()
+{
+  if (!statusBits)
+    statusBits = xEventGroupCreate();
+  return statusBits;
+}
+
+void WiFiClass::_post(arduino_event_id_t event)
+{
+  arduino_event_info_t info;
+  memset(&info, 0, sizeof(info));
+  if (event == ARDUINO_EVENT_WIFI_STA_CONNECTED)
+  {
+    memcpy(info.wifi_sta_connected.bssid, currentBssid, 6);
+    info.wifi_sta_connected.channel = currentChannel;
+  }
+  std::vector<EventHandler> snapshot = handlers;
+  for (auto &h : snapshot)
+  {
+    if (h.event != ARDUINO_EVENT_MAX && h.event != event)
+      continue;
+    if (h.cb)
+      h.cb(event);
+    if (h.fcb)
+      h.fcb(event, info);
+  }
+}
+
+bool WiFiClass::mode(wifi_mode_t mode)
+{
+  currentMode = mode;
+  if (mode & WIFI_MODE_STA)
+    xEventGroupSetBits(bits(), STA_STARTED_BIT);
+  return true;
+}
+
+wifi_mode_t WiFiClass::getMode()
+{
+  return currentMode;
+}
+
+wl_status_t WiFiClass::begin(const char *ssid, const char *passphrase, int32_t channel, const uint8_t *bssid,
+                             bool connect)
+{
+  (void)passphrase;
+  currentSsid = ssid ? ssid : "";
+  if (channel)
+    currentChannel = channel;
+  if (bssid)
+    memcpy(currentBssid, bssid, 6);
+  if (!connect)
+    return currentStatus;
+  const char *down = getenv("NATIVE_LINK_DOWN");
+  if (down && access(down, F_OK) == 0)
+  {
+    simulateLinkLoss();
+    return currentStatus;
+  }
+  currentStatus = WL_CONNECTED;
+  xEventGroupSetBits(bits(), STA_CONNECTED_BIT | STA_HAS_IP_BIT);
+  _post(ARDUINO_EVENT_WIFI_STA_CONNECTED);
+  _post(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+  return currentStatus;
+}
+
+bool WiFiClass::config(IPAddress local_ip, IPAddress gateway, IPAddress subnet, IPAddress dns1, IPAddress dns2)
+{
+  (void)gateway;
+  (void)subnet;
+  (void)dns1;
+  (void)dns2;
+  staticIp = local_ip;
+  return true;
+}
+
+// Same NVS layout idea as the firmware: remember the SSID that connected
+wl_status_t WiFiClass::beginFast(const char *ssid, const char *passphrase, uint32_t timeout_ms, bool reuseLease)
+{
+  (void)reuseLease;
+  Preferences prefs;
+  prefs.begin("wifi_fast", false);
+  _fastConnected = prefs.getString("ssid") == ssid;
+  begin(ssid, passphrase);
+  if (!waitStatusBits(STA_HAS_IP_BIT, timeout_ms))
+  {
+    _fastConnected = false;
+    return currentStatus;
+  }
+  if (!_fastConnected)
+    prefs.putString("ssid", ssid);
+  return currentStatus;
+}
+
+void WiFiClass::forgetFast()
+{
+  Preferences prefs;
+  prefs.begin("wifi_fast", false);
+  prefs.remove("ssid");
+}
+
+bool WiFiClass::reconnect()
+{
+  begin(currentSsid.c_str());
+  return true;
+}
+
+bool WiFiClass::disconnect(bool wifioff, bool eraseap)
+{
+  (void)eraseap;
+  simulateLinkLoss();
+  if (wifioff)
+    currentMode = WIFI_MODE_NULL;
+  return true;
+}
+
+wl_status_t WiFiClass::status()
+{
+  return currentStatus;
+}
+
+uint8_t WiFiClass::waitForConnectResult(unsigned long timeoutLength)
+{
+  (void)timeoutLength;
+  return currentStatus;
+}
+
+IPAddress WiFiClass::localIP()
+{
+  if (currentStatus != WL_CONNECTED)
+    return IPAddress();
+  return (uint32_t)staticIp ? staticIp : IPAddress(127, 0, 0, 1);
+}
+
+IPAddress WiFiClass::gatewayIP() { return IPAddress(127, 0, 0, 1); }
+IPAddress WiFiClass::subnetMask() { return IPAddress(255, 0, 0, 0); }
+IPAddress WiFiClass::dnsIP(uint8_t dns_no)
+{
+  (void)dns_no;
+  return IPAddress(127, 0, 0, 53);
+}
+String WiFiClass::macAddress() { return String("02:00:00:00:00:02"); }
+String WiFiClass::SSID() const { return currentSsid; }
+uint8_t *WiFiClass::BSSID() { return currentBssid; }
+
+String WiFiClass::BSSIDstr()
+{
+  char mac[18];
+  snprintf(mac, sizeof(mac), "%02X:%02X:%02X:%02X:%02X:%02X", currentBssid[0], currentBssid[1], currentBssid[2],
+           currentBssid[3], currentBssid[4], currentBssid[5]);
+  return String(mac);
+}
+
+int32_t WiFiClass::channel() { return currentChannel; }
+int8_t WiFiClass::RSSI() { return currentStatus == WL_CONNECTED ? -50 : 0; }
+
+const char *WiFiClass::getHostname() { return currentHostname.c_str(); }
+
+bool WiFiClass::setHostname(const char *hostname)
+{
+  currentHostname = hostname;
+  return true;
+}
+
+int WiFiClass::hostByName(const char *aHostname, IPAddress &aResult)
+{
+  struct hostent *he = gethostbyname(aHostname);
+  if (!he)
+    return 0;
+  aResult = IPAddress(*(uint32_t *)he->h_addr_list[0]);
+  return 1;
+}
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventCb cbEvent, arduino_event_id_t event)
+{
+  handlers.push_back({nextEventId, cbEvent, NULL, event});
+  return nextEventId++;
+}
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventFuncCb cbEvent, arduino_event_id_t event)
+{
+  handlers.push_back({nextEventId, NULL, cbEvent, event});
+  return nextEventId++;
+}
+
+void WiFiClass::removeEvent(wifi_event_id_t id)
+{
+  for (auto it = handlers.begin(); it != handlers.end(); ++it)
+  {
+    if (it->id == id)
+    {
+      handlers.erase(it);
+      return;
+    }
+  }
+}
+
+int WiFiClass::getStatusBits()
+{
+  return xEventGroupGetBits(bits());
+}
+
+int WiFiClass::waitStatusBits(int bitsToWait, uint32_t timeout_ms)
+{
+  return xEventGroupWaitBits(bits(), bitsToWait, pdFALSE, pdTRUE, timeout_ms) & bitsToWait;
+}
+
+void WiFiClass::simulateLinkLoss()
+{
+  if (currentStatus != WL_CONNECTED)
+    return;
+  currentStatus = WL_CONNECTION_LOST;
+  xEventGroupClearBits(bits(), STA_CONNECTED_BIT | STA_HAS_IP_BIT);
+  _post(ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+}
+
+void WiFiClass::simulateLinkRestore()
+{
+  begin(currentSsid.c_str());
+}
@@ -0,0 +1,124 @@
+/*
+  WiFi.h - host build WiFi: the station associates at once and the
+  sockets are plain POSIX sockets on the host network stack. While the
+  file named by $NATIVE_LINK_DOWN exists the link is down: association
+  fails and the probe in ESP32Ping gets no answer.
+*/
+#ifndef WiFi_h
+#define WiFi_h
+
+#include <functional>
+
+#include "Arduino.h"
+#include "IPAddress.h"
+#include "WiFiType.h"
+#include "WiFiClient.h"
+#include "WiFiServer.h"
+#include "WiFiUdp.h"
+
+typedef enum
+{
+  ARDUINO_EVENT_WIFI_READY = 0,
+  ARDUINO_EVENT_WIFI_SCAN_DONE,
+  ARDUINO_EVENT_WIFI_STA_START,
+  ARDUINO_EVENT_WIFI_STA_STOP,
+  ARDUINO_EVENT_WIFI_STA_CONNECTED,
+  ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+  ARDUINO_EVENT_WIFI_STA_AUTHMODE_CHANGE,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP6,
+  ARDUINO_EVENT_WIFI_STA_LOST_IP,
+  ARDUINO_EVENT_MAX = 40
+} arduino_event_id_t;
+
+typedef struct
+{
+  uint8_t bssid[6];
+  uint8_t channel;
+} native_sta_connected_t;
+
+typedef struct
+{
+  uint8_t reason;
+} native_sta_disconnected_t;
+
+typedef union {
+  native_sta_connected_t wifi_sta_connected;
+  native_sta_disconnected_t wifi_sta_disconnected;
+} arduino_event_info_t;
+
+typedef size_t wifi_event_id_t;
+typedef void (*WiFiEventCb)(arduino_event_id_t event);
+typedef std::function<void(arduino_event_id_t event, arduino_event_info_t info)> WiFiEventFuncCb;
+
+static const int STA_STARTED_BIT = BIT3;
+static const int STA_CONNECTED_BIT = BIT4;
+static const int STA_HAS_IP_BIT = BIT5;
+
+class WiFiClass
+{
+public:
+  static bool mode(wifi_mode_t mode);
+  static wifi_mode_t getMode();
+  wl_status_t begin(const char *ssid, const char *passphrase = NULL, int32_t channel = 0,
+                    const uint8_t *bssid = NULL, bool connect = true);
+  bool config(IPAddress local_ip, IPAddress gateway, IPAddress subnet, IPAddress dns1 = (uint32_t)0,
+              IPAddress dns2 = (uint32_t)0);
+  wl_status_t beginFast(const char *ssid, const char *passphrase, uint32_t timeout_ms = 10000, bool reuseLease = true);
+  void forgetFast();
+  bool fastConnected() const { return _fastConnected; }
+  bool reconnect();
+  bool disconnect(bool wifioff = false, bool eraseap = false);
+  bool isConnected() { return status() == WL_CONNECTED; }
+  bool setAutoReconnect(bool autoReconnect)
+  {
+    _autoReconnect = autoReconnect;
+    return true;
+  }
+  bool getAutoReconnect() { return _autoReconnect; }
+  bool setSleep(bool enabled)
+  {
+    (void)enabled;
+    return true;
+  }
+  static wl_status_t status();
+  uint8_t waitForConnectResult(unsigned long timeoutLength = 60000);
+
+  IPAddress localIP();
+  IPAddress gatewayIP();
+  IPAddress subnetMask();
+  IPAddress dnsIP(uint8_t dns_no = 0);
+  String macAddress();
+  String SSID() const;
+  uint8_t *BSSID();
+  String BSSIDstr();
+  int32_t channel();
+  int8_t RSSI();
+
+  static const char *getHostname();
+  static bool setHostname(const char *hostname);
+  static bool hostname(const String &aHostname) { return setHostname(aHostname.c_str()); }
+  static int hostByName(const char *aHostname, IPAddress &aResult);
+
+  wifi_event_id_t onEvent(WiFiEventCb cbEvent, arduino_event_id_t event = ARDUINO_EVENT_MAX);
+  wifi_event_id_t onEvent(WiFiEventFuncCb cbEvent, arduino_event_id_t event = ARDUINO_EVENT_MAX);
+  void removeEvent(wifi_event_id_t id);
+
+  static int getStatusBits();
+  static int waitStatusBits(int bits, uint32_t timeout_ms);
+
+  /*
+   * Host-only: simulate the access point going away and coming back.
+   */
+  void simulateLinkLoss();
+  bool _fastConnected = false;
+  void simulateLinkRestore();
+
+private:
+  void _post(arduino_event_id_t event);
+  bool _autoReconnect = true;
+};
+
+extern WiFiClass WiFi;
+
+#endif // WiFi_h
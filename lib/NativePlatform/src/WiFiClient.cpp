@@ -0,0 +1,328 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "WiFiClient.h"
+
+#define WIFI_CLIENT_DEF_CONN_TIMEOUT_MS (3000)
+#define WIFI_CLIENT_SELECT_TIMEOUT_US (1000000)
+
+class WiFiClientSocketHandle
+{
+public:
+  explicit WiFiClientSocketHandle(int fd) : sockfd(fd), peeked(-1) {}
+  ~WiFiClientSocketHandle() { close(sockfd); }
+  int sockfd;
+  int peeked;
+};
+
+WiFiClient::WiFiClient() : _connected(false), _timeout(WIFI_CLIENT_DEF_CONN_TIMEOUT_MS) {}
+
+WiFiClient::WiFiClient(int fd) : _connected(true), _timeout(WIFI_CLIENT_DEF_CONN_TIMEOUT_MS)
+{
+  clientSocketHandle.reset(new WiFiClientSocketHandle(fd));
+}
+
+WiFiClient::~WiFiClient() {}
+
+void WiFiClient::stop()
+{
+  clientSocketHandle = NULL;
+  _connected = false;
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port)
+{
+  return connect(ip, port, _timeout);
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port, int32_t timeout)
+{
+  int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+  if (sockfd < 0)
+    return 0;
+  fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL, 0) | O_NONBLOCK);
+  struct sockaddr_in serveraddr;
+  memset(&serveraddr, 0, sizeof(serveraddr));
+  serveraddr.sin_family = AF_INET;
+  serveraddr.sin_addr.s_addr = (uint32_t)ip;
+  serveraddr.sin_port = htons(port);
+  int res = ::connect(sockfd, (struct sockaddr *)&serveraddr, sizeof(serveraddr));
+  if (res < 0 && errno != EINPROGRESS)
+  {
+    close(sockfd);
+    return 0;
+  }
+  struct pollfd pfd = {sockfd, POLLOUT, 0};
+  if (poll(&pfd, 1, timeout) <= 0)
+  {
+    close(sockfd);
+    return 0;
+  }
+  int err = 0;
+  socklen_t len = sizeof(err);
+  getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &err, &len);
+  if (err)
+  {
+    close(sockfd);
+    return 0;
+  }
+  clientSocketHandle.reset(new WiFiClientSocketHandle(sockfd));
+  _connected = true;
+  return 1;
+}
+
+int WiFiClient::connect(const char *host, uint16_t port)
+{
+  return connect(host, port, _timeout);
+}
+
+int WiFiClient::connect(const char *host, uint16_t port, int32_t timeout)
+{
+  struct hostent *he = gethostbyname(host);
+  if (!he)
+    return 0;
+  return connect(IPAddress(*(uint32_t *)he->h_addr_list[0]), port, timeout);
+}
+
+int WiFiClient::setSocketOption(int level, int option, const void *value, size_t len)
+{
+  return setsockopt(fd(), level, option, value, len);
+}
+
+int WiFiClient::setTimeout(uint32_t seconds)
+{
+  Stream::setTimeout(seconds * 1000);
+  return 0;
+}
+
+int WiFiClient::setNoDelay(bool nodelay)
+{
+  int flag = nodelay;
+  return setSocketOption(IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(int));
+}
+
+size_t WiFiClient::write(uint8_t data)
+{
+  return write(&data, 1);
+}
+
+size_t WiFiClient::write(const uint8_t *buf, size_t size)
+{
+  if (!_connected || !clientSocketHandle)
+    return 0;
+  size_t totalBytesSent = 0;
+  unsigned long start = millis();
+  while (size > 0)
+  {
+    ssize_t res = send(fd(), buf, size, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (res > 0)
+    {
+      buf += res;
+      size -= res;
+      totalBytesSent += res;
+      continue;
+    }
+    if (res < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    {
+      if (millis() - start > 5000)
+        break;
+      struct pollfd pfd = {fd(), POLLOUT, 0};
+      poll(&pfd, 1, 10);
+      continue;
+    }
+    _connected = false;
+    break;
+  }
+  return totalBytesSent;
+}
+
+size_t WiFiClient::writev(struct iovec *iov, int iovcnt)
+{
+  if (!_connected || !clientSocketHandle)
+    return 0;
+  size_t totalBytesSent = 0;
+  unsigned long start = millis();
+  while (iovcnt > 0)
+  {
+    struct msghdr msg = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+    ssize_t res = sendmsg(fd(), &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (res > 0)
+    {
+      totalBytesSent += res;
+      size_t sent = res;
+      while (iovcnt && sent >= iov->iov_len)
+      {
+        sent -= iov->iov_len;
+        iov++;
+        iovcnt--;
+      }
+      if (iovcnt)
+      {
+        iov->iov_base = (uint8_t *)iov->iov_base + sent;
+        iov->iov_len -= sent;
+      }
+      continue;
+    }
+    if (res < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    {
+      if (millis() - start > 5000)
+        break;
+      struct pollfd pfd = {fd(), POLLOUT, 0};
+      poll(&pfd, 1, 10);
+      continue;
+    }
+    _connected = false;
+    break;
+  }
+  return totalBytesSent;
+}
+
+int WiFiClient::availableForWrite()
+{
+  if (!_connected || !clientSocketHandle)
+    return 0;
+  int size = 0, queued = 0;
+  socklen_t len = sizeof(size);
+  if (getsockopt(fd(), SOL_SOCKET, SO_SNDBUF, &size, &len) < 0 || ioctl(fd(), TIOCOUTQ, &queued) < 0)
+    return 0;
+  // The kernel doubles SO_SNDBUF for its own bookkeeping
+  return std::max(size / 2 - queued, 0);
+}
+
+size_t WiFiClient::write(Stream &stream)
+{
+  uint8_t buf[1436];
+  size_t written = 0;
+  while (stream.available())
+  {
+    size_t n = stream.readBytes(buf, std::min<size_t>(sizeof(buf), stream.available()));
+    if (!n)
+      break;
+    written += write(buf, n);
+  }
+  return written;
+}
+
+int WiFiClient::read()
+{
+  uint8_t data;
+  return read(&data, 1) == 1 ? data : -1;
+}
+
+int WiFiClient::read(uint8_t *buf, size_t size)
+{
+  if (!clientSocketHandle || !size)
+    return -1;
+  size_t got = 0;
+  if (clientSocketHandle->peeked >= 0)
+  {
+    buf[got++] = clientSocketHandle->peeked;
+    clientSocketHandle->peeked = -1;
+    if (got == size)
+      return got;
+  }
+  ssize_t res = recv(fd(), buf + got, size - got, MSG_DONTWAIT);
+  if (res > 0)
+    return got + res;
+  if (res == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+    _connected = false;
+  return got ? (int)got : -1;
+}
+
+int WiFiClient::peek()
+{
+  if (!clientSocketHandle)
+    return -1;
+  if (clientSocketHandle->peeked < 0)
+  {
+    uint8_t data;
+    if (recv(fd(), &data, 1, MSG_DONTWAIT) == 1)
+      clientSocketHandle->peeked = data;
+  }
+  return clientSocketHandle->peeked;
+}
+
+int WiFiClient::available()
+{
+  if (!_connected || !clientSocketHandle)
+    return 0;
+  int count = 0;
+  if (ioctl(fd(), FIONREAD, &count) < 0)
+    return 0;
+  return count + (clientSocketHandle->peeked >= 0 ? 1 : 0);
+}
+
+void WiFiClient::flush()
+{
+  // Discard anything unread, like the lwIP client does
+  uint8_t buf[256];
+  while (available() > 0 && read(buf, sizeof(buf)) > 0)
+    ;
+}
+
+uint8_t WiFiClient::connected()
+{
+  if (_connected && clientSocketHandle)
+  {
+    uint8_t dummy;
+    ssize_t res = recv(fd(), &dummy, 1, MSG_DONTWAIT | MSG_PEEK);
+    if (res == 0)
+      _connected = false;
+    else if (res < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+      _connected = false;
+  }
+  return _connected;
+}
+
+int WiFiClient::fd() const
+{
+  return clientSocketHandle ? clientSocketHandle->sockfd : -1;
+}
+
+bool WiFiClient::operator==(const WiFiClient &rhs)
+{
+  return clientSocketHandle == rhs.clientSocketHandle;
+}
+
+static bool peerOrLocal(int fd, bool peer, struct sockaddr_in &addr)
+{
+  socklen_t len = sizeof(addr);
+  memset(&addr, 0, sizeof(addr));
+  if (fd < 0)
+    return false;
+  return (peer ? getpeername(fd, (struct sockaddr *)&addr, &len) : getsockname(fd, (struct sockaddr *)&addr, &len)) == 0;
+}
+
+IPAddress WiFiClient::remoteIP() const
+{
+  struct sockaddr_in addr;
+  return peerOrLocal(fd(), true, addr) ? IPAddress((uint32_t)addr.sin_addr.s_addr) : IPAddress();
+}
+
+uint16_t WiFiClient::remotePort() const
+{
+  struct sockaddr_in addr;
+  return peerOrLocal(fd(), true, addr) ? ntohs(addr.sin_port) : 0;
+}
+
+IPAddress WiFiClient::localIP() const
+{
+  struct sockaddr_in addr;
+  return peerOrLocal(fd(), false, addr) ? IPAddress((uint32_t)addr.sin_addr.s_addr) : IPAddress();
+}
+
+uint16_t WiFiClient::localPort() const
+{
+  struct sockaddr_in addr;
+  return peerOrLocal(fd(), false, addr) ? ntohs(addr.sin_port) : 0;
+}
@@ -0,0 +1,63 @@
+/*
+  WiFiClient.h - TCP client on a POSIX socket for the host build.
+  Copies share the socket, which closes when the last copy goes away.
+*/
+#ifndef _WIFICLIENT_H_
+#define _WIFICLIENT_H_
+
+#include <memory>
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+struct iovec;
+class WiFiClientSocketHandle;
+
+class WiFiClient : public Stream
+{
+protected:
+  std::shared_ptr<WiFiClientSocketHandle> clientSocketHandle;
+  bool _connected;
+  int _timeout;
+
+public:
+  WiFiClient();
+  WiFiClient(int fd);
+  ~WiFiClient();
+  int connect(IPAddress ip, uint16_t port);
+  int connect(IPAddress ip, uint16_t port, int32_t timeout);
+  int connect(const char *host, uint16_t port);
+  int connect(const char *host, uint16_t port, int32_t timeout);
+  size_t write(uint8_t data) override;
+  size_t write(const uint8_t *buf, size_t size) override;
+  size_t write_P(PGM_P buf, size_t size) { return write((const uint8_t *)buf, size); }
+  size_t write(Stream &stream);
+  size_t writev(struct iovec *iov, int iovcnt);
+  int available() override;
+  int availableForWrite() override;
+  int read() override;
+  int read(uint8_t *buf, size_t size);
+  size_t readBytes(char *buffer, size_t length) override { return read((uint8_t *)buffer, length); }
+  size_t readBytes(uint8_t *buffer, size_t length) override { return read(buffer, length); }
+  int peek() override;
+  void flush() override;
+  void stop();
+  uint8_t connected();
+
+  operator bool() { return connected(); }
+  bool operator==(const WiFiClient &);
+  bool operator!=(const WiFiClient &rhs) { return !this->operator==(rhs); }
+
+  int fd() const;
+  int setSocketOption(int level, int option, const void *value, size_t len);
+  int setTimeout(uint32_t seconds);
+  int setNoDelay(bool nodelay);
+  IPAddress remoteIP() const;
+  uint16_t remotePort() const;
+  IPAddress localIP() const;
+  uint16_t localPort() const;
+
+  using Print::write;
+};
+
+#endif /* _WIFICLIENT_H_ */
@@ -0,0 +1,86 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "WiFiServer.h"
+
+WiFiClient WiFiServer::available()
+{
+  if (!_listening)
+    return WiFiClient();
+  struct sockaddr_in client;
+  socklen_t cs = sizeof(client);
+  int client_sock = ::accept(sockfd, (struct sockaddr *)&client, &cs);
+  if (client_sock < 0)
+    return WiFiClient();
+  fcntl(client_sock, F_SETFL, fcntl(client_sock, F_GETFL, 0) | O_NONBLOCK);
+  int val = _noDelay;
+  setsockopt(client_sock, IPPROTO_TCP, TCP_NODELAY, &val, sizeof(int));
+  // The host's send buffers are megabytes, lwip's a few segments; set
+  // NATIVE_TCP_SNDBUF to see a slow peer fill it the way it does there
+  const char *sndbuf = getenv("NATIVE_TCP_SNDBUF");
+  if (sndbuf)
+  {
+    int size = atoi(sndbuf);
+    setsockopt(client_sock, SOL_SOCKET, SO_SNDBUF, &size, sizeof(int));
+  }
+  return WiFiClient(client_sock);
+}
+
+void WiFiServer::begin(uint16_t port)
+{
+  begin(port, 1);
+}
+
+void WiFiServer::begin(uint16_t port, int enable)
+{
+  if (_listening)
+    return;
+  if (port)
+    _port = port;
+  sockfd = socket(AF_INET, SOCK_STREAM, 0);
+  if (sockfd < 0)
+    return;
+  setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(int));
+  struct sockaddr_in server;
+  memset(&server, 0, sizeof(server));
+  server.sin_family = AF_INET;
+  server.sin_addr.s_addr = (uint32_t)_addr;
+  server.sin_port = htons(_port);
+  if (bind(sockfd, (struct sockaddr *)&server, sizeof(server)) < 0)
+  {
+    log_e("bind port %u: %s", _port, strerror(errno));
+    ::close(sockfd);
+    sockfd = -1;
+    return;
+  }
+  if (listen(sockfd, 16) < 0)
+  {
+    ::close(sockfd);
+    sockfd = -1;
+    return;
+  }
+  fcntl(sockfd, F_SETFL, O_NONBLOCK);
+  _listening = true;
+}
+
+bool WiFiServer::hasClient()
+{
+  if (!_listening)
+    return false;
+  struct pollfd pfd = {sockfd, POLLIN, 0};
+  return poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN);
+}
+
+void WiFiServer::end()
+{
+  if (sockfd >= 0)
+    ::close(sockfd);
+  sockfd = -1;
+  _listening = false;
+}
@@ -0,0 +1,49 @@
+/*
+  WiFiServer.h - non-blocking TCP listener on a POSIX socket for the host build.
+*/
+#ifndef _WIFISERVER_H_
+#define _WIFISERVER_H_
+
+#include "Arduino.h"
+#include "IPAddress.h"
+#include "WiFiClient.h"
+
+class WiFiServer : public Print
+{
+private:
+  int sockfd;
+  IPAddress _addr;
+  uint16_t _port;
+  uint8_t _max_clients;
+  bool _listening;
+  bool _noDelay = false;
+
+public:
+  WiFiServer(uint16_t port = 80, uint8_t max_clients = 4)
+      : sockfd(-1), _addr(), _port(port), _max_clients(max_clients), _listening(false), _noDelay(false) {}
+  WiFiServer(const IPAddress &addr, uint16_t port = 80, uint8_t max_clients = 4)
+      : sockfd(-1), _addr(addr), _port(port), _max_clients(max_clients), _listening(false), _noDelay(false) {}
+  ~WiFiServer() { end(); }
+  WiFiClient available();
+  WiFiClient accept() { return available(); }
+  void begin(uint16_t port = 0);
+  void begin(uint16_t port, int reuse_enable);
+  void setNoDelay(bool nodelay) { _noDelay = nodelay; }
+  bool getNoDelay() { return _noDelay; }
+  bool hasClient();
+  int fd() const { return sockfd; }
+  size_t write(const uint8_t *data, size_t len) override
+  {
+    (void)data;
+    (void)len;
+    return 0;
+  }
+  size_t write(uint8_t data) override { return write(&data, 1); }
+  using Print::write;
+  void end();
+  void close() { end(); }
+  void stop() { end(); }
+  operator bool() { return _listening; }
+};
+
+#endif /* _WIFISERVER_H_ */
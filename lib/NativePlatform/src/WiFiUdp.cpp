@@ -0,0 +1,182 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "WiFiUdp.h"
+
+#define UDP_MAX_PACKET 1460
+
+WiFiUDP::WiFiUDP()
+    : udp_server(-1), server_port(0), remote_port(0), tx_buffer(NULL), tx_buffer_len(0), rx_buffer(NULL), rx_len(0),
+      rx_pos(0) {}
+
+WiFiUDP::~WiFiUDP()
+{
+  stop();
+}
+
+uint8_t WiFiUDP::begin(IPAddress address, uint16_t port)
+{
+  stop();
+  server_port = port;
+  tx_buffer = (uint8_t *)malloc(UDP_MAX_PACKET);
+  rx_buffer = (uint8_t *)malloc(UDP_MAX_PACKET);
+  if (!tx_buffer || !rx_buffer)
+  {
+    stop();
+    return 0;
+  }
+  udp_server = socket(AF_INET, SOCK_DGRAM, 0);
+  if (udp_server < 0)
+  {
+    stop();
+    return 0;
+  }
+  int yes = 1;
+  setsockopt(udp_server, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(server_port);
+  addr.sin_addr.s_addr = (uint32_t)address;
+  if (bind(udp_server, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+  {
+    log_e("could not bind socket: %s", strerror(errno));
+    stop();
+    return 0;
+  }
+  fcntl(udp_server, F_SETFL, O_NONBLOCK);
+  return 1;
+}
+
+uint8_t WiFiUDP::begin(uint16_t p)
+{
+  return begin(IPAddress(0, 0, 0, 0), p);
+}
+
+void WiFiUDP::stop()
+{
+  free(tx_buffer);
+  tx_buffer = NULL;
+  tx_buffer_len = 0;
+  free(rx_buffer);
+  rx_buffer = NULL;
+  rx_len = rx_pos = 0;
+  if (udp_server >= 0)
+    close(udp_server);
+  udp_server = -1;
+}
+
+int WiFiUDP::beginPacket()
+{
+  if (!remote_port)
+    return 0;
+  tx_buffer_len = 0;
+  if (udp_server < 0)
+  {
+    udp_server = socket(AF_INET, SOCK_DGRAM, 0);
+    if (udp_server < 0)
+      return 0;
+    fcntl(udp_server, F_SETFL, O_NONBLOCK);
+  }
+  if (!tx_buffer)
+    tx_buffer = (uint8_t *)malloc(UDP_MAX_PACKET);
+  return tx_buffer != NULL;
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port)
+{
+  remote_ip = ip;
+  remote_port = port;
+  return beginPacket();
+}
+
+int WiFiUDP::beginPacket(const char *host, uint16_t port)
+{
+  struct hostent *he = gethostbyname(host);
+  if (!he)
+    return 0;
+  return beginPacket(IPAddress(*(uint32_t *)he->h_addr_list[0]), port);
+}
+
+int WiFiUDP::endPacket()
+{
+  struct sockaddr_in recipient;
+  memset(&recipient, 0, sizeof(recipient));
+  recipient.sin_family = AF_INET;
+  recipient.sin_addr.s_addr = (uint32_t)remote_ip;
+  recipient.sin_port = htons(remote_port);
+  int sent = sendto(udp_server, tx_buffer, tx_buffer_len, 0, (struct sockaddr *)&recipient, sizeof(recipient));
+  if (sent < 0)
+  {
+    log_e("could not send data: %s", strerror(errno));
+    return 0;
+  }
+  return 1;
+}
+
+size_t WiFiUDP::write(uint8_t data)
+{
+  if (!tx_buffer || tx_buffer_len == UDP_MAX_PACKET)
+    return 0;
+  tx_buffer[tx_buffer_len++] = data;
+  return 1;
+}
+
+size_t WiFiUDP::write(const uint8_t *buffer, size_t size)
+{
+  size_t n = std::min(size, (size_t)UDP_MAX_PACKET - tx_buffer_len);
+  if (!tx_buffer)
+    return 0;
+  memcpy(tx_buffer + tx_buffer_len, buffer, n);
+  tx_buffer_len += n;
+  return n;
+}
+
+int WiFiUDP::parsePacket()
+{
+  if (udp_server < 0 || !rx_buffer)
+    return 0;
+  struct sockaddr_in si_other;
+  socklen_t slen = sizeof(si_other);
+  ssize_t len = recvfrom(udp_server, rx_buffer, UDP_MAX_PACKET, MSG_DONTWAIT, (struct sockaddr *)&si_other, &slen);
+  if (len <= 0)
+    return 0;
+  remote_ip = IPAddress((uint32_t)si_other.sin_addr.s_addr);
+  remote_port = ntohs(si_other.sin_port);
+  rx_len = len;
+  rx_pos = 0;
+  return len;
+}
+
+int WiFiUDP::available()
+{
+  return rx_len - rx_pos;
+}
+
+int WiFiUDP::read()
+{
+  return rx_pos < rx_len ? rx_buffer[rx_pos++] : -1;
+}
+
+int WiFiUDP::read(unsigned char *buffer, size_t len)
+{
+  size_t n = std::min(len, rx_len - rx_pos);
+  memcpy(buffer, rx_buffer + rx_pos, n);
+  rx_pos += n;
+  return n;
+}
+
+int WiFiUDP::peek()
+{
+  return rx_pos < rx_len ? rx_buffer[rx_pos] : -1;
+}
+
+void WiFiUDP::flush()
+{
+  rx_len = rx_pos = 0;
+}
@@ -0,0 +1,48 @@
+/*
+  WiFiUdp.h - UDP on a POSIX socket for the host build.
+*/
+#ifndef _WIFIUDP_H_
+#define _WIFIUDP_H_
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+class WiFiUDP : public Stream
+{
+private:
+  int udp_server;
+  IPAddress remote_ip;
+  uint16_t server_port;
+  uint16_t remote_port;
+  uint8_t *tx_buffer;
+  size_t tx_buffer_len;
+  uint8_t *rx_buffer;
+  size_t rx_len;
+  size_t rx_pos;
+
+public:
+  WiFiUDP();
+  ~WiFiUDP();
+  uint8_t begin(IPAddress a, uint16_t p);
+  uint8_t begin(uint16_t p);
+  void stop();
+  int beginPacket();
+  int beginPacket(IPAddress ip, uint16_t port);
+  int beginPacket(const char *host, uint16_t port);
+  int endPacket();
+  size_t write(uint8_t) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  int parsePacket();
+  int available() override;
+  int read() override;
+  int read(unsigned char *buffer, size_t len);
+  int read(char *buffer, size_t len) { return read((unsigned char *)buffer, len); }
+  int peek() override;
+  void flush() override;
+  int fd() const { return udp_server; }
+  IPAddress remoteIP() { return remote_ip; }
+  uint16_t remotePort() { return remote_port; }
+  using Print::write;
+};
+
+#endif /* _WIFIUDP_H_ */
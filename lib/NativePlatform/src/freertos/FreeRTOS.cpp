@@ -0,0 +1,552 @@
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#include "NativeClock.h"
+#include "FreeRTOS.h"
+#include "event_groups.h"
+#include "queue.h"
+#include "semphr.h"
+#include "task.h"
+
+#define NATIVE_TASK_STACK (256 * 1024)
+#define NATIVE_STACK_PAINT 0xA5
+
+struct NativeTask
+{
+  pthread_t thread;
+  TaskFunction_t fn;
+  void *param;
+  char name[16];
+  UBaseType_t priority;
+  UBaseType_t number;
+  uint8_t *stack;
+  size_t stackSize;
+  std::atomic<bool> deleted;
+  std::mutex notifyLock;
+  std::condition_variable notifyCond;
+  uint32_t notifyValue;
+  bool notifyPending;
+};
+
+static std::mutex registryLock;
+static std::vector<NativeTask *> registry;
+static thread_local NativeTask *currentTask = NULL;
+static std::atomic<UBaseType_t> taskCounter(0);
+
+/*
+ * Block on cond until pred() holds or ticks elapse on NativeClock.
+ * MANUAL clock mode is served by short real-time polls against the
+ * simulated deadline.
+ */
+template <typename Pred>
+static bool waitTicks(std::condition_variable &cond, std::unique_lock<std::mutex> &lock, TickType_t ticks, Pred pred)
+{
+  if (ticks == portMAX_DELAY)
+  {
+    cond.wait(lock, pred);
+    return true;
+  }
+  if (NativeClock::mode() == NativeClock::REALTIME)
+    return cond.wait_for(lock, std::chrono::milliseconds(ticks), pred);
+  uint64_t deadline = NativeClock::nowMicros() + (uint64_t)ticks * 1000;
+  while (!pred())
+  {
+    if (NativeClock::nowMicros() >= deadline)
+      return false;
+    cond.wait_for(lock, std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+static void *taskTrampoline(void *arg)
+{
+  NativeTask *task = (NativeTask *)arg;
+  currentTask = task;
+  pthread_setname_np(pthread_self(), task->name);
+  task->fn(task->param);
+  task->deleted = true;
+  return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode, const char *const pcName, const uint32_t usStackDepth,
+                                   void *const pvParameters, UBaseType_t uxPriority, TaskHandle_t *const pvCreatedTask,
+                                   const BaseType_t xCoreID)
+{
+  (void)usStackDepth;
+  (void)xCoreID;
+  NativeTask *task = new NativeTask();
+  task->fn = pvTaskCode;
+  task->param = pvParameters;
+  strncpy(task->name, pcName ? pcName : "", sizeof(task->name) - 1);
+  task->priority = uxPriority;
+  task->number = ++taskCounter;
+  task->deleted = false;
+  task->notifyValue = 0;
+  task->notifyPending = false;
+  task->stackSize = NATIVE_TASK_STACK;
+  task->stack = (uint8_t *)mmap(NULL, task->stackSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (task->stack == MAP_FAILED)
+  {
+    delete task;
+    return pdFAIL;
+  }
+  memset(task->stack, NATIVE_STACK_PAINT, task->stackSize);
+  {
+    std::lock_guard<std::mutex> guard(registryLock);
+    registry.push_back(task);
+  }
+  if (pvCreatedTask)
+    *pvCreatedTask = task;
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstack(&attr, task->stack, task->stackSize);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  int rc = pthread_create(&task->thread, &attr, taskTrampoline, task);
+  pthread_attr_destroy(&attr);
+  return rc == 0 ? pdPASS : pdFAIL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pvTaskCode, const char *const pcName, const uint32_t usStackDepth,
+                       void *const pvParameters, UBaseType_t uxPriority, TaskHandle_t *const pvCreatedTask)
+{
+  return xTaskCreatePinnedToCore(pvTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pvCreatedTask,
+                                 tskNO_AFFINITY);
+}
+
+BaseType_t xTaskCreateUniversal(TaskFunction_t pxTaskCode, const char *const pcName, const uint32_t usStackDepth,
+                                void *const pvParameters, UBaseType_t uxPriority, TaskHandle_t *const pxCreatedTask,
+                                const BaseType_t xCoreID)
+{
+  return xTaskCreatePinnedToCore(pxTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pxCreatedTask, xCoreID);
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete)
+{
+  NativeTask *task = xTaskToDelete ? xTaskToDelete : currentTask;
+  if (!task)
+    return;
+  task->deleted = true;
+  if (task == currentTask)
+    pthread_exit(NULL);
+  pthread_cancel(task->thread);
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay)
+{
+  if (!xTicksToDelay)
+  {
+    sched_yield();
+    return;
+  }
+  NativeClock::sleepMicros((uint64_t)xTicksToDelay * 1000);
+}
+
+void vTaskDelayUntil(TickType_t *const pxPreviousWakeTime, const TickType_t xTimeIncrement)
+{
+  TickType_t wake = *pxPreviousWakeTime + xTimeIncrement;
+  TickType_t now = xTaskGetTickCount();
+  if ((int32_t)(wake - now) > 0)
+    vTaskDelay(wake - now);
+  *pxPreviousWakeTime = wake;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+  return (TickType_t)(NativeClock::nowMicros() / 1000);
+}
+
+TickType_t xTaskGetTickCountFromISR(void)
+{
+  return xTaskGetTickCount();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+  return currentTask;
+}
+
+char *pcTaskGetName(TaskHandle_t xTaskToQuery)
+{
+  static char loopName[] = "loopTask";
+  NativeTask *task = xTaskToQuery ? xTaskToQuery : currentTask;
+  return task ? task->name : loopName;
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t xTask)
+{
+  NativeTask *task = xTask ? xTask : currentTask;
+  return task ? task->priority : 1;
+}
+
+static UBaseType_t stackUnused(NativeTask *task)
+{
+  // Stacks grow down: count untouched paint from the low end
+  size_t unused = 0;
+  while (unused < task->stackSize && task->stack[unused] == NATIVE_STACK_PAINT)
+    unused++;
+  return unused;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask)
+{
+  NativeTask *task = xTask ? xTask : currentTask;
+  return task ? stackUnused(task) : 0;
+}
+
+UBaseType_t uxTaskGetNumberOfTasks(void)
+{
+  std::lock_guard<std::mutex> guard(registryLock);
+  UBaseType_t n = 0;
+  for (NativeTask *task : registry)
+  {
+    if (!task->deleted)
+      n++;
+  }
+  return n;
+}
+
+static uint32_t threadCpuMicros(NativeTask *task)
+{
+  clockid_t cid;
+  struct timespec ts;
+  if (pthread_getcpuclockid(task->thread, &cid) != 0 || clock_gettime(cid, &ts) != 0)
+    return 0;
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *const pxTaskStatusArray, const UBaseType_t uxArraySize,
+                                 uint32_t *const pulTotalRunTime)
+{
+  std::lock_guard<std::mutex> guard(registryLock);
+  UBaseType_t n = 0;
+  for (NativeTask *task : registry)
+  {
+    if (task->deleted || n >= uxArraySize)
+      continue;
+    TaskStatus_t &st = pxTaskStatusArray[n++];
+    st.xHandle = task;
+    st.pcTaskName = task->name;
+    st.xTaskNumber = task->number;
+    st.eCurrentState = task == currentTask ? eRunning : eBlocked;
+    st.uxCurrentPriority = task->priority;
+    st.uxBasePriority = task->priority;
+    st.ulRunTimeCounter = threadCpuMicros(task);
+    st.pxStackBase = (StackType_t *)task->stack;
+    st.usStackHighWaterMark = stackUnused(task);
+    st.xCoreID = 0;
+  }
+  if (pulTotalRunTime)
+    *pulTotalRunTime = (uint32_t)NativeClock::nowMicros();
+  return n;
+}
+
+static std::recursive_mutex schedulerLock;
+
+void vTaskSuspendAll(void)
+{
+  schedulerLock.lock();
+}
+
+BaseType_t xTaskResumeAll(void)
+{
+  schedulerLock.unlock();
+  return pdFALSE;
+}
+
+BaseType_t xTaskGenericNotify(TaskHandle_t xTaskToNotify, uint32_t ulValue, eNotifyAction eAction,
+                              uint32_t *pulPreviousNotificationValue)
+{
+  NativeTask *task = xTaskToNotify;
+  if (!task)
+    return pdFAIL;
+  std::lock_guard<std::mutex> guard(task->notifyLock);
+  if (pulPreviousNotificationValue)
+    *pulPreviousNotificationValue = task->notifyValue;
+  BaseType_t ret = pdPASS;
+  switch (eAction)
+  {
+  case eSetBits:
+    task->notifyValue |= ulValue;
+    break;
+  case eIncrement:
+    task->notifyValue++;
+    break;
+  case eSetValueWithOverwrite:
+    task->notifyValue = ulValue;
+    break;
+  case eSetValueWithoutOverwrite:
+    if (task->notifyPending)
+      ret = pdFAIL;
+    else
+      task->notifyValue = ulValue;
+    break;
+  case eNoAction:
+    break;
+  }
+  task->notifyPending = true;
+  task->notifyCond.notify_all();
+  return ret;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t ulBitsToClearOnEntry, uint32_t ulBitsToClearOnExit,
+                           uint32_t *pulNotificationValue, TickType_t xTicksToWait)
+{
+  NativeTask *task = currentTask;
+  if (!task)
+    return pdFAIL;
+  std::unique_lock<std::mutex> lock(task->notifyLock);
+  if (!task->notifyPending)
+    task->notifyValue &= ~ulBitsToClearOnEntry;
+  bool got = waitTicks(task->notifyCond, lock, xTicksToWait, [task] { return task->notifyPending; });
+  if (pulNotificationValue)
+    *pulNotificationValue = task->notifyValue;
+  if (!got)
+    return pdFAIL;
+  task->notifyValue &= ~ulBitsToClearOnExit;
+  task->notifyPending = false;
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+  NativeTask *task = currentTask;
+  if (!task)
+    return 0;
+  std::unique_lock<std::mutex> lock(task->notifyLock);
+  waitTicks(task->notifyCond, lock, xTicksToWait, [task] { return task->notifyValue != 0; });
+  uint32_t value = task->notifyValue;
+  if (value)
+    task->notifyValue = xClearCountOnExit ? 0 : value - 1;
+  task->notifyPending = false;
+  return value;
+}
+
+static std::recursive_mutex criticalLock;
+
+void vPortEnterCritical(portMUX_TYPE *mux)
+{
+  (void)mux;
+  criticalLock.lock();
+}
+
+void vPortExitCritical(portMUX_TYPE *mux)
+{
+  (void)mux;
+  criticalLock.unlock();
+}
+
+void vPortYield(void)
+{
+  sched_yield();
+}
+
+/*
+ * Queues, and semaphores on top of them (zero-sized items, like FreeRTOS).
+ */
+struct NativeQueue
+{
+  std::mutex lock;
+  std::condition_variable changed;
+  std::deque<std::vector<uint8_t>> items;
+  UBaseType_t length;
+  UBaseType_t itemSize;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize)
+{
+  NativeQueue *q = new NativeQueue();
+  q->length = uxQueueLength;
+  q->itemSize = uxItemSize;
+  return q;
+}
+
+void vQueueDelete(QueueHandle_t xQueue)
+{
+  delete xQueue;
+}
+
+static BaseType_t queuePut(QueueHandle_t q, const void *item, TickType_t ticks, bool front)
+{
+  std::unique_lock<std::mutex> lock(q->lock);
+  if (!waitTicks(q->changed, lock, ticks, [q] { return q->items.size() < q->length; }))
+    return errQUEUE_FULL;
+  std::vector<uint8_t> data(q->itemSize);
+  if (q->itemSize && item)
+    memcpy(data.data(), item, q->itemSize);
+  if (front)
+    q->items.push_front(std::move(data));
+  else
+    q->items.push_back(std::move(data));
+  q->changed.notify_all();
+  return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+  return queuePut(xQueue, pvItemToQueue, xTicksToWait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+  return queuePut(xQueue, pvItemToQueue, xTicksToWait, true);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t xQueue, const void *pvItemToQueue)
+{
+  {
+    std::lock_guard<std::mutex> guard(xQueue->lock);
+    xQueue->items.clear();
+  }
+  return queuePut(xQueue, pvItemToQueue, 0, false);
+}
+
+static BaseType_t queueGet(QueueHandle_t q, void *buffer, TickType_t ticks, bool remove)
+{
+  std::unique_lock<std::mutex> lock(q->lock);
+  if (!waitTicks(q->changed, lock, ticks, [q] { return !q->items.empty(); }))
+    return errQUEUE_EMPTY;
+  if (q->itemSize && buffer)
+    memcpy(buffer, q->items.front().data(), q->itemSize);
+  if (remove)
+  {
+    q->items.pop_front();
+    q->changed.notify_all();
+  }
+  return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait)
+{
+  return queueGet(xQueue, pvBuffer, xTicksToWait, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait)
+{
+  return queueGet(xQueue, pvBuffer, xTicksToWait, false);
+}
+
+BaseType_t xQueueReset(QueueHandle_t xQueue)
+{
+  std::lock_guard<std::mutex> guard(xQueue->lock);
+  xQueue->items.clear();
+  xQueue->changed.notify_all();
+  return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue)
+{
+  std::lock_guard<std::mutex> guard(xQueue->lock);
+  return xQueue->items.size();
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t xQueue)
+{
+  std::lock_guard<std::mutex> guard(xQueue->lock);
+  return xQueue->length - xQueue->items.size();
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount)
+{
+  QueueHandle_t q = xQueueCreate(uxMaxCount, 0);
+  for (UBaseType_t i = 0; i < uxInitialCount; i++)
+    xQueueSend(q, NULL, 0);
+  return q;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+  return xSemaphoreCreateCounting(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+  return xSemaphoreCreateCounting(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void)
+{
+  return xSemaphoreCreateCounting(1, 1);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime)
+{
+  return xQueueReceive(xSemaphore, NULL, xBlockTime);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore)
+{
+  return xQueueSend(xSemaphore, NULL, 0);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t xSemaphore, BaseType_t *pxHigherPriorityTaskWoken)
+{
+  if (pxHigherPriorityTaskWoken)
+    *pxHigherPriorityTaskWoken = pdFALSE;
+  return xQueueSend(xSemaphore, NULL, 0);
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t xSemaphore)
+{
+  return uxQueueMessagesWaiting(xSemaphore);
+}
+
+struct NativeEventGroup
+{
+  std::mutex lock;
+  std::condition_variable changed;
+  EventBits_t bits;
+};
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+  NativeEventGroup *group = new NativeEventGroup();
+  group->bits = 0;
+  return group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet)
+{
+  std::lock_guard<std::mutex> guard(xEventGroup->lock);
+  xEventGroup->bits |= uxBitsToSet;
+  xEventGroup->changed.notify_all();
+  return xEventGroup->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToClear)
+{
+  std::lock_guard<std::mutex> guard(xEventGroup->lock);
+  EventBits_t before = xEventGroup->bits;
+  xEventGroup->bits &= ~uxBitsToClear;
+  return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t xEventGroup)
+{
+  std::lock_guard<std::mutex> guard(xEventGroup->lock);
+  return xEventGroup->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToWaitFor,
+                                const BaseType_t xClearOnExit, const BaseType_t xWaitForAllBits,
+                                TickType_t xTicksToWait)
+{
+  std::unique_lock<std::mutex> lock(xEventGroup->lock);
+  auto satisfied = [&] {
+    EventBits_t hit = xEventGroup->bits & uxBitsToWaitFor;
+    return xWaitForAllBits ? hit == uxBitsToWaitFor : hit != 0;
+  };
+  bool ok = waitTicks(xEventGroup->changed, lock, xTicksToWait, satisfied);
+  EventBits_t bits = xEventGroup->bits;
+  if (ok && xClearOnExit)
+    xEventGroup->bits &= ~uxBitsToWaitFor;
+  return bits;
+}
@@ -0,0 +1,49 @@
+/*
+  cencode.h - base64 encoder used by WebServer's basic authentication.
+*/
+#ifndef BASE64_CENCODE_H
+#define BASE64_CENCODE_H
+
+#define base64_encode_expected_len(n) ((((4 * (n)) / 3) + 3) & ~3)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline int base64_encode_chars(const char *plaintext_in, int length_in, char *code_out)
+{
+  static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  const unsigned char *in = (const unsigned char *)plaintext_in;
+  char *out = code_out;
+  int i = 0;
+  for (; i + 2 < length_in; i += 3)
+  {
+    *out++ = table[in[i] >> 2];
+    *out++ = table[((in[i] & 3) << 4) | (in[i + 1] >> 4)];
+    *out++ = table[((in[i + 1] & 15) << 2) | (in[i + 2] >> 6)];
+    *out++ = table[in[i + 2] & 63];
+  }
+  if (i < length_in)
+  {
+    *out++ = table[in[i] >> 2];
+    if (i + 1 < length_in)
+    {
+      *out++ = table[((in[i] & 3) << 4) | (in[i + 1] >> 4)];
+      *out++ = table[(in[i + 1] & 15) << 2];
+    }
+    else
+    {
+      *out++ = table[(in[i] & 3) << 4];
+      *out++ = '=';
+    }
+    *out++ = '=';
+  }
+  *out = 0;
+  return out - code_out;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BASE64_CENCODE_H */
@@ -0,0 +1,15 @@
+/*
+  lwip/sockets.h - BSD sockets under the lwIP name for the host build.
+*/
+#ifndef LWIP_SOCKETS_H
+#define LWIP_SOCKETS_H
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#endif // LWIP_SOCKETS_H
@@ -0,0 +1,4 @@
+/*
+  pgmspace.h - flash access macros live in Arduino.h on the host.
+*/
+#include "Arduino.h"
@@ -188,6 +188,38 @@ void BasicStepperDriver::alterMove(long steps){
         break;
     }
 }
+/*
+ * Extend a running move, recomputing the ramp for the new distance
+ */
+bool BasicStepperDriver::extendMove(long steps){
+    float speed;
+    long total, cruise, brake;
+    switch (getCurrentState()){
+    case ACCELERATING:
+    case CRUISING:
+        break;
+    default:
+        return false;
+    }
+    if (steps <= 0){
+        return true;
+    }
+    steps_remaining += steps;
+    if (profile.mode == LINEAR_SPEED){
+        total = step_count + steps_remaining;
+        speed = rpm * motor_steps / 60;
+        cruise = microsteps * (speed * speed / (2 * profile.accel));
+        brake = cruise * profile.accel / profile.decel;
+        if (total < cruise + brake){
+            cruise = total * profile.decel / (profile.accel + profile.decel);
+            brake = total - cruise;
+        }
+        // Already past the new cruise point: keep the current speed
+        steps_to_cruise = max(cruise, step_count);
+        steps_to_brake = brake;
+    }
+    return true;
+}
 /*
  * Brake early.
  */
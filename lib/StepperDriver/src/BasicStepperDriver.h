@@ -205,6 +205,12 @@ public:
      * For constant speed, this is the same as stop()
      */
     void startBrake(void);
+    /*
+     * Lengthen a running move by steps in its current direction, keeping
+     * the speed profile continuous. Only possible before braking starts;
+     * returns false if the move is already decelerating or stopped.
+     */
+    bool extendMove(long steps);
     /*
      * Immediate stop
      * Returns the number of steps remaining.
@@ -25,6 +25,7 @@
 #include "WiFiClient.h"
 #include "WebServer.h"
 #include "detail/mimetable.h"
+#include "detail/BoundarySearch.h"
 
 #ifndef WEBSERVER_MAX_POST_ARGS
 #define WEBSERVER_MAX_POST_ARGS 32
@@ -41,161 +42,132 @@ const char * _http_method_str[] = {
 static const char Content_Type[] PROGMEM = "Content-Type";
 static const char filename[] PROGMEM = "filename";
 
-static char* readBytesWithTimeout(WiFiClient& client, size_t maxLength, size_t& dataLength, int timeout_ms)
+// Appends the body to out: in one piece when the receive buffer has all of it
+static bool readBody(HTTPBodyStream& body, String& out)
 {
-  char *buf = nullptr;
-  dataLength = 0;
-  while (dataLength < maxLength) {
-    int tries = timeout_ms;
-    size_t newLength;
-    while (!(newLength = client.available()) && tries--) delay(1);
-    if (!newLength) {
-      break;
-    }
-    if (!buf) {
-      buf = (char *) malloc(newLength + 1);
-      if (!buf) {
-        return nullptr;
-      }
-    }
-    else {
-      char* newBuf = (char *) realloc(buf, dataLength + newLength + 1);
-      if (!newBuf) {
-        free(buf);
-        return nullptr;
-      }
-      buf = newBuf;
-    }
-    client.readBytes(buf + dataLength, newLength);
-    dataLength += newLength;
-    buf[dataLength] = '\0';
+  size_t len = body.left();
+  char* in = body.take();
+  if (in)
+    return out.concat(in, len);
+  if (!out.reserve(out.length() + len))
+    return false;
+  char buf[256];
+  while (body.left()) {
+    size_t n = body.readBytes(buf, body.left() < sizeof(buf) ? body.left() : sizeof(buf));
+    if (!n)
+      return false;
+    out.concat(buf, n);
   }
-  return buf;
+  return true;
 }
 
-bool WebServer::_parseRequest(WiFiClient& client) {
-  // Read the first line of HTTP request
-  String req = client.readStringUntil('\r');
-  client.readStringUntil('\n');
+bool WebServer::_parseRequest(HTTPConnection& client) {
+  const HTTPRequestParser& req = client.request;
   //reset header value
   for (int i = 0; i < _headerKeysCount; ++i) {
     _currentHeaders[i].value =String();
   }
 
-  // First line of HTTP request looks like "GET /path HTTP/1.1"
-  // Retrieve the "/path" part by finding the spaces
-  int addr_start = req.indexOf(' ');
-  int addr_end = req.indexOf(' ', addr_start + 1);
-  if (addr_start == -1 || addr_end == -1) {
-    log_e("Invalid request: %s", req.c_str());
+  if (req.result() != HTTPRequestParser::DONE) {
+    // malformed, or a head longer than the connection buffer
+    log_e("Invalid request");
+    _currentVersion = 1;
+    _clientKeepAlive = false;
+    if (req.result() == HTTPRequestParser::ERROR)
+      send(400, "text/plain", "Bad Request");
+    else
+      send(431, "text/plain", "Request Header Fields Too Large");
     return false;
   }
 
-  String methodStr = req.substring(0, addr_start);
-  String url = req.substring(addr_start + 1, addr_end);
-  String versionEnd = req.substring(addr_end + 8);
-  _currentVersion = atoi(versionEnd.c_str());
-  String searchStr = "";
-  int hasSearch = url.indexOf('?');
-  if (hasSearch != -1){
-    searchStr = url.substring(hasSearch + 1);
-    url = url.substring(0, hasSearch);
-  }
-  _currentUri = url;
+  // The views go to C strings in place, the buffer is not parsed again
+  const char* methodStr = client.str(req.method);
+  _currentVersion = req.versionMinor;
+  _clientKeepAlive = _currentVersion > 0; // HTTP/1.1 persists unless asked not to
+  _currentUri = client.str(req.path);
+  String searchStr;
+  if (req.query.len)
+    searchStr = client.str(req.query);
   _chunked = false;
-  _clientContentLength = 0;  // not known yet, or invalid
+  _clientContentLength = req.contentLength;
 
   HTTPMethod method = HTTP_ANY;
   size_t num_methods = sizeof(_http_method_str) / sizeof(const char *);
   for (size_t i=0; i<num_methods; i++) {
-    if (methodStr == _http_method_str[i]) {
+    if (strcmp(methodStr, _http_method_str[i]) == 0) {
       method = (HTTPMethod)i;
       break;
     }
   }
   if (method == HTTP_ANY) {
-    log_e("Unknown HTTP Method: %s", methodStr.c_str());
+    log_e("Unknown HTTP Method: %s", methodStr);
     return false;
   }
   _currentMethod = method;
 
-  log_v("method: %s url: %s search: %s", methodStr.c_str(), url.c_str(), searchStr.c_str());
+  log_v("method: %s url: %s search: %s", methodStr, _currentUri.c_str(), searchStr.c_str());
 
   //attach handler
-  RequestHandler* handler;
-  for (handler = _firstHandler; handler; handler = handler->next()) {
-    if (handler->canHandle(_currentMethod, _currentUri))
-      break;
+  _routes.match(_currentMethod, _currentUri, _route);
+  _currentHandler = _route.handler;
+
+  String boundaryStr;
+  bool isForm = false;
+  bool isEncoded = false;
+  for (uint8_t i = 0; i < req.headerCount; i++) {
+    const char* headerName = client.str(req.headers[i].name);
+    const char* headerValue = client.str(req.headers[i].value);
+    _collectHeader(headerName, headerValue);
+
+    log_v("headerName: %s", headerName);
+    log_v("headerValue: %s", headerValue);
+
+    if (strcasecmp(headerName, Content_Type) == 0){
+      using namespace mime;
+      if (strncmp(headerValue, mimeTable[txt].mimeType, strlen(mimeTable[txt].mimeType)) == 0){
+        isForm = false;
+      } else if (strncmp(headerValue, "application/x-www-form-urlencoded", 33) == 0){
+        isForm = false;
+        isEncoded = true;
+      } else if (strncmp(headerValue, "multipart/", 10) == 0){
+        const char* boundary = strchr(headerValue, '=');
+        boundaryStr = boundary ? boundary + 1 : headerValue;
+        boundaryStr.replace("\"","");
+        isForm = true;
+      }
+    } else if (strcasecmp(headerName, "Host") == 0){
+      _hostHeader = headerValue;
+    } else if (strcasecmp(headerName, "Connection") == 0){
+      _parseConnection(headerValue);
+    }
   }
-  _currentHandler = handler;
 
-  String formData;
   // below is needed only when POST type request
   if (method == HTTP_POST || method == HTTP_PUT || method == HTTP_PATCH || method == HTTP_DELETE){
-    String boundaryStr;
-    String headerName;
-    String headerValue;
-    bool isForm = false;
-    bool isEncoded = false;
-    //parse headers
-    while(1){
-      req = client.readStringUntil('\r');
-      client.readStringUntil('\n');
-      if (req == "") break;//no moar headers
-      int headerDiv = req.indexOf(':');
-      if (headerDiv == -1){
-        break;
-      }
-      headerName = req.substring(0, headerDiv);
-      headerValue = req.substring(headerDiv + 1);
-      headerValue.trim();
-       _collectHeader(headerName.c_str(),headerValue.c_str());
-
-      log_v("headerName: %s", headerName.c_str());
-      log_v("headerValue: %s", headerValue.c_str());
-
-      if (headerName.equalsIgnoreCase(FPSTR(Content_Type))){
-        using namespace mime;
-        if (headerValue.startsWith(FPSTR(mimeTable[txt].mimeType))){
-          isForm = false;
-        } else if (headerValue.startsWith(F("application/x-www-form-urlencoded"))){
-          isForm = false;
-          isEncoded = true;
-        } else if (headerValue.startsWith(F("multipart/"))){
-          boundaryStr = headerValue.substring(headerValue.indexOf('=') + 1);
-          boundaryStr.replace("\"","");
-          isForm = true;
-        }
-      } else if (headerName.equalsIgnoreCase(F("Content-Length"))){
-        _clientContentLength = headerValue.toInt();
-      } else if (headerName.equalsIgnoreCase(F("Host"))){
-        _hostHeader = headerValue;
-      }
-    }
-
     if (!isForm){
-      size_t plainLength;
-      char* plainBuf = readBytesWithTimeout(client, _clientContentLength, plainLength, HTTP_MAX_POST_WAIT);
-      if (plainLength < _clientContentLength) {
-      	free(plainBuf);
-      	return false;
-      }
-      if (_clientContentLength > 0) {
+      _body.begin(&client, _clientContentLength);
+      _body.setTimeout(HTTP_MAX_POST_WAIT);
+      if (_currentHandler && _currentHandler->readsBody()) {
+        // an onBody() handler reads it from _body
+        _parseArguments(searchStr);
+      } else if (_clientContentLength > 0) {
         if(isEncoded){
           //url encoded form
           if (searchStr != "") searchStr += '&';
-          searchStr += plainBuf;
-        }
-        _parseArguments(searchStr);
-        if(!isEncoded){
+          if (!readBody(_body, searchStr))
+            return false;
+          _parseArguments(searchStr);
+        } else {
           //plain post json or other data
+          String plain;
+          if (!readBody(_body, plain))
+            return false;
+          _parseArguments(searchStr);
           RequestArgument& arg = _currentArgs[_currentArgCount++];
           arg.key = F("plain");
-          arg.value = String(plainBuf);
+          arg.value = std::move(plain);
+          log_v("Plain: %s", arg.value.c_str());
         }
-
-        log_v("Plain: %s", plainBuf);
-        free(plainBuf);
       } else {
         // No content - but we can still have arguments in the URL.
         _parseArguments(searchStr);
@@ -208,41 +180,31 @@ bool WebServer::_parseRequest(WiFiClient& client) {
       }
     }
   } else {
-    String headerName;
-    String headerValue;
-    //parse headers
-    while(1){
-      req = client.readStringUntil('\r');
-      client.readStringUntil('\n');
-      if (req == "") break;//no moar headers
-      int headerDiv = req.indexOf(':');
-      if (headerDiv == -1){
-        break;
-      }
-      headerName = req.substring(0, headerDiv);
-      headerValue = req.substring(headerDiv + 2);
-      _collectHeader(headerName.c_str(),headerValue.c_str());
-
-	  log_v("headerName: %s", headerName.c_str());
-	  log_v("headerValue: %s", headerValue.c_str());
-
-	  if (headerName.equalsIgnoreCase("Host")){
-        _hostHeader = headerValue;
-      }
-    }
     _parseArguments(searchStr);
   }
-  client.flush();
 
-  log_v("Request: %s", url.c_str());
+  log_v("Request: %s", _currentUri.c_str());
   log_v(" Arguments: %s", searchStr.c_str());
 
   return true;
 }
 
+void WebServer::_parseConnection(const char* value) {
+  // a list of options, as in "keep-alive, Upgrade"
+  while (*value) {
+    value += strspn(value, " \t,");
+    size_t len = strcspn(value, " \t,");
+    if (len == 5 && strncasecmp(value, "close", 5) == 0)
+      _clientKeepAlive = false;
+    else if (len == 10 && strncasecmp(value, "keep-alive", 10) == 0)
+      _clientKeepAlive = true;
+    value += len;
+  }
+}
+
 bool WebServer::_collectHeader(const char* headerName, const char* headerValue) {
   for (int i = 0; i < _headerKeysCount; i++) {
-    if (_currentHeaders[i].key.equalsIgnoreCase(headerName)) {
+    if (strcasecmp(_currentHeaders[i].key.c_str(), headerName) == 0) {
             _currentHeaders[i].value=headerValue;
             return true;
         }
@@ -252,14 +214,16 @@ bool WebServer::_collectHeader(const char* headerName, const char* headerValue)
 
 void WebServer::_parseArguments(String data) {
   log_v("args: %s", data.c_str());
-  if (_currentArgs)
-    delete[] _currentArgs;
-  _currentArgs = 0;
   if (data.length() == 0) {
     _currentArgCount = 0;
-    _currentArgs = new RequestArgument[1];
+    // any earlier array has room for "plain"
+    if (!_currentArgs)
+      _currentArgs = new RequestArgument[1];
     return;
   }
+  if (_currentArgs)
+    delete[] _currentArgs;
+  _currentArgs = 0;
   _currentArgCount = 1;
 
   for (int i = 0; i < (int)data.length(); ) {
@@ -299,58 +263,45 @@ void WebServer::_parseArguments(String data) {
 
 }
 
-void WebServer::_uploadWriteByte(uint8_t b){
-  if (_currentUpload->currentSize == HTTP_UPLOAD_BUFLEN){
-    if(_currentHandler && _currentHandler->canUpload(_currentUri))
-      _currentHandler->upload(*this, _currentUri, *_currentUpload);
-    _currentUpload->totalSize += _currentUpload->currentSize;
-    _currentUpload->currentSize = 0;
+void WebServer::_uploadWrite(const uint8_t* data, size_t len){
+  while (len) {
+    if (_currentUpload->currentSize == HTTP_UPLOAD_BUFLEN){
+      _callUpload();
+      _currentUpload->totalSize += _currentUpload->currentSize;
+      _currentUpload->currentSize = 0;
+    }
+    size_t n = HTTP_UPLOAD_BUFLEN - _currentUpload->currentSize;
+    if (n > len)
+      n = len;
+    memcpy(_currentUpload->buf + _currentUpload->currentSize, data, n);
+    _currentUpload->currentSize += n;
+    data += n;
+    len -= n;
   }
-  _currentUpload->buf[_currentUpload->currentSize++] = b;
 }
 
-int WebServer::_uploadReadByte(WiFiClient& client){
-  int res = client.read();
-  if(res < 0) {
-    // keep trying until you either read a valid byte or timeout
-    unsigned long startMillis = millis();
-    long timeoutIntervalMillis = client.getTimeout();
-    boolean timedOut = false;
-    for(;;) {
-      if (!client.connected()) return -1;
-      // loosely modeled after blinkWithoutDelay pattern
-      while(!timedOut && !client.available() && client.connected()){
-        delay(2);
-        timedOut = millis() - startMillis >= timeoutIntervalMillis;
-      }
-
-      res = client.read();
-      if(res >= 0) {
-        return res; // exit on a valid read
-      }
-      // NOTE: it is possible to get here and have all of the following
-      //       assertions hold true
-      //
-      //       -- client.available() > 0
-      //       -- client.connected == true
-      //       -- res == -1
-      //
-      //       a simple retry strategy overcomes this which is to say the
-      //       assertion is not permanent, but the reason that this works
-      //       is elusive, and possibly indicative of a more subtle underlying
-      //       issue
-
-      timedOut = millis() - startMillis >= timeoutIntervalMillis;
-      if(timedOut) {
-        return res; // exit on a timeout
-      }
+// Hands the file data to the upload handler a block at a time, up to and
+// past the delimiter in front of the next part
+bool WebServer::_uploadFile(HTTPConnection& client, const BoundarySearch& delimiter){
+  for (;;) {
+    size_t len = client.buffer(HTTP_REQUEST_BUFLEN);
+    size_t at = delimiter.find(client.unread(), len);
+    // short of a delimiter, all but what might be the start of one is data
+    size_t data = at != BoundarySearch::npos ? at : delimiter.safe(len);
+    if (at == BoundarySearch::npos && !data)
+      return false; // the body ended, or stalled, before the delimiter
+    _uploadWrite(client.unread(), data);
+    client.skip(data);
+    if (at != BoundarySearch::npos) {
+      client.skip(delimiter.length());
+      _callUpload();
+      _currentUpload->totalSize += _currentUpload->currentSize;
+      return true;
     }
   }
-
-  return res;
 }
 
-bool WebServer::_parseForm(WiFiClient& client, String boundary, uint32_t len){
+bool WebServer::_parseForm(HTTPConnection& client, String boundary, uint32_t len){
   (void) len;
   log_v("Parse Form: Boundary: %s Length: %d", boundary.c_str(), len);
   String line;
@@ -361,6 +312,11 @@ bool WebServer::_parseForm(WiFiClient& client, String boundary, uint32_t len){
   } while (line.length() == 0 && retry < 3);
 
   client.readStringUntil('\n');
+  BoundarySearch delimiter;
+  if (!delimiter.begin(boundary.c_str())) {
+    log_e("Boundary: %s", boundary.c_str());
+    return false;
+  }
   //start reading the form
   if (line == ("--"+boundary)){
    if(_postArgs) delete[] _postArgs;
@@ -433,91 +389,19 @@ bool WebServer::_parseForm(WiFiClient& client, String boundary, uint32_t len){
             _currentUpload->totalSize = 0;
             _currentUpload->currentSize = 0;
             log_v("Start File: %s Type: %s", _currentUpload->filename.c_str(), _currentUpload->type.c_str());
-            if(_currentHandler && _currentHandler->canUpload(_currentUri))
-              _currentHandler->upload(*this, _currentUri, *_currentUpload);
+            _callUpload();
             _currentUpload->status = UPLOAD_FILE_WRITE;
-            int argByte = _uploadReadByte(client);
-readfile:
-
-            while(argByte != 0x0D){
-                if(argByte < 0) return _parseFormUploadAborted();
-                _uploadWriteByte(argByte);
-                argByte = _uploadReadByte(client);
-            }
-
-            argByte = _uploadReadByte(client);
-            if(argByte < 0) return _parseFormUploadAborted();
-            if (argByte == 0x0A){
-              argByte = _uploadReadByte(client);
-              if(argByte < 0) return _parseFormUploadAborted();
-              if ((char)argByte != '-'){
-                //continue reading the file
-                _uploadWriteByte(0x0D);
-                _uploadWriteByte(0x0A);
-                goto readfile;
-              } else {
-                argByte = _uploadReadByte(client);
-                if(argByte < 0) return _parseFormUploadAborted();
-                if ((char)argByte != '-'){
-                  //continue reading the file
-                  _uploadWriteByte(0x0D);
-                  _uploadWriteByte(0x0A);
-                  _uploadWriteByte((uint8_t)('-'));
-                  goto readfile;
-                }
-              }
-
-              uint8_t endBuf[boundary.length()];
-              uint32_t i = 0;
-              while(i < boundary.length()){
-                argByte = _uploadReadByte(client);
-                if(argByte < 0) return _parseFormUploadAborted();
-                if ((char)argByte == 0x0D){
-                  _uploadWriteByte(0x0D);
-                  _uploadWriteByte(0x0A);
-                  _uploadWriteByte((uint8_t)('-'));
-                  _uploadWriteByte((uint8_t)('-'));
-                  uint32_t j = 0;
-                  while(j < i){
-                    _uploadWriteByte(endBuf[j++]);
-                  }
-                  goto readfile;
-                }
-                endBuf[i++] = (uint8_t)argByte;
-              }
-
-              if (strstr((const char*)endBuf, boundary.c_str()) != NULL){
-                if(_currentHandler && _currentHandler->canUpload(_currentUri))
-                  _currentHandler->upload(*this, _currentUri, *_currentUpload);
-                _currentUpload->totalSize += _currentUpload->currentSize;
-                _currentUpload->status = UPLOAD_FILE_END;
-                if(_currentHandler && _currentHandler->canUpload(_currentUri))
-                  _currentHandler->upload(*this, _currentUri, *_currentUpload);
-                log_v("End File: %s Type: %s Size: %d", _currentUpload->filename.c_str(), _currentUpload->type.c_str(), _currentUpload->totalSize);
-                line = client.readStringUntil(0x0D);
-                client.readStringUntil(0x0A);
-                if (line == "--"){
-                  log_v("Done Parsing POST");
-                  break;
-                }
-                continue;
-              } else {
-                _uploadWriteByte(0x0D);
-                _uploadWriteByte(0x0A);
-                _uploadWriteByte((uint8_t)('-'));
-                _uploadWriteByte((uint8_t)('-'));
-                uint32_t i = 0;
-                while(i < boundary.length()){
-                  _uploadWriteByte(endBuf[i++]);
-                }
-                argByte = _uploadReadByte(client);
-                goto readfile;
-              }
-            } else {
-              _uploadWriteByte(0x0D);
-              goto readfile;
+            if (!_uploadFile(client, delimiter))
+              return _parseFormUploadAborted();
+            _currentUpload->status = UPLOAD_FILE_END;
+            _callUpload();
+            log_v("End File: %s Type: %s Size: %d", _currentUpload->filename.c_str(), _currentUpload->type.c_str(), _currentUpload->totalSize);
+            line = client.readStringUntil(0x0D);
+            client.readStringUntil(0x0A);
+            if (line == "--"){
+              log_v("Done Parsing POST");
+              break;
             }
-            break;
           }
         }
       }
@@ -531,7 +415,7 @@ readfile:
       arg.value = _currentArgs[iarg].value;
     }
     if (_currentArgs) delete[] _currentArgs;
-    _currentArgs = new RequestArgument[_postArgsLen];
+    _currentArgs = new RequestArgument[_postArgsLen + 1];
     for (iarg = 0; iarg < _postArgsLen; iarg++){
       RequestArgument& arg = _currentArgs[iarg];
       arg.key = _postArgs[iarg].key;
@@ -582,7 +466,6 @@ String WebServer::urlDecode(const String& text)
 
 bool WebServer::_parseFormUploadAborted(){
   _currentUpload->status = UPLOAD_FILE_ABORTED;
-  if(_currentHandler && _currentHandler->canUpload(_currentUri))
-    _currentHandler->upload(*this, _currentUri, *_currentUpload);
+  _callUpload();
   return false;
 }
@@ -15,6 +15,13 @@ class Uri {
         Uri(const __FlashStringHelper *uri) : _uri(String(uri)) {} 
         virtual ~Uri() {}
 
+        // How the WebServer route table may index the pattern. A subclass
+        // with its own canHandle() returns OPAQUE unless it matches the same
+        // way as one of the others.
+        enum Syntax { PLAIN, BRACES, GLOB, OPAQUE };
+        virtual Syntax syntax() const { return PLAIN; }
+        const String& pattern() const { return _uri; }
+
         virtual Uri* clone() const {
             return new Uri(_uri);
         };
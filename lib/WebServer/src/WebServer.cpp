@@ -1,6 +1,7 @@
 /*
   WebServer.cpp - Dead simple web-server.
-  Supports only one simultaneous client, knows how to handle GET and POST.
+  Serves up to WEBSERVER_MAX_CLIENTS clients at once from one select() loop,
+  knows how to handle GET and POST.
 
   Copyright (c) 2014 Ivan Grokhotkov. All rights reserved.
 
@@ -21,9 +22,11 @@
 */
 
 
+#include <algorithm>
 #include <Arduino.h>
 #include <esp32-hal-log.h>
 #include <libb64/cencode.h>
+#include <lwip/sockets.h>
 #include "WiFiServer.h"
 #include "WiFiClient.h"
 #include "WebServer.h"
@@ -44,12 +47,13 @@ WebServer::WebServer(IPAddress addr, int port)
 , _server(addr, port)
 , _currentMethod(HTTP_ANY)
 , _currentVersion(0)
-, _currentStatus(HC_NONE)
-, _statusChange(0)
 , _nullDelay(true)
 , _currentHandler(nullptr)
 , _firstHandler(nullptr)
 , _lastHandler(nullptr)
+, _route()
+, _parseMicros(0)
+, _handleMicros(0)
 , _currentArgCount(0)
 , _currentArgs(nullptr)
 , _postArgsLen(0)
@@ -58,7 +62,11 @@ WebServer::WebServer(IPAddress addr, int port)
 , _currentHeaders(nullptr)
 , _contentLength(0)
 , _clientContentLength(0)
+, _responseHeadersLen(0)
+, _outLen(0)
 , _chunked(false)
+, _clientKeepAlive(false)
+, _keepAlive(false)
 {
   log_v("WebServer::Webserver(addr=%s, port=%d)", addr.toString().c_str(), port);
 }
@@ -68,12 +76,13 @@ WebServer::WebServer(int port)
 , _server(port)
 , _currentMethod(HTTP_ANY)
 , _currentVersion(0)
-, _currentStatus(HC_NONE)
-, _statusChange(0)
 , _nullDelay(true)
 , _currentHandler(nullptr)
 , _firstHandler(nullptr)
 , _lastHandler(nullptr)
+, _route()
+, _parseMicros(0)
+, _handleMicros(0)
 , _currentArgCount(0)
 , _currentArgs(nullptr)
 , _postArgsLen(0)
@@ -82,7 +91,11 @@ WebServer::WebServer(int port)
 , _currentHeaders(nullptr)
 , _contentLength(0)
 , _clientContentLength(0)
+, _responseHeadersLen(0)
+, _outLen(0)
 , _chunked(false)
+, _clientKeepAlive(false)
+, _keepAlive(false)
 {
   log_v("WebServer::Webserver(port=%d)", port);
 }
@@ -261,14 +274,18 @@ void WebServer::on(const Uri &uri, HTTPMethod method, WebServer::THandlerFunctio
 }
 
 void WebServer::on(const Uri &uri, HTTPMethod method, WebServer::THandlerFunction fn, WebServer::THandlerFunction ufn) {
-  _addRequestHandler(new FunctionRequestHandler(fn, ufn, uri, method));
+  _addRequestHandler(new FunctionRequestHandler(fn, ufn, uri, method), &uri, method);
+}
+
+void WebServer::onBody(const Uri &uri, HTTPMethod method, WebServer::THandlerFunction fn) {
+  _addRequestHandler(new FunctionRequestHandler(fn, nullptr, uri, method, true), &uri, method);
 }
 
 void WebServer::addHandler(RequestHandler* handler) {
     _addRequestHandler(handler);
 }
 
-void WebServer::_addRequestHandler(RequestHandler* handler) {
+void WebServer::_addRequestHandler(RequestHandler* handler, const Uri* uri, HTTPMethod method) {
     if (!_lastHandler) {
       _firstHandler = handler;
       _lastHandler = handler;
@@ -277,6 +294,7 @@ void WebServer::_addRequestHandler(RequestHandler* handler) {
       _lastHandler->next(handler);
       _lastHandler = handler;
     }
+    _routes.add(handler, uri, method);
 }
 
 void WebServer::serveStatic(const char* uri, FS& fs, const char* path, const char* cache_header) {
@@ -284,77 +302,112 @@ void WebServer::serveStatic(const char* uri, FS& fs, const char* path, const cha
 }
 
 void WebServer::handleClient() {
-  if (_currentStatus == HC_NONE) {
-    WiFiClient client = _server.available();
-    if (!client) {
-      if (_nullDelay) {
-        delay(1);
-      }
-      return;
+  fd_set readable;
+  FD_ZERO(&readable);
+  int maxFd = -1;
+  bool room = false;
+  for (HTTPConnection& conn : _clients) {
+    if (conn.status == HC_NONE || conn.idle())
+      room = true;
+    if (conn.status == HC_NONE)
+      continue;
+    FD_SET(conn.fd(), &readable);
+    if (conn.fd() > maxFd)
+      maxFd = conn.fd();
+  }
+  // with every slot busy, new clients wait in the listen backlog
+  int listenFd = room ? _server.fd() : -1;
+  if (listenFd >= 0) {
+    FD_SET(listenFd, &readable);
+    if (listenFd > maxFd)
+      maxFd = listenFd;
+  }
+  if (maxFd < 0) {
+    if (_nullDelay) {
+      delay(1);
     }
+    return;
+  }
 
-    log_v("New client: client.localIP()=%s", client.localIP().toString().c_str());
+  struct timeval timeout = { 0, _nullDelay ? 1000 : 0 };
+  if (select(maxFd + 1, &readable, NULL, NULL, &timeout) < 0) {
+    log_e("select: %d", errno);
+    FD_ZERO(&readable);
+  }
+  if (listenFd >= 0 && FD_ISSET(listenFd, &readable)) {
+    _accept();
+  }
 
-    _currentClient = client;
-    _currentStatus = HC_WAIT_READ;
-    _statusChange = millis();
-  }
-
-  bool keepCurrentClient = false;
-  bool callYield = false;
-
-  if (_currentClient.connected()) {
-    switch (_currentStatus) {
-    case HC_NONE:
-      // No-op to avoid C++ compiler warning
-      break;
-    case HC_WAIT_READ:
-      // Wait for data from client to become available
-      if (_currentClient.available()) {
-        if (_parseRequest(_currentClient)) {
-          // because HTTP_MAX_SEND_WAIT is expressed in milliseconds,
-          // it must be divided by 1000
-          _currentClient.setTimeout(HTTP_MAX_SEND_WAIT / 1000);
-          _contentLength = CONTENT_LENGTH_NOT_SET;
-          _handleRequest();
-
-// Fix for issue with Chrome based browsers: https://github.com/espressif/arduino-esp32/issues/3652
-//           if (_currentClient.connected()) {
-//             _currentStatus = HC_WAIT_CLOSE;
-//             _statusChange = millis();
-//             keepCurrentClient = true;
-//           }
-        }
-      } else { // !_currentClient.available()
-        if (millis() - _statusChange <= HTTP_MAX_DATA_WAIT) {
-          keepCurrentClient = true;
-        }
-        callYield = true;
-      }
-      break;
-    case HC_WAIT_CLOSE:
-      // Wait for client to close the connection
-      if (millis() - _statusChange <= HTTP_MAX_CLOSE_WAIT) {
-        keepCurrentClient = true;
-        callYield = true;
-      }
+  for (HTTPConnection& conn : _clients) {
+    if (conn.status != HC_WAIT_READ)
+      continue;
+    // also polled when not flagged: the client may hold bytes it read ahead
+    if (!conn.fill(FD_ISSET(conn.fd(), &readable))) {
+      conn.end();
+    } else if (conn.ready()) {
+      _serve(conn);
+    } else if (millis() - conn.statusChange > (conn.idle() ? HTTP_MAX_KEEPALIVE_WAIT : HTTP_MAX_DATA_WAIT)) {
+      log_v("Client timed out");
+      conn.end();
     }
   }
+}
 
-  if (!keepCurrentClient) {
-    _currentClient = WiFiClient();
-    _currentStatus = HC_NONE;
-    _currentUpload.reset();
+void WebServer::_accept() {
+  for (;;) {
+    // a free slot, else the one idle the longest makes way
+    HTTPConnection* slot = nullptr;
+    for (HTTPConnection& conn : _clients) {
+      if (conn.status == HC_NONE) {
+        slot = &conn;
+        break;
+      }
+      if (conn.idle() && (!slot || (long)(conn.statusChange - slot->statusChange) < 0))
+        slot = &conn;
+    }
+    if (!slot)
+      return;
+    WiFiClient client = _server.available();
+    if (!client)
+      return;
+    log_v("New client: client.localIP()=%s", client.localIP().toString().c_str());
+    slot->begin(client);
   }
+}
 
-  if (callYield) {
-    yield();
+void WebServer::_serve(HTTPConnection& conn) {
+  _currentClient = conn.client;
+  _keepAlive = false;
+  uint32_t parseStart = micros();
+  if (_parseRequest(conn)) {
+    if (conn.requests + 1 >= HTTP_MAX_KEEPALIVE_REQUESTS)
+      _clientKeepAlive = false;
+    _parseMicros = micros() - parseStart;
+    // because HTTP_MAX_SEND_WAIT is expressed in milliseconds,
+    // it must be divided by 1000
+    _currentClient.setTimeout(HTTP_MAX_SEND_WAIT / 1000);
+    _contentLength = CONTENT_LENGTH_NOT_SET;
+    _handleRequest();
+  }
+  flush(); // parse errors are answered without _finalizeResponse()
+  _currentClient = WiFiClient();
+  _currentUpload.reset();
+  if (_body.left() && !_body.take()) {
+    // what the handler left of a body too long to buffer is still on the socket
+    _keepAlive = false;
+  }
+  _body.end();
+  if (!(_keepAlive && conn.client.connected() && conn.next())) {
+    conn.flush();
+    conn.end();
   }
 }
 
 void WebServer::close() {
   _server.close();
-  _currentStatus = HC_NONE;
+  for (HTTPConnection& conn : _clients) {
+    conn.end();
+  }
   if(!_headerKeysCount)
     collectHeaders(0, 0);
 }
@@ -364,17 +417,26 @@ void WebServer::stop() {
 }
 
 void WebServer::sendHeader(const String& name, const String& value, bool first) {
-  String headerLine = name;
-  headerLine += F(": ");
-  headerLine += value;
-  headerLine += "\r\n";
+  sendHeader(name.c_str(), value.c_str(), first);
+}
 
-  if (first) {
-    _responseHeaders = headerLine + _responseHeaders;
+void WebServer::sendHeader(const char* name, const char* value, bool first) {
+  size_t nameLen = strlen(name), valueLen = strlen(value);
+  size_t len = nameLen + 2 + valueLen + 2;
+  if (_responseHeadersLen + len > sizeof(_responseHeaders)) {
+    log_e("No room for header %s", name);
+    return;
   }
-  else {
-    _responseHeaders += headerLine;
+  char* line = _responseHeaders + _responseHeadersLen;
+  if (first) {
+    memmove(_responseHeaders + len, _responseHeaders, _responseHeadersLen);
+    line = _responseHeaders;
   }
+  memcpy(line, name, nameLen);
+  memcpy(line + nameLen, ": ", 2);
+  memcpy(line + nameLen + 2, value, valueLen);
+  memcpy(line + len - 2, "\r\n", 2);
+  _responseHeadersLen += len;
 }
 
 void WebServer::setContentLength(const size_t contentLength) {
@@ -393,50 +455,127 @@ void WebServer::enableCrossOrigin(boolean value) {
   enableCORS(value);
 }
 
-void WebServer::_prepareHeader(String& response, int code, const char* content_type, size_t contentLength) {
-    response = String(F("HTTP/1.")) + String(_currentVersion) + ' ';
-    response += String(code);
-    response += ' ';
-    response += _responseCodeToString(code);
-    response += "\r\n";
+// Whole header lines, so a response head is mostly a few memcpy()s
+static const char Header_Chunked[] = "Accept-Ranges: none\r\nTransfer-Encoding: chunked\r\n";
+static const char Header_CORS[] = "Access-Control-Allow-Origin: *\r\n"
+                                  "Access-Control-Allow-Methods: *\r\n"
+                                  "Access-Control-Allow-Headers: *\r\n";
+static const char Header_KeepAlive[] = "Connection: keep-alive\r\n\r\n";
+static const char Header_Close[] = "Connection: close\r\n\r\n";
+
+void WebServer::_prepareHeader(int code, const char* content_type, size_t contentLength) {
+    char version[] = "HTTP/1.1";
+    version[7] = '0' + _currentVersion;
+    _outWrite(version, 8);
+    const HTTPStatusLine* status = _statusLine(code);
+    if (status) {
+      // the table has them as HTTP/1.1
+      _outWrite(status->line + 8, status->len - 8);
+    } else {
+      _outWrite(" ", 1);
+      _outNumber(code);
+      _outWrite(" \r\n", 3);
+    }
 
     using namespace mime;
     if (!content_type)
         content_type = mimeTable[html].mimeType;
 
-    sendHeader(String(F("Content-Type")), String(FPSTR(content_type)), true);
-    if (_contentLength == CONTENT_LENGTH_NOT_SET) {
-        sendHeader(String(FPSTR(Content_Length)), String(contentLength));
-    } else if (_contentLength != CONTENT_LENGTH_UNKNOWN) {
-        sendHeader(String(FPSTR(Content_Length)), String(_contentLength));
-    } else if(_contentLength == CONTENT_LENGTH_UNKNOWN && _currentVersion){ //HTTP/1.1 or above client
+    _outWrite("Content-Type: ", 14);
+    _outWrite(content_type, strlen(content_type));
+    _outWrite("\r\n", 2);
+    _outWrite(_responseHeaders, _responseHeadersLen);
+    _responseHeadersLen = 0;
+    if (_contentLength != CONTENT_LENGTH_UNKNOWN) {
+      _outWrite("Content-Length: ", 16);
+      _outNumber(_contentLength == CONTENT_LENGTH_NOT_SET ? contentLength : _contentLength);
+      _outWrite("\r\n", 2);
+    } else if (_currentVersion) { //HTTP/1.1 or above client
       //let's do chunked
       _chunked = true;
-      sendHeader(String(F("Accept-Ranges")),String(F("none")));
-      sendHeader(String(F("Transfer-Encoding")),String(F("chunked")));
+      _outWrite(Header_Chunked, sizeof(Header_Chunked) - 1);
     }
-    if (_corsEnabled) {
-        sendHeader(String(FPSTR("Access-Control-Allow-Origin")), String("*"));
-	sendHeader(String(FPSTR("Access-Control-Allow-Methods")), String("*"));
-	sendHeader(String(FPSTR("Access-Control-Allow-Headers")), String("*"));
+    // the client can only find the end of an undelimited body by the close
+    _keepAlive = _clientKeepAlive && (_contentLength != CONTENT_LENGTH_UNKNOWN || _chunked);
+    if (_corsEnabled)
+      _outWrite(Header_CORS, sizeof(Header_CORS) - 1);
+    if (_keepAlive)
+      _outWrite(Header_KeepAlive, sizeof(Header_KeepAlive) - 1);
+    else
+      _outWrite(Header_Close, sizeof(Header_Close) - 1);
+}
+
+void WebServer::_outWrite(const char* data, size_t len) {
+  struct iovec part = { (void*)data, len };
+  _outWritev(&part, 1);
+}
+
+// Gathers parts into _out while they fit, a segment's worth; what does not
+// fit goes out together with what was gathered in one writev()
+void WebServer::_outWritev(const struct iovec* parts, int count) {
+  size_t len = 0;
+  for (int i = 0; i < count; i++)
+    len += parts[i].iov_len;
+  if (_outLen + len <= sizeof(_out)) {
+    for (int i = 0; i < count; i++) {
+      memcpy(_out + _outLen, parts[i].iov_base, parts[i].iov_len);
+      _outLen += parts[i].iov_len;
     }
-    sendHeader(String(F("Connection")), String(F("close")));
+    return;
+  }
+  struct iovec iov[4];
+  int n = 0;
+  if (_outLen)
+    iov[n++] = { _out, _outLen };
+  for (int i = 0; i < count && n < 4; i++) {
+    if (parts[i].iov_len)
+      iov[n++] = parts[i];
+  }
+  _currentClientWritev(iov, n);
+  _outLen = 0;
+}
+
+// The response's body is already in _out, at _outLen; renders the head after
+// it and swaps the two. False when the body may be cut short or the head
+// may not fit behind it, before anything is written.
+bool WebServer::_sendBuffered(int code, const char* content_type, size_t len) {
+  size_t headMax = 64 + strlen(content_type) + _responseHeadersLen + 40 + sizeof(Header_CORS) + sizeof(Header_KeepAlive);
+  if (_outLen + len + 1 >= sizeof(_out) || _outLen + len + headMax > sizeof(_out))
+    return false;
+  char* body = _out + _outLen;
+  _outLen += len;
+  setContentLength(len);
+  _prepareHeader(code, content_type, len);
+  std::rotate(body, body + len, _out + _outLen);
+  return true;
+}
 
-    response += _responseHeaders;
-    response += "\r\n";
-    _responseHeaders = "";
+void WebServer::_outNumber(size_t n) {
+  char digits[20];
+  size_t i = sizeof(digits);
+  do {
+    digits[--i] = '0' + n % 10;
+    n /= 10;
+  } while (n);
+  _outWrite(digits + i, sizeof(digits) - i);
+}
+
+void WebServer::flush() {
+  if (_outLen)
+    _currentClientWrite(_out, _outLen);
+  _outLen = 0;
 }
 
 void WebServer::send(int code, const char* content_type, const String& content) {
-    String header;
     // Can we asume the following?
     //if(code == 200 && content.length() == 0 && _contentLength == CONTENT_LENGTH_NOT_SET)
     //  _contentLength = CONTENT_LENGTH_UNKNOWN;
     if (content.length() == 0) {
         log_w("content length is zero");
     }
-    _prepareHeader(header, code, content_type, content.length());
-    _currentClientWrite(header.c_str(), header.length());
+    // gathered with the head; written when the response is finalized or
+    // _out fills, so the first chunks of a chunked body go along too
+    _prepareHeader(code, content_type, content.length());
     if(content.length())
       sendContent(content);
 }
@@ -465,20 +604,16 @@ void WebServer::send_P(int code, PGM_P content_type, PGM_P content) {
         contentLength = strlen_P(content);
     }
 
-    String header;
     char type[64];
     memccpy_P((void*)type, (PGM_VOID_P)content_type, 0, sizeof(type));
-    _prepareHeader(header, code, (const char* )type, contentLength);
-    _currentClientWrite(header.c_str(), header.length());
+    _prepareHeader(code, (const char* )type, contentLength);
     sendContent_P(content);
 }
 
 void WebServer::send_P(int code, PGM_P content_type, PGM_P content, size_t contentLength) {
-    String header;
     char type[64];
     memccpy_P((void*)type, (PGM_VOID_P)content_type, 0, sizeof(type));
-    _prepareHeader(header, code, (const char* )type, contentLength);
-    sendContent(header);
+    _prepareHeader(code, (const char* )type, contentLength);
     sendContent_P(content, contentLength);
 }
 
@@ -487,22 +622,21 @@ void WebServer::sendContent(const String& content) {
 }
 
 void WebServer::sendContent(const char* content, size_t contentLength) {
-  const char * footer = "\r\n";
   if(_chunked) {
-    char * chunkSize = (char *)malloc(11);
-    if(chunkSize){
-      sprintf(chunkSize, "%x%s", contentLength, footer);
-      _currentClientWrite(chunkSize, strlen(chunkSize));
-      free(chunkSize);
-    }
-  }
-  _currentClientWrite(content, contentLength);
-  if(_chunked){
-    _currentClient.write(footer, 2);
+    char chunkSize[11];
+    int len = snprintf(chunkSize, sizeof(chunkSize), "%x\r\n", (unsigned)contentLength);
+    struct iovec chunk[3] = {
+      { chunkSize, (size_t)len },
+      { (void*)content, contentLength },
+      { (void*)"\r\n", 2 }
+    };
+    _outWritev(chunk, 3);
     if (contentLength == 0) {
       _chunked = false;
     }
+    return;
   }
+  _outWrite(content, contentLength);
 }
 
 void WebServer::sendContent_P(PGM_P content) {
@@ -510,22 +644,8 @@ void WebServer::sendContent_P(PGM_P content) {
 }
 
 void WebServer::sendContent_P(PGM_P content, size_t size) {
-  const char * footer = "\r\n";
-  if(_chunked) {
-    char * chunkSize = (char *)malloc(11);
-    if(chunkSize){
-      sprintf(chunkSize, "%x%s", size, footer);
-      _currentClientWrite(chunkSize, strlen(chunkSize));
-      free(chunkSize);
-    }
-  }
-  _currentClientWrite_P(content, size);
-  if(_chunked){
-    _currentClient.write(footer, 2);
-    if (size == 0) {
-      _chunked = false;
-    }
-  }
+  // flash is memory mapped on the ESP32, so it gathers like RAM
+  sendContent((const char*)content, size);
 }
 
 
@@ -542,6 +662,11 @@ void WebServer::_streamFileCore(const size_t fileSize, const String & fileName,
 }
 
 String WebServer::pathArg(unsigned int i) {
+  if (_route.compiled) {
+    if (i >= _route.argCount)
+      return "";
+    return _currentUri.substring(_route.args[i].off, _route.args[i].off + _route.args[i].len);
+  }
   if (_currentHandler != nullptr)
     return _currentHandler->pathArg(i);
   return "";
@@ -643,13 +768,36 @@ void WebServer::onNotFound(THandlerFunction fn) {
   _notFoundHandler = fn;
 }
 
+void WebServer::onRequestComplete(THandlerFunction fn) {
+  _requestCompleteHandler = fn;
+}
+
+void WebServer::_callUpload() {
+  if (!_currentHandler)
+    return;
+  if (_route.compiled) {
+    FunctionRequestHandler* handler = static_cast<FunctionRequestHandler*>(_currentHandler);
+    if (handler->canUploadMatched())
+      handler->uploadMatched();
+  } else if (_currentHandler->canUpload(_currentUri)) {
+    _currentHandler->upload(*this, _currentUri, *_currentUpload);
+  }
+}
+
 void WebServer::_handleRequest() {
+  uint32_t handleStart = micros();
   bool handled = false;
   if (!_currentHandler){
     log_e("request handler not found");
   }
   else {
-    handled = _currentHandler->handle(*this, _currentMethod, _currentUri);
+    if (_route.compiled) {
+      // only on() routes are compiled, and the trie has matched the URI already
+      static_cast<FunctionRequestHandler*>(_currentHandler)->handleMatched();
+      handled = true;
+    } else {
+      handled = _currentHandler->handle(*this, _currentMethod, _currentUri);
+    }
     if (!handled) {
       log_e("request handler failed to handle request");
     }
@@ -666,6 +814,10 @@ void WebServer::_handleRequest() {
   if (handled) {
     _finalizeResponse();
   }
+  _handleMicros = micros() - handleStart;
+  if (_requestCompleteHandler) {
+    _requestCompleteHandler();
+  }
   _currentUri = "";
 }
 
@@ -674,50 +826,74 @@ void WebServer::_finalizeResponse() {
   if (_chunked) {
     sendContent("");
   }
+  flush();
+}
+
+#define STATUS_LINE(code, text) { code, sizeof("HTTP/1.1 " #code " " text "\r\n") - 1, "HTTP/1.1 " #code " " text "\r\n" }
+
+// Sorted by code
+static constexpr HTTPStatusLine statusLines[] = {
+  STATUS_LINE(100, "Continue"),
+  STATUS_LINE(101, "Switching Protocols"),
+  STATUS_LINE(200, "OK"),
+  STATUS_LINE(201, "Created"),
+  STATUS_LINE(202, "Accepted"),
+  STATUS_LINE(203, "Non-Authoritative Information"),
+  STATUS_LINE(204, "No Content"),
+  STATUS_LINE(205, "Reset Content"),
+  STATUS_LINE(206, "Partial Content"),
+  STATUS_LINE(300, "Multiple Choices"),
+  STATUS_LINE(301, "Moved Permanently"),
+  STATUS_LINE(302, "Found"),
+  STATUS_LINE(303, "See Other"),
+  STATUS_LINE(304, "Not Modified"),
+  STATUS_LINE(305, "Use Proxy"),
+  STATUS_LINE(307, "Temporary Redirect"),
+  STATUS_LINE(400, "Bad Request"),
+  STATUS_LINE(401, "Unauthorized"),
+  STATUS_LINE(402, "Payment Required"),
+  STATUS_LINE(403, "Forbidden"),
+  STATUS_LINE(404, "Not Found"),
+  STATUS_LINE(405, "Method Not Allowed"),
+  STATUS_LINE(406, "Not Acceptable"),
+  STATUS_LINE(407, "Proxy Authentication Required"),
+  STATUS_LINE(408, "Request Time-out"),
+  STATUS_LINE(409, "Conflict"),
+  STATUS_LINE(410, "Gone"),
+  STATUS_LINE(411, "Length Required"),
+  STATUS_LINE(412, "Precondition Failed"),
+  STATUS_LINE(413, "Request Entity Too Large"),
+  STATUS_LINE(414, "Request-URI Too Large"),
+  STATUS_LINE(415, "Unsupported Media Type"),
+  STATUS_LINE(416, "Requested range not satisfiable"),
+  STATUS_LINE(417, "Expectation Failed"),
+  STATUS_LINE(431, "Request Header Fields Too Large"),
+  STATUS_LINE(500, "Internal Server Error"),
+  STATUS_LINE(501, "Not Implemented"),
+  STATUS_LINE(502, "Bad Gateway"),
+  STATUS_LINE(503, "Service Unavailable"),
+  STATUS_LINE(504, "Gateway Time-out"),
+  STATUS_LINE(505, "HTTP Version not supported"),
+};
+
+const HTTPStatusLine* WebServer::_statusLine(int code) {
+  size_t lo = 0, hi = sizeof(statusLines) / sizeof(statusLines[0]);
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (statusLines[mid].code == code)
+      return &statusLines[mid];
+    if (statusLines[mid].code < code)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return nullptr;
 }
 
 String WebServer::_responseCodeToString(int code) {
-  switch (code) {
-    case 100: return F("Continue");
-    case 101: return F("Switching Protocols");
-    case 200: return F("OK");
-    case 201: return F("Created");
-    case 202: return F("Accepted");
-    case 203: return F("Non-Authoritative Information");
-    case 204: return F("No Content");
-    case 205: return F("Reset Content");
-    case 206: return F("Partial Content");
-    case 300: return F("Multiple Choices");
-    case 301: return F("Moved Permanently");
-    case 302: return F("Found");
-    case 303: return F("See Other");
-    case 304: return F("Not Modified");
-    case 305: return F("Use Proxy");
-    case 307: return F("Temporary Redirect");
-    case 400: return F("Bad Request");
-    case 401: return F("Unauthorized");
-    case 402: return F("Payment Required");
-    case 403: return F("Forbidden");
-    case 404: return F("Not Found");
-    case 405: return F("Method Not Allowed");
-    case 406: return F("Not Acceptable");
-    case 407: return F("Proxy Authentication Required");
-    case 408: return F("Request Time-out");
-    case 409: return F("Conflict");
-    case 410: return F("Gone");
-    case 411: return F("Length Required");
-    case 412: return F("Precondition Failed");
-    case 413: return F("Request Entity Too Large");
-    case 414: return F("Request-URI Too Large");
-    case 415: return F("Unsupported Media Type");
-    case 416: return F("Requested range not satisfiable");
-    case 417: return F("Expectation Failed");
-    case 500: return F("Internal Server Error");
-    case 501: return F("Not Implemented");
-    case 502: return F("Bad Gateway");
-    case 503: return F("Service Unavailable");
-    case 504: return F("Gateway Time-out");
-    case 505: return F("HTTP Version not supported");
-    default:  return F("");
-  }
+  const HTTPStatusLine* status = _statusLine(code);
+  if (!status)
+    return String();
+  // between "HTTP/1.1 200 " and "\r\n"
+  return String(status->line).substring(13, status->len - 2);
 }
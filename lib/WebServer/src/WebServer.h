@@ -1,6 +1,7 @@
 /*
   WebServer.h - Dead simple web-server.
-  Supports only one simultaneous client, knows how to handle GET and POST.
+  Serves up to WEBSERVER_MAX_CLIENTS clients at once from one select() loop,
+  knows how to handle GET and POST.
 
   Copyright (c) 2014 Ivan Grokhotkov. All rights reserved.
 
@@ -37,6 +38,22 @@ enum HTTPAuthMethod { BASIC_AUTH, DIGEST_AUTH };
 
 #define HTTP_DOWNLOAD_UNIT_SIZE 1436
 
+#ifndef WEBSERVER_MAX_CLIENTS
+#define WEBSERVER_MAX_CLIENTS 4 // connection slots, more clients wait in the listen backlog
+#endif
+
+#ifndef HTTP_REQUEST_BUFLEN
+#define HTTP_REQUEST_BUFLEN 1436 // per slot; a longer request is read on from the socket
+#endif
+
+#ifndef HTTP_RESPONSE_BUFLEN
+#define HTTP_RESPONSE_BUFLEN 1436 // response head, and the body when it fits, go out in one write
+#endif
+
+#ifndef HTTP_RESPONSE_HEADERS_BUFLEN
+#define HTTP_RESPONSE_HEADERS_BUFLEN 512 // headers queued with sendHeader() for the next response
+#endif
+
 #ifndef HTTP_UPLOAD_BUFLEN
 #define HTTP_UPLOAD_BUFLEN 1436
 #endif
@@ -45,11 +62,24 @@ enum HTTPAuthMethod { BASIC_AUTH, DIGEST_AUTH };
 #define HTTP_MAX_POST_WAIT 5000 //ms to wait for POST data to arrive
 #define HTTP_MAX_SEND_WAIT 5000 //ms to wait for data chunk to be ACKed
 #define HTTP_MAX_CLOSE_WAIT 2000 //ms to wait for the client to close the connection
+#ifndef HTTP_MAX_KEEPALIVE_WAIT
+#define HTTP_MAX_KEEPALIVE_WAIT 5000 //ms an idle persistent connection is kept for its next request
+#endif
+#ifndef HTTP_MAX_KEEPALIVE_REQUESTS
+#define HTTP_MAX_KEEPALIVE_REQUESTS 100 //requests answered on one connection before it is closed
+#endif
 
 #define CONTENT_LENGTH_UNKNOWN ((size_t) -1)
 #define CONTENT_LENGTH_NOT_SET ((size_t) -2)
 
 class WebServer;
+class BoundarySearch;
+
+struct HTTPStatusLine {
+  uint16_t    code;
+  uint8_t     len;
+  const char* line; // "HTTP/1.1 200 OK\r\n"
+};
 
 typedef struct {
   HTTPUploadStatus status;
@@ -62,6 +92,8 @@ typedef struct {
 } HTTPUpload;
 
 #include "detail/RequestHandler.h"
+#include "detail/HTTPConnection.h"
+#include "detail/RouteTable.h"
 
 namespace fs {
 class FS;
@@ -88,15 +120,20 @@ public:
   void on(const Uri &uri, THandlerFunction fn);
   void on(const Uri &uri, HTTPMethod method, THandlerFunction fn); 
   void on(const Uri &uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn); //ufn handles file uploads
+  void onBody(const Uri &uri, HTTPMethod method, THandlerFunction fn); //fn reads the body itself, there is no arg("plain")
   void addHandler(RequestHandler* handler);
   void serveStatic(const char* uri, fs::FS& fs, const char* path, const char* cache_header = NULL );
   void onNotFound(THandlerFunction fn);  //called when handler is not assigned
   void onFileUpload(THandlerFunction ufn); //handle file uploads
+  void onRequestComplete(THandlerFunction fn); //called after each response, uri() and timings still valid
 
-  String uri() { return _currentUri; }
+  const String& uri() const { return _currentUri; }
   HTTPMethod method() { return _currentMethod; }
-  virtual WiFiClient client() { return _currentClient; }
+  virtual WiFiClient client() { flush(); return _currentClient; }
   HTTPUpload& upload() { return *_currentUpload; }
+  bool matched() { return _currentHandler != nullptr; } // a registered route took the request
+  uint32_t parseMicros() { return _parseMicros; }
+  uint32_t handleMicros() { return _handleMicros; }
 
   String pathArg(unsigned int i); // get request path argument by number
   String arg(String name);        // get request argument value by name
@@ -113,6 +150,22 @@ public:
 
   int clientContentLength() { return _clientContentLength; }      // return "content-length" of incoming HTTP header from "_currentClient"
 
+  // The body of a request for an onBody() handler, read once either way
+  char* body(size_t& len) { len = _body.left(); return _body.take(); } // in place in the receive buffer, nullptr unless all of it is there
+  Stream& bodyStream() { return _body; }                             // as it arrives, up to Content-Length
+
+  // parse the body of an onBody() request into an ArduinoJson document: in
+  // place when it was received whole, the document's strings then pointing
+  // into the receive buffer until the handler returns, else from the socket
+  template<typename T>
+  auto readJson(T& doc) -> decltype(deserializeJson(doc, (char*)nullptr, (size_t)0)) {
+    size_t len;
+    char* in = body(len);
+    if (in)
+      return deserializeJson(doc, in, len);
+    return deserializeJson(doc, bodyStream());
+  }
+
   String hostHeader();            // get request host header if available or empty String if not
 
   // send response to the client
@@ -127,40 +180,87 @@ public:
   void send_P(int code, PGM_P content_type, PGM_P content);
   void send_P(int code, PGM_P content_type, PGM_P content, size_t contentLength);
 
+  // send an ArduinoJson document (or variant) as application/json,
+  // serialized straight into the response without an intermediate String
+  template<typename T>
+  void sendJson(int code, const T& doc) {
+    // most fit in _out: serialize once and put the head in front
+    size_t len = serializeJson(doc, _out + _outLen, sizeof(_out) - _outLen);
+    if (_sendBuffered(code, "application/json", len))
+      return;
+    // too long: measure for Content-Length, then serialize in pieces
+    setContentLength(measureJson(doc));
+    _prepareHeader(code, "application/json", 0);
+    ContentWriter out(*this);
+    serializeJson(doc, out);
+  }
+
   void enableDelay(boolean value);
   void enableCORS(boolean value = true);
   void enableCrossOrigin(boolean value = true);
 
   void setContentLength(const size_t contentLength);
   void sendHeader(const String& name, const String& value, bool first = false);
+  void sendHeader(const char* name, const char* value, bool first = false);
   void sendContent(const String& content);
   void sendContent(const char* content, size_t contentLength);
   void sendContent_P(PGM_P content);
   void sendContent_P(PGM_P content, size_t size);
+  void flush(); // write out what send() and sendContent() have gathered so far
 
   static String urlDecode(const String& text);
 
   template<typename T>
   size_t streamFile(T &file, const String& contentType, const int code = 200) {
     _streamFileCore(file.size(), file.name(), contentType, code);
+    flush();
     return _currentClient.write(file);
   }
 
 protected:
+  // What serializers write to; ArduinoJson's generic Writer takes it as it is
+  class ContentWriter {
+  public:
+    explicit ContentWriter(WebServer& server) : _server(server) {}
+    size_t write(uint8_t c) {
+      if (_server._outLen < sizeof(_server._out))
+        _server._out[_server._outLen++] = c;
+      else
+        _server.sendContent((const char*)&c, 1);
+      return 1;
+    }
+    size_t write(const uint8_t* s, size_t n) {
+      _server.sendContent((const char*)s, n);
+      return n;
+    }
+  private:
+    WebServer& _server;
+  };
+
   virtual size_t _currentClientWrite(const char* b, size_t l) { return _currentClient.write( b, l ); }
   virtual size_t _currentClientWrite_P(PGM_P b, size_t l) { return _currentClient.write_P( b, l ); }
-  void _addRequestHandler(RequestHandler* handler);
+  virtual size_t _currentClientWritev(struct iovec* iov, int iovcnt) { return _currentClient.writev( iov, iovcnt ); }
+  void _addRequestHandler(RequestHandler* handler, const Uri* uri = nullptr, HTTPMethod method = HTTP_ANY);
+  void _accept();
+  void _serve(HTTPConnection& conn);
   void _handleRequest();
   void _finalizeResponse();
-  bool _parseRequest(WiFiClient& client);
+  bool _parseRequest(HTTPConnection& client);
   void _parseArguments(String data);
+  static const HTTPStatusLine* _statusLine(int code);
   static String _responseCodeToString(int code);
-  bool _parseForm(WiFiClient& client, String boundary, uint32_t len);
+  bool _parseForm(HTTPConnection& client, String boundary, uint32_t len);
   bool _parseFormUploadAborted();
-  void _uploadWriteByte(uint8_t b);
-  int _uploadReadByte(WiFiClient& client);
-  void _prepareHeader(String& response, int code, const char* content_type, size_t contentLength);
+  void _uploadWrite(const uint8_t* data, size_t len);
+  bool _uploadFile(HTTPConnection& client, const BoundarySearch& delimiter);
+  void _callUpload();
+  void _prepareHeader(int code, const char* content_type, size_t contentLength);
+  void _outWrite(const char* data, size_t len);
+  void _outWritev(const struct iovec* parts, int count);
+  void _outNumber(size_t n);
+  bool _sendBuffered(int code, const char* content_type, size_t len);
   bool _collectHeader(const char* headerName, const char* headerValue);
+  void _parseConnection(const char* value);
 
   void _streamFileCore(const size_t fileSize, const String & fileName, const String & contentType, const int code = 200);
 
@@ -175,20 +275,25 @@ protected:
 
   boolean     _corsEnabled;
   WiFiServer  _server;
+  HTTPConnection _clients[WEBSERVER_MAX_CLIENTS];
+  HTTPBodyStream _body; // of the request being served
 
   WiFiClient  _currentClient;
   HTTPMethod  _currentMethod;
   String      _currentUri;
   uint8_t     _currentVersion;
-  HTTPClientStatus _currentStatus;
-  unsigned long _statusChange;
   boolean     _nullDelay;
 
   RequestHandler*  _currentHandler;
   RequestHandler*  _firstHandler;
   RequestHandler*  _lastHandler;
+  RouteTable       _routes;
+  RouteMatch       _route;    // of the current request
   THandlerFunction _notFoundHandler;
   THandlerFunction _fileUploadHandler;
+  THandlerFunction _requestCompleteHandler;
+  uint32_t         _parseMicros;
+  uint32_t         _handleMicros;
 
   int              _currentArgCount;
   RequestArgument* _currentArgs;
@@ -201,10 +306,15 @@ protected:
   RequestArgument* _currentHeaders;
   size_t           _contentLength;
   int              _clientContentLength;	// "Content-Length" from header of incoming POST or GET request
-  String           _responseHeaders;
+  char             _responseHeaders[HTTP_RESPONSE_HEADERS_BUFLEN]; // from sendHeader(), rendered
+  size_t           _responseHeadersLen;
+  char             _out[HTTP_RESPONSE_BUFLEN]; // response bytes gathered for the next write
+  size_t           _outLen;
 
   String           _hostHeader;
   bool             _chunked;
+  bool             _clientKeepAlive; // the request allows the connection to persist
+  bool             _keepAlive;       // the response was sent with "Connection: keep-alive"
 
   String           _snonce;  // Store noance and opaque for future comparison
   String           _sopaque;
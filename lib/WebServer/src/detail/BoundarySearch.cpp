@@ -0,0 +1,28 @@
+#include <string.h>
+#include "BoundarySearch.h"
+
+bool BoundarySearch::begin(const char* boundary) {
+  size_t n = strlen(boundary);
+  _len = 0;
+  if (!n || n + 4 > sizeof(_pattern))
+    return false;
+  memcpy(_pattern, "\r\n--", 4);
+  memcpy(_pattern + 4, boundary, n);
+  _len = n + 4;
+  // how far the pattern may move when this byte is under its last position
+  memset(_shift, _len, sizeof(_shift));
+  for (size_t i = 0; i + 1 < _len; i++)
+    _shift[_pattern[i]] = _len - 1 - i;
+  return true;
+}
+
+size_t BoundarySearch::find(const uint8_t* data, size_t len) const {
+  if (!_len || len < _len)
+    return npos;
+  const uint8_t last = _pattern[_len - 1];
+  for (size_t i = 0; i + _len <= len; i += _shift[data[i + _len - 1]]) {
+    if (data[i + _len - 1] == last && memcmp(data + i, _pattern, _len - 1) == 0)
+      return i;
+  }
+  return npos;
+}
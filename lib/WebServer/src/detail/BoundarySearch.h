@@ -0,0 +1,37 @@
+/*
+  BoundarySearch.h - finds a multipart delimiter in blocks of upload data.
+
+  Boyer-Moore-Horspool over the delimiter ("\r\n--" and the boundary): the
+  byte under the pattern's last position says how far it may move, so on
+  file data that rarely resembles the boundary it skips close to a whole
+  pattern length per comparison. Holds no more than the pattern and its
+  shift table, and never looks before or past the block it is given.
+*/
+#ifndef BOUNDARYSEARCH_H
+#define BOUNDARYSEARCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef MULTIPART_MAX_DELIMITER
+#define MULTIPART_MAX_DELIMITER 74 // "\r\n--" and the longest boundary RFC 2046 allows, 70 characters
+#endif
+
+class BoundarySearch {
+public:
+  static const size_t npos = (size_t)-1;
+
+  bool begin(const char* boundary); // false when the boundary is empty or too long
+  size_t length() const { return _len; }
+  // Offset of the first whole delimiter in data, npos if there is none
+  size_t find(const uint8_t* data, size_t len) const;
+  // How much of data surely holds no delimiter, even one that len cuts short
+  size_t safe(size_t len) const { return len < _len ? 0 : len - _len + 1; }
+
+protected:
+  uint8_t _pattern[MULTIPART_MAX_DELIMITER];
+  uint8_t _shift[256];
+  size_t  _len;
+};
+
+#endif //BOUNDARYSEARCH_H
@@ -0,0 +1,190 @@
+#include <Arduino.h>
+#include "WiFiClient.h"
+#include "WebServer.h"
+
+HTTPConnection::HTTPConnection()
+: status(HC_NONE)
+, statusChange(0)
+, requests(0)
+, _len(0)
+, _pos(0)
+, _need(0)
+{
+}
+
+void HTTPConnection::begin(const WiFiClient& c) {
+  client = c;
+  status = HC_WAIT_READ;
+  statusChange = millis();
+  requests = 0;
+  request.reset();
+  _len = _pos = _need = 0;
+}
+
+void HTTPConnection::end() {
+  client = WiFiClient();
+  status = HC_NONE;
+  request.reset();
+  _len = _pos = _need = 0;
+}
+
+bool HTTPConnection::next() {
+  // a body longer than the buffer went on past it on the socket, and where
+  // it ends there is unknown once read around us: never take it for a request
+  if (_need > _len)
+    return false;
+  // skip a body the parser left unread, keep what was pipelined behind it
+  if (_need && _pos < _need)
+    _pos = _need;
+  memmove(_buf, _buf + _pos, _len - _pos);
+  _len -= _pos;
+  _pos = _need = 0;
+  requests++;
+  statusChange = millis();
+  request.reset();
+  if (_len)
+    _parse();
+  return true;
+}
+
+bool HTTPConnection::fill(bool readable) {
+  int n = client.available();
+  if (n <= 0) {
+    // readable with nothing to read means the peer has closed
+    return !readable && client.connected();
+  }
+  size_t room = sizeof(_buf) - _len;
+  if (!room)
+    return true;
+  int got = client.read(_buf + _len, (size_t)n < room ? (size_t)n : room);
+  if (got > 0) {
+    _len += got;
+    _parse();
+  }
+  return true;
+}
+
+void HTTPConnection::_parse() {
+  if (request.result() == HTTPRequestParser::INCOMPLETE && request.parse((const char*)_buf, _len) == HTTPRequestParser::DONE) {
+    _pos = request.headLength;
+    _need = request.headLength + request.contentLength;
+  }
+}
+
+int HTTPConnection::available() {
+  return (_len - _pos) + client.available();
+}
+
+int HTTPConnection::read() {
+  if (_pos < _len)
+    return _buf[_pos++];
+  return client.read();
+}
+
+int HTTPConnection::peek() {
+  if (_pos < _len)
+    return _buf[_pos];
+  return client.peek();
+}
+
+size_t HTTPConnection::readBytes(char* buffer, size_t length) {
+  size_t n = _len - _pos < length ? _len - _pos : length;
+  memcpy(buffer, _buf + _pos, n);
+  _pos += n;
+  if (n < length) {
+    int got = client.read((uint8_t*)buffer + n, length - n);
+    if (got > 0)
+      n += got;
+  }
+  return n;
+}
+
+char* HTTPConnection::take(size_t len) {
+  if (_len - _pos < len)
+    return nullptr;
+  char* p = (char*)_buf + _pos;
+  _pos += len;
+  return p;
+}
+
+size_t HTTPConnection::buffer(size_t want) {
+  // never wait for more than is left of the body
+  if (_need)
+    want = _need > _pos ? (want < _need - _pos ? want : _need - _pos) : 0;
+  if (want > sizeof(_buf))
+    want = sizeof(_buf);
+  if (_len - _pos >= want)
+    return _len - _pos;
+  if (_pos) {
+    // the head has been parsed, only the body's offset is still needed
+    memmove(_buf, _buf + _pos, _len - _pos);
+    _len -= _pos;
+    _need = _need > _pos ? _need - _pos : 0;
+    _pos = 0;
+  }
+  unsigned long start = millis();
+  while (_len < want) {
+    int n = client.available();
+    if (n > 0) {
+      size_t room = sizeof(_buf) - _len;
+      int got = client.read(_buf + _len, (size_t)n < room ? (size_t)n : room);
+      if (got > 0)
+        _len += got;
+    } else if (millis() - start >= _timeout || !client.connected()) {
+      break;
+    } else {
+      delay(1);
+    }
+  }
+  return _len;
+}
+
+void HTTPConnection::flush() {
+  _pos = _len;
+  client.flush();
+}
+
+char* HTTPBodyStream::take() {
+  char* p = _conn ? _conn->take(_left) : nullptr;
+  if (p)
+    _left = 0;
+  return p;
+}
+
+int HTTPBodyStream::available() {
+  if (!_left)
+    return 0;
+  size_t n = _conn->available();
+  return n < _left ? n : _left;
+}
+
+int HTTPBodyStream::read() {
+  if (!_left)
+    return -1;
+  int c = _conn->read();
+  if (c >= 0)
+    _left--;
+  return c;
+}
+
+int HTTPBodyStream::peek() {
+  return _left ? _conn->peek() : -1;
+}
+
+size_t HTTPBodyStream::readBytes(char* buffer, size_t length) {
+  if (length > _left)
+    length = _left;
+  size_t n = 0;
+  unsigned long start = millis();
+  while (n < length) {
+    if (_conn->available() > 0) {
+      n += _conn->readBytes(buffer + n, length - n);
+    } else if (millis() - start >= _timeout || !_conn->connected()) {
+      break;
+    } else {
+      delay(1);
+    }
+  }
+  _left -= n;
+  return n;
+}
@@ -0,0 +1,88 @@
+/*
+  HTTPConnection.h - one client slot of the WebServer connection table.
+
+  Collects the request head, and the body when it fits, in a fixed buffer
+  without ever blocking, so the server can wait on all its clients at once.
+  The head is parsed in place as it arrives. Once ready() the body is read
+  through the Stream interface: buffered bytes first, then whatever is
+  still on the socket, or a buffer full at a time in place for parsers
+  that work on blocks. HTTPBodyStream limits reads to the request's
+  Content-Length, and hands out a body that was buffered whole in place.
+*/
+#ifndef HTTPCONNECTION_H
+#define HTTPCONNECTION_H
+
+#include "HTTPRequestParser.h"
+
+static_assert(HTTP_REQUEST_BUFLEN <= 0xffff, "request views are 16 bit");
+
+class HTTPConnection : public Stream {
+public:
+  HTTPConnection();
+
+  void begin(const WiFiClient& client); // take a newly accepted client
+  void end();                           // drop our copy, the socket closes with the last one
+  bool next();                          // keep the connection for its next request, false if it cannot be
+  bool fill(bool readable);             // read what arrived, false once the peer is gone
+  bool ready() const { return _len == sizeof(_buf) || (_need && _len >= _need) || request.result() == HTTPRequestParser::ERROR; }
+  bool idle() const { return status == HC_WAIT_READ && requests && !_len; } // between keep-alive requests
+  int fd() const { return client.fd(); }
+  uint8_t connected() { return _pos < _len || client.connected(); }
+  // a parsed view as a C string: the delimiter after it is overwritten
+  const char* str(HTTPView v) { _buf[v.off + v.len] = 0; return (const char*)_buf + v.off; }
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t readBytes(char* buffer, size_t length) override;
+  using Stream::readBytes;
+  // the next len bytes where they are, if all are buffered; they count as read
+  char* take(size_t len);
+  // Waits up to the timeout until want bytes, at most the buffer's size, are
+  // unread, moving them to its front; returns how many there are at unread()
+  size_t buffer(size_t want);
+  const uint8_t* unread() const { return _buf + _pos; }
+  void skip(size_t n) { _pos += n; }
+  size_t write(uint8_t b) override { return client.write(b); }
+  size_t write(const uint8_t* buf, size_t size) override { return client.write(buf, size); }
+  using Print::write;
+  void flush() override;
+
+  WiFiClient       client;
+  HTTPClientStatus status;
+  unsigned long    statusChange;
+  uint16_t         requests;     // answered on this connection
+  HTTPRequestParser request;
+
+protected:
+  void _parse();
+
+  uint8_t _buf[HTTP_REQUEST_BUFLEN];
+  size_t  _len;   // bytes buffered
+  size_t  _pos;   // bytes already read back by the parser
+  size_t  _need;  // head plus Content-Length once the head is complete, else 0
+};
+
+class HTTPBodyStream : public Stream {
+public:
+  HTTPBodyStream() : _conn(nullptr), _left(0) {}
+
+  void begin(HTTPConnection* conn, size_t length) { _conn = conn; _left = length; }
+  void end() { _conn = nullptr; _left = 0; }
+  size_t left() const { return _left; }
+  char* take(); // the rest of the body in the receive buffer, nullptr unless it is all there
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t readBytes(char* buffer, size_t length) override; // waits for the body up to the timeout
+  using Stream::readBytes;
+  size_t write(uint8_t b) override { (void)b; return 0; }
+  using Print::write;
+
+protected:
+  HTTPConnection* _conn;
+  size_t          _left; // body bytes not read yet
+};
+
+#endif //HTTPCONNECTION_H
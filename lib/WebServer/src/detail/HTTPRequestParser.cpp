@@ -0,0 +1,188 @@
+#include <string.h>
+#include "HTTPRequestParser.h"
+
+// RFC 9110 tchar: what a method or header name may contain
+static bool isToken(char c) {
+  if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))
+    return true;
+  switch (c) {
+  case '!': case '#': case '$': case '%': case '&': case '\'': case '*': case '+':
+  case '-': case '.': case '^': case '_': case '`': case '|': case '~':
+    return true;
+  default:
+    return false;
+  }
+}
+
+static bool isControl(char c) {
+  return (uint8_t)c < ' ' || c == 0x7f;
+}
+
+static HTTPView view(uint16_t from, uint16_t to) {
+  HTTPView v = { from, (uint16_t)(to - from) };
+  return v;
+}
+
+void HTTPRequestParser::reset() {
+  method = path = query = view(0, 0);
+  versionMinor = 0;
+  headerCount = 0;
+  headLength = 0;
+  contentLength = 0;
+  _result = INCOMPLETE;
+  _state = S_METHOD;
+  _pos = _mark = _valueEnd = 0;
+  _name = view(0, 0);
+  _hasContentLength = false;
+}
+
+bool HTTPRequestParser::equals(const char* data, HTTPView v, const char* lower) {
+  for (uint16_t i = 0; i < v.len; i++, lower++) {
+    char c = data[v.off + i];
+    if (c >= 'A' && c <= 'Z')
+      c += 'a' - 'A';
+    if (c != *lower)
+      return false;
+  }
+  return *lower == 0;
+}
+
+bool HTTPRequestParser::_header(const char* data, HTTPView value) {
+  if (equals(data, _name, "content-length")) {
+    if (!value.len)
+      return false;
+    size_t n = 0;
+    for (uint16_t i = 0; i < value.len; i++) {
+      char d = data[value.off + i];
+      if (d < '0' || d > '9' || n > (0x7fffffff - 9) / 10)
+        return false;
+      n = n * 10 + (d - '0');
+    }
+    // repeated with another value is a smuggling attempt
+    if (_hasContentLength && n != contentLength)
+      return false;
+    contentLength = n;
+    _hasContentLength = true;
+  }
+  // only Content-Length bodies are read, a chunked one would be taken for requests
+  if (equals(data, _name, "transfer-encoding"))
+    return false;
+  if (headerCount < HTTP_MAX_HEADERS) {
+    headers[headerCount].name = _name;
+    headers[headerCount].value = value;
+    headerCount++;
+  }
+  return true;
+}
+
+HTTPRequestParser::Result HTTPRequestParser::parse(const char* data, size_t len) {
+  if (_result != INCOMPLETE)
+    return _result;
+  if (len > 0xffff)
+    len = 0xffff; // views are 16 bit
+  for (; _pos < len; _pos++) {
+    char c = data[_pos];
+    switch (_state) {
+    case S_METHOD:
+      if (c == ' ') {
+        if (_pos == _mark)
+          return _fail();
+        method = view(_mark, _pos);
+        _mark = _pos + 1;
+        _state = S_PATH;
+      } else if (!isToken(c)) {
+        return _fail();
+      }
+      break;
+    case S_PATH:
+      if (c == ' ' || c == '?') {
+        if (_pos == _mark)
+          return _fail();
+        path = view(_mark, _pos);
+        _mark = _pos + 1;
+        _state = c == '?' ? S_QUERY : S_VERSION;
+      } else if (isControl(c)) {
+        return _fail();
+      }
+      break;
+    case S_QUERY:
+      if (c == ' ') {
+        query = view(_mark, _pos);
+        _mark = _pos + 1;
+        _state = S_VERSION;
+      } else if (isControl(c)) {
+        return _fail();
+      }
+      break;
+    case S_VERSION:
+      if (c == '\r' || c == '\n') {
+        const char* v = data + _mark;
+        if (_pos - _mark != 8 || memcmp(v, "HTTP/1.", 7) != 0 || v[7] < '0' || v[7] > '9')
+          return _fail();
+        versionMinor = v[7] - '0';
+        _state = c == '\r' ? S_LINE_END : S_FIELD_START;
+      } else if (_pos - _mark >= 8) {
+        return _fail();
+      }
+      break;
+    case S_LINE_END:
+      if (c != '\n')
+        return _fail();
+      _state = S_FIELD_START;
+      break;
+    case S_FIELD_START:
+      if (c == '\r') {
+        _state = S_HEAD_END;
+        break;
+      }
+      if (c == '\n') {
+        headLength = _pos + 1;
+        return _result = DONE;
+      }
+      // also refuses obsolete line folding
+      if (!isToken(c))
+        return _fail();
+      _mark = _pos;
+      _state = S_NAME;
+      break;
+    case S_NAME:
+      if (c == ':') {
+        _name = view(_mark, _pos);
+        _state = S_VALUE_START;
+      } else if (!isToken(c)) {
+        return _fail();
+      }
+      break;
+    case S_VALUE_START:
+      if (c == ' ' || c == '\t')
+        break;
+      _mark = _valueEnd = _pos;
+      _state = S_VALUE;
+      // fall through
+    case S_VALUE:
+      // most of a head is values: skip plain bytes without the switch
+      while ((uint8_t)c > ' ' && c != 0x7f) {
+        _valueEnd = ++_pos;
+        if (_pos == len)
+          return INCOMPLETE;
+        c = data[_pos];
+      }
+      if (c == '\r' || c == '\n') {
+        if (!_header(data, view(_mark, _valueEnd)))
+          return _fail();
+        _state = c == '\r' ? S_LINE_END : S_FIELD_START;
+      } else if (c != ' ' && c != '\t') {
+        if (isControl(c))
+          return _fail();
+        _valueEnd = _pos + 1;
+      }
+      break;
+    case S_HEAD_END:
+      if (c != '\n')
+        return _fail();
+      headLength = _pos + 1;
+      return _result = DONE;
+    }
+  }
+  return INCOMPLETE;
+}
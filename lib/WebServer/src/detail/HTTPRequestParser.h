@@ -0,0 +1,70 @@
+/*
+  HTTPRequestParser.h - resumable HTTP/1.x request head parser.
+
+  Works in place on the caller's buffer and allocates nothing: method,
+  path, query and headers come out as offset/length views into it. Call
+  parse() again with the same buffer once more bytes have arrived and it
+  carries on where it stopped. Only Content-Length is interpreted, since
+  the caller needs it to know where the request ends; a Transfer-Encoding
+  header is an error, as the body would not be found.
+*/
+#ifndef HTTPREQUESTPARSER_H
+#define HTTPREQUESTPARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef HTTP_MAX_HEADERS
+#define HTTP_MAX_HEADERS 24 // headers kept per request, further ones are checked and dropped
+#endif
+
+struct HTTPView {
+  uint16_t off;
+  uint16_t len;
+};
+
+struct HTTPHeaderView {
+  HTTPView name;
+  HTTPView value; // without surrounding white space
+};
+
+class HTTPRequestParser {
+public:
+  enum Result { INCOMPLETE, DONE, ERROR };
+
+  HTTPRequestParser() { reset(); }
+
+  void reset();
+  Result parse(const char* data, size_t len); // data must start with the bytes passed before
+  Result result() const { return _result; }
+
+  static bool equals(const char* data, HTTPView v, const char* lower); // case-insensitive
+
+  HTTPView       method;
+  HTTPView       path;
+  HTTPView       query;         // after the '?', empty without one
+  uint8_t        versionMinor;  // HTTP/1.x
+  HTTPHeaderView headers[HTTP_MAX_HEADERS];
+  uint8_t        headerCount;
+  size_t         headLength;    // request line and headers up to and including the blank line
+  size_t         contentLength; // 0 without a Content-Length header
+
+protected:
+  enum State : uint8_t {
+    S_METHOD, S_PATH, S_QUERY, S_VERSION, S_LINE_END,
+    S_FIELD_START, S_NAME, S_VALUE_START, S_VALUE, S_HEAD_END
+  };
+
+  Result _fail() { return _result = ERROR; }
+  bool _header(const char* data, HTTPView value);
+
+  Result   _result;
+  State    _state;
+  uint16_t _pos;       // next byte to look at
+  uint16_t _mark;      // start of the token being read
+  uint16_t _valueEnd;  // end of the header value so far, trailing white space excluded
+  HTTPView _name;      // of the header being read
+  bool     _hasContentLength;
+};
+
+#endif //HTTPREQUESTPARSER_H
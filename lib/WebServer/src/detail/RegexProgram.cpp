@@ -0,0 +1,239 @@
+#include <ctype.h>
+#include <string.h>
+#include "RegexProgram.h"
+
+static void setBit(uint8_t* bits, uint8_t c) {
+  bits[c >> 3] |= 1 << (c & 7);
+}
+
+static void invert(uint8_t* bits) {
+  for (int i = 0; i < 32; i++)
+    bits[i] = ~bits[i];
+}
+
+// \d \w \s and their negations, as std::regex has them in the "C" locale
+static bool shorthand(char e, uint8_t* bits) {
+  uint8_t set[32] = { 0 };
+  switch (e | 0x20) {
+  case 'd':
+    for (int c = '0'; c <= '9'; c++)
+      setBit(set, c);
+    break;
+  case 'w':
+    for (int c = 0; c < 128; c++)
+      if (isalnum(c) || c == '_')
+        setBit(set, c);
+    break;
+  case 's':
+    for (const char* c = " \t\n\v\f\r"; *c; c++)
+      setBit(set, *c);
+    break;
+  default:
+    return false;
+  }
+  if (e >= 'A' && e <= 'Z')
+    invert(set);
+  for (int i = 0; i < 32; i++)
+    bits[i] |= set[i];
+  return true;
+}
+
+// One character of a class, escaped or not; nullptr on what only std::regex knows
+static const char* classChar(const char* p, uint8_t* c) {
+  if (*p == '\\') {
+    p++;
+    if (!*p || isalnum((uint8_t)*p))
+      return nullptr;
+  }
+  *c = *p;
+  return p + 1;
+}
+
+// Parses the class after its '[' into bits, returning what follows the ']'
+const char* RegexProgram::_class(const char* p, uint8_t* bits) {
+  bool negate = *p == '^';
+  if (negate)
+    p++;
+  if (*p == ']')
+    return nullptr; // [] and [^] mean something else in ECMAScript
+  while (*p && *p != ']') {
+    if (*p == '\\' && shorthand(p[1], bits)) {
+      p += 2;
+      continue;
+    }
+    uint8_t lo, hi;
+    p = classChar(p, &lo);
+    if (!p)
+      return nullptr;
+    hi = lo;
+    if (*p == '-' && p[1] && p[1] != ']') {
+      p = classChar(p + 1, &hi);
+      if (!p || hi < lo)
+        return nullptr;
+    }
+    for (int c = lo; c <= hi; c++)
+      setBit(bits, c);
+  }
+  if (*p != ']')
+    return nullptr;
+  if (negate)
+    invert(bits);
+  return p + 1;
+}
+
+bool RegexProgram::compile(const char* p) {
+  _program.clear();
+  _classes.clear();
+  _groups = 0;
+  uint8_t open[REGEX_MAX_GROUPS];
+  uint8_t depth = 0;
+  while (*p) {
+    Node node = { CHAR, ONCE, 0 };
+    uint8_t bits[32] = { 0 };
+    char c = *p++;
+    switch (c) {
+    case '^':
+      node.op = BOL;
+      break;
+    case '$':
+      node.op = EOL;
+      break;
+    case '.':
+      node.op = ANY;
+      break;
+    case '(':
+      if (*p == '?' || _groups == REGEX_MAX_GROUPS)
+        return false;
+      node.op = OPEN;
+      node.arg = _groups;
+      open[depth++] = _groups++;
+      break;
+    case ')':
+      if (!depth)
+        return false;
+      node.op = CLOSE;
+      node.arg = open[--depth];
+      break;
+    case '[':
+      p = _class(p, bits);
+      if (!p)
+        return false;
+      node.op = CLASS;
+      break;
+    case '\\':
+      c = *p++;
+      if (shorthand(c, bits)) {
+        node.op = CLASS;
+      } else if (!c || isalnum((uint8_t)c)) {
+        return false; // \b, back references, control escapes
+      } else {
+        node.arg = c;
+      }
+      break;
+    case '|': case '*': case '+': case '?': case '{': case '}': case ']':
+      return false;
+    default:
+      node.arg = c;
+      break;
+    }
+    if (node.op == CLASS) {
+      if (_classes.size() / 32 > 0xff)
+        return false;
+      node.arg = _classes.size() / 32;
+      _classes.insert(_classes.end(), bits, bits + 32);
+    }
+
+    if (*p == '*' || *p == '+' || *p == '?') {
+      // only single characters repeat; a repeated group resets its captures
+      if (node.op != CHAR && node.op != ANY && node.op != CLASS)
+        return false;
+      node.repeat = *p == '*' ? STAR : *p == '+' ? PLUS : OPTIONAL;
+      p++;
+    }
+    if (*p == '*' || *p == '+' || *p == '?' || *p == '{')
+      return false; // lazy, stacked or counted
+    _program.push_back(node);
+  }
+  return depth == 0;
+}
+
+bool RegexProgram::_atom(const Node& node, char c) const {
+  switch (node.op) {
+  case CHAR:
+    return c == (char)node.arg;
+  case ANY:
+    return c != '\n' && c != '\r';
+  default:
+    const uint8_t* bits = &_classes[node.arg * 32];
+    return bits[(uint8_t)c >> 3] & (1 << ((uint8_t)c & 7));
+  }
+}
+
+// Recurses only where it may have to come back, so never deeper than the program
+bool RegexProgram::_match(size_t pc, size_t i, Match& m) const {
+  for (; pc < _program.size(); pc++) {
+    const Node& node = _program[pc];
+    switch (node.op) {
+    case BOL:
+      if (i != 0)
+        return false;
+      break;
+    case EOL:
+      if (i != m.len)
+        return false;
+      break;
+    case OPEN:
+    case CLOSE: {
+      size_t* capture = &m.captures[2 * node.arg + (node.op == CLOSE)];
+      size_t saved = *capture;
+      *capture = i;
+      if (_match(pc + 1, i, m))
+        return true;
+      *capture = saved;
+      return false;
+    }
+    default:
+      if (node.repeat == ONCE) {
+        if (i >= m.len || !_atom(node, m.s[i]))
+          return false;
+        i++;
+        break;
+      }
+      // greedy: take all that match, then give back one at a time
+      size_t most = node.repeat == OPTIONAL ? 1 : m.len - i;
+      size_t least = node.repeat == PLUS ? 1 : 0;
+      size_t n = 0;
+      while (n < most && i + n < m.len && _atom(node, m.s[i + n]))
+        n++;
+      for (; n >= least; n--) {
+        if (_match(pc + 1, i + n, m))
+          return true;
+        if (n == 0)
+          break;
+      }
+      return false;
+    }
+  }
+  return true;
+}
+
+bool RegexProgram::search(const char* s, size_t len, size_t captures[2 * REGEX_MAX_GROUPS]) const {
+  Match m = { s, len, captures };
+  for (uint8_t g = 0; g < 2 * _groups; g++)
+    captures[g] = npos;
+  bool anchored = !_program.empty() && _program[0].op == BOL;
+  bool literal = !_program.empty() && _program[0].op == CHAR && _program[0].repeat == ONCE;
+  for (size_t start = 0; start <= len; start++) {
+    if (literal) {
+      const char* next = (const char*)memchr(s + start, _program[0].arg, len - start);
+      if (!next)
+        return false;
+      start = next - s;
+    }
+    if (_match(0, start, m))
+      return true;
+    if (anchored)
+      break;
+  }
+  return false;
+}
@@ -0,0 +1,60 @@
+/*
+  RegexProgram.h - a compiled matcher for the regular expressions routes use.
+
+  Covers the ECMAScript subset that URI patterns are written in: literals,
+  '.', [classes] with ranges, \d \w \s and their negations, the greedy
+  quantifiers * + ?, ^ and $, and capture groups that are not themselves
+  quantified. It matches the way std::regex_search does, backtracking
+  leftmost first, but without touching the heap and never recursing
+  deeper than the pattern is long. compile() fails on anything else
+  (alternation, {n,m}, lazy quantifiers, back references and so on),
+  and the caller falls back to std::regex for those.
+*/
+#ifndef REGEXPROGRAM_H
+#define REGEXPROGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#ifndef REGEX_MAX_GROUPS
+#define REGEX_MAX_GROUPS 8 // capture groups a compiled pattern may have
+#endif
+
+class RegexProgram {
+public:
+  static const size_t npos = (size_t)-1;
+
+  RegexProgram() : _groups(0) {}
+
+  bool compile(const char* pattern);  // false: outside the subset, use std::regex
+  uint8_t groups() const { return _groups; }
+  // Finds the first match; captures gets start and end of every group, npos for one that took no part
+  bool search(const char* s, size_t len, size_t captures[2 * REGEX_MAX_GROUPS]) const;
+
+protected:
+  enum Op : uint8_t { CHAR, ANY, CLASS, OPEN, CLOSE, BOL, EOL };
+  enum Repeat : uint8_t { ONCE, STAR, PLUS, OPTIONAL };
+
+  struct Node {
+    Op      op;
+    Repeat  repeat;
+    uint8_t arg; // the character, class index or group number
+  };
+
+  struct Match {
+    const char* s;
+    size_t      len;
+    size_t*     captures;
+  };
+
+  bool _atom(const Node& node, char c) const;
+  bool _match(size_t pc, size_t i, Match& m) const;
+  const char* _class(const char* p, uint8_t* bits);
+
+  std::vector<Node>    _program;
+  std::vector<uint8_t> _classes; // 32 byte bitmaps
+  uint8_t              _groups;
+};
+
+#endif //REGEXPROGRAM_H
@@ -11,6 +11,7 @@ public:
     virtual bool canUpload(String uri) { (void) uri; return false; }
     virtual bool handle(WebServer& server, HTTPMethod requestMethod, String requestUri) { (void) server; (void) requestMethod; (void) requestUri; return false; }
     virtual void upload(WebServer& server, String requestUri, HTTPUpload& upload) { (void) server; (void) requestUri; (void) upload; }
+    virtual bool readsBody() { return false; } // true: the server leaves the request body to handle()
 
     RequestHandler* next() { return _next; }
     void next(RequestHandler* r) { _next = r; }
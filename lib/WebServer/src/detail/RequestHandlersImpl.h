@@ -10,11 +10,12 @@ using namespace mime;
 
 class FunctionRequestHandler : public RequestHandler {
 public:
-    FunctionRequestHandler(WebServer::THandlerFunction fn, WebServer::THandlerFunction ufn, const Uri &uri, HTTPMethod method)
+    FunctionRequestHandler(WebServer::THandlerFunction fn, WebServer::THandlerFunction ufn, const Uri &uri, HTTPMethod method, bool readsBody = false)
     : _fn(fn)
     , _ufn(ufn)
     , _uri(uri.clone())
     , _method(method)
+    , _readsBody(readsBody)
     {
         _uri->initPathArgs(pathArgs);
     }
@@ -53,11 +54,19 @@ public:
             _ufn();
     }
 
+    bool readsBody() override { return _readsBody; }
+
+    // For a route the WebServer route table has matched: _uri is not asked again
+    void handleMatched() { _fn(); }
+    bool canUploadMatched() const { return _ufn && (_method == HTTP_ANY || _method == HTTP_POST); }
+    void uploadMatched() { _ufn(); }
+
 protected:
     WebServer::THandlerFunction _fn;
     WebServer::THandlerFunction _ufn;
     Uri *_uri;
     HTTPMethod _method;
+    bool _readsBody;
 };
 
 class StaticRequestHandler : public RequestHandler {
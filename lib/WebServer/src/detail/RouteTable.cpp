@@ -0,0 +1,181 @@
+#include <Arduino.h>
+#include "WebServer.h"
+
+// Orders segments like strcmp, without needing them NUL-terminated
+static int compare(const String& a, const char* s, size_t len) {
+  size_t n = a.length() < len ? a.length() : len;
+  int c = memcmp(a.c_str(), s, n);
+  if (c)
+    return c;
+  return a.length() < len ? -1 : a.length() > len;
+}
+
+// Whether a pattern segment only matches itself
+static bool isLiteral(const String& segment, Uri::Syntax syntax) {
+  if (syntax == Uri::BRACES)
+    return segment.indexOf('{') < 0;
+  if (syntax == Uri::GLOB)
+    return strpbrk(segment.c_str(), "*?[\\") == nullptr;
+  return true;
+}
+
+RouteTable::Node::~Node() {
+  for (Node* child : children)
+    delete child;
+  delete param;
+}
+
+RouteTable::RouteTable()
+: _count(0)
+, _tails(0)
+{
+}
+
+RouteTable::~RouteTable() {
+}
+
+RouteTable::Node* RouteTable::_child(Node* node, const String& segment) {
+  size_t lo = 0, hi = node->children.size();
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    int c = compare(node->children[mid]->segment, segment.c_str(), segment.length());
+    if (c == 0)
+      return node->children[mid];
+    if (c < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  Node* child = new Node();
+  child->segment = segment;
+  node->children.insert(node->children.begin() + lo, child);
+  return child;
+}
+
+const RouteTable::Node* RouteTable::_find(const Node* node, const char* segment, size_t len) const {
+  size_t lo = 0, hi = node->children.size();
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    int c = compare(node->children[mid]->segment, segment, len);
+    if (c == 0)
+      return node->children[mid];
+    if (c < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return nullptr;
+}
+
+void RouteTable::add(RequestHandler* handler, const Uri* uri, HTTPMethod method) {
+  Route route = { handler, _count++, method };
+  std::vector<Node*> nodes(1, &_root);
+  bool compiled = false;
+  if (uri && uri->syntax() != Uri::OPAQUE && uri->pattern().startsWith("/")) {
+    const String& pattern = uri->pattern();
+    uint8_t args = 0;
+    int pos = 1;
+    while (true) {
+      int end = pattern.indexOf('/', pos);
+      if (end < 0)
+        end = pattern.length();
+      String segment = pattern.substring(pos, end);
+      Node* node = nodes.back();
+      if (uri->syntax() == Uri::BRACES && segment == "{}" && args < WEBSERVER_MAX_PATH_ARGS) {
+        if (!node->param)
+          node->param = new Node();
+        nodes.push_back(node->param);
+        args++;
+      } else if (isLiteral(segment, uri->syntax())) {
+        nodes.push_back(_child(node, segment));
+      } else {
+        break; // the handler matches the rest itself
+      }
+      if (end == (int)pattern.length()) {
+        compiled = true;
+        break;
+      }
+      pos = end + 1;
+    }
+  }
+
+  for (Node* node : nodes) {
+    if (node->first > route.order)
+      node->first = route.order;
+    if (!compiled && node->firstTail > route.order)
+      node->firstTail = route.order;
+  }
+  if (compiled) {
+    nodes.back()->ends.push_back(route);
+  } else {
+    nodes.back()->tails.push_back(route);
+    _tails++;
+  }
+}
+
+bool RouteTable::match(HTTPMethod method, const String& path, RouteMatch& m) const {
+  Walk w = { method, path, m, false, 0xffff, 0, {} };
+  m.handler = nullptr;
+  m.compiled = false;
+  m.argCount = 0;
+  // "*" and absolute URIs have no segments, only the root's tails get a look
+  size_t pos = path.startsWith("/") ? 1 : path.length() + 1;
+  // Compiled routes first: they are cheap to check, and only a tail
+  // registered before the best of them has to be asked at all
+  _walk(&_root, pos, w);
+  if (_tails) {
+    w.tails = true;
+    _walk(&_root, pos, w);
+  }
+  return m.handler != nullptr;
+}
+
+// pos is where the next segment starts, past the end once all are consumed
+void RouteTable::_walk(const Node* node, size_t pos, Walk& w) const {
+  if ((w.tails ? node->firstTail : node->first) >= w.order)
+    return;
+  for (const Route& route : node->tails) {
+    if (!w.tails || route.order >= w.order)
+      break;
+    if (route.handler->canHandle(w.method, w.path)) {
+      w.order = route.order;
+      w.match.handler = route.handler;
+      w.match.compiled = false;
+      w.match.argCount = 0;
+      break;
+    }
+  }
+
+  size_t len = w.path.length();
+  if (pos > len) {
+    if (w.tails)
+      return;
+    for (const Route& route : node->ends) {
+      if (route.order >= w.order)
+        break;
+      if (route.method == HTTP_ANY || route.method == w.method) {
+        w.order = route.order;
+        w.match.handler = route.handler;
+        w.match.compiled = true;
+        w.match.argCount = w.argCount;
+        memcpy(w.match.args, w.args, w.argCount * sizeof(HTTPView));
+        break;
+      }
+    }
+    return;
+  }
+
+  const char* segment = w.path.c_str() + pos;
+  const char* slash = (const char*)memchr(segment, '/', len - pos);
+  size_t n = slash ? (size_t)(slash - segment) : len - pos;
+  const Node* child = _find(node, segment, n);
+  if (child)
+    _walk(child, pos + n + 1, w);
+  if (node->param) {
+    w.args[w.argCount].off = pos;
+    w.args[w.argCount].len = n;
+    w.argCount++;
+    _walk(node->param, pos + n + 1, w);
+    w.argCount--;
+  }
+}
@@ -0,0 +1,77 @@
+/*
+  RouteTable.h - the WebServer handlers compiled into a path segment trie.
+
+  A route added with on() for a plain, brace or glob Uri is split on '/'
+  into trie nodes, a {} segment becoming the node's one parameter child.
+  A request walks the trie once, finding each literal segment by binary
+  search and capturing {} values as views into the path. What the trie
+  cannot index (a regex, the rest of a glob after its first wildcard, a
+  handler from addHandler()) hangs off the deepest literal node of its
+  pattern and is asked through canHandle() when the walk gets there.
+  As with the old handler chain, the route registered first wins.
+*/
+#ifndef ROUTETABLE_H
+#define ROUTETABLE_H
+
+#include <vector>
+
+#ifndef WEBSERVER_MAX_PATH_ARGS
+#define WEBSERVER_MAX_PATH_ARGS 8 // {} the trie captures per route, a route with more goes through canHandle()
+#endif
+
+struct RouteMatch {
+  RequestHandler* handler;  // nullptr when nothing matched
+  bool            compiled; // matched by the trie: the handler need not look at the URI again
+  uint8_t         argCount;
+  HTTPView        args[WEBSERVER_MAX_PATH_ARGS]; // {} values, views into the path
+};
+
+class RouteTable {
+public:
+  RouteTable();
+  ~RouteTable();
+
+  void add(RequestHandler* handler, const Uri* uri, HTTPMethod method); // uri nullptr: only the handler knows
+  bool match(HTTPMethod method, const String& path, RouteMatch& m) const;
+  uint16_t size() const { return _count; }
+
+protected:
+  struct Route {
+    RequestHandler* handler;
+    uint16_t        order;  // of registration, lower wins
+    HTTPMethod      method;
+  };
+
+  struct Node {
+    Node() : param(nullptr), first(0xffff), firstTail(0xffff) {}
+    ~Node();
+
+    String             segment;
+    std::vector<Node*> children; // literal segments, sorted
+    Node*              param;    // a {} segment
+    std::vector<Route> ends;     // compiled routes ending here
+    std::vector<Route> tails;    // routes that take over matching from here
+    uint16_t           first;     // lowest order in this subtree, to skip one that cannot win
+    uint16_t           firstTail; // the same for tails only
+  };
+
+  struct Walk {
+    HTTPMethod    method;
+    const String& path;
+    RouteMatch&   match;
+    bool          tails;  // second pass: ask the tails that could still beat the compiled route
+    uint16_t      order;  // of the best route so far
+    uint8_t       argCount;
+    HTTPView      args[WEBSERVER_MAX_PATH_ARGS];
+  };
+
+  Node* _child(Node* node, const String& segment);
+  const Node* _find(const Node* node, const char* segment, size_t len) const;
+  void _walk(const Node* node, size_t pos, Walk& w) const;
+
+  Node     _root;
+  uint16_t _count;
+  uint16_t _tails;
+};
+
+#endif //ROUTETABLE_H
@@ -13,6 +13,10 @@ class UriBraces : public Uri {
             return new UriBraces(_uri);
         };
 
+        Syntax syntax() const override final {
+            return BRACES;
+        }
+
         void initPathArgs(std::vector<String> &pathArgs) override final {
             int numParams = 0, start = 0;
             do {
@@ -14,6 +14,10 @@ class UriGlob : public Uri {
             return new UriGlob(_uri);
         };
 
+        Syntax syntax() const override final {
+            return GLOB;
+        }
+
         bool canHandle(const String &requestUri, __attribute__((unused)) std::vector<String> &pathArgs) override final {
             return fnmatch(_uri.c_str(), requestUri.c_str(), 0) == 0;
         }
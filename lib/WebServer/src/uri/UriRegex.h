@@ -2,43 +2,72 @@
 #define URI_REGEX_H
 
 #include "Uri.h"
+#include "detail/RegexProgram.h"
+#include <memory>
 #include <regex>
 
+// The pattern is compiled once, when the route is registered: into a
+// RegexProgram when it sticks to the common subset, else into a std::regex
+// kept for good.
 class UriRegex : public Uri {
 
     public:
-        explicit UriRegex(const char *uri) : Uri(uri) {};
-        explicit UriRegex(const String &uri) : Uri(uri) {};
+        explicit UriRegex(const char *uri) : Uri(uri), _compiled(false) {};
+        explicit UriRegex(const String &uri) : Uri(uri), _compiled(false) {};
 
         Uri* clone() const override final {
             return new UriRegex(_uri);
         };
 
+        Syntax syntax() const override final {
+            return OPAQUE;
+        }
+
         void initPathArgs(std::vector<String> &pathArgs) override final {
-            std::regex rgx((_uri + "|").c_str());
-            std::smatch matches;
-            std::string s{""};
-            std::regex_search(s, matches, rgx);
-            pathArgs.resize(matches.size() - 1);
+            _compile();
+            pathArgs.resize(_regex ? _regex->mark_count() : _program.groups());
         }
 
         bool canHandle(const String &requestUri, std::vector<String> &pathArgs) override final {
             if (Uri::canHandle(requestUri, pathArgs))
                 return true;
 
-            unsigned int pathArgIndex = 0;
-            std::regex rgx(_uri.c_str());
-            std::smatch matches;
-            std::string s(requestUri.c_str());
-            if (std::regex_search(s, matches, rgx)) {
-                for (size_t i = 1; i < matches.size(); ++i) {  // skip first
-                    pathArgs[pathArgIndex] = String(matches[i].str().c_str());
-                    pathArgIndex++;
+            _compile();
+            if (!_regex) {
+                size_t captures[2 * REGEX_MAX_GROUPS];
+                if (!_program.search(requestUri.c_str(), requestUri.length(), captures))
+                    return false;
+                for (size_t i = 0; i < _program.groups() && i < pathArgs.size(); ++i) {
+                    if (captures[2 * i] == RegexProgram::npos)
+                        pathArgs[i] = String();
+                    else
+                        pathArgs[i] = requestUri.substring(captures[2 * i], captures[2 * i + 1]);
+                }
+                return true;
+            }
+
+            std::cmatch matches;
+            if (std::regex_search(requestUri.c_str(), matches, *_regex)) {
+                for (size_t i = 1; i < matches.size() && i <= pathArgs.size(); ++i) {  // skip first
+                    pathArgs[i - 1] = String(matches[i].str().c_str());
                 }
                 return true;
             }
             return false;
         }
+
+    protected:
+        void _compile() {
+            if (_compiled)
+                return;
+            _compiled = true;
+            if (!_program.compile(_uri.c_str()))
+                _regex.reset(new std::regex(_uri.c_str()));
+        }
+
+        bool _compiled;
+        RegexProgram _program;
+        std::unique_ptr<std::regex> _regex; // for what RegexProgram does not cover
 };
 
 #endif
@@ -435,6 +435,69 @@ size_t WiFiClient::write(const uint8_t *buf, size_t size)
     return totalBytesSent;
 }
 
+size_t WiFiClient::writev(struct iovec *iov, int iovcnt)
+{
+    int res =0;
+    int retry = WIFI_CLIENT_MAX_WRITE_RETRY;
+    int socketFileDescriptor = fd();
+    size_t totalBytesSent = 0;
+
+    if(!_connected || (socketFileDescriptor < 0)) {
+        return 0;
+    }
+
+    while(retry && iovcnt) {
+        //use select to make sure the socket is ready for writing
+        fd_set set;
+        struct timeval tv;
+        FD_ZERO(&set);        // empties the set
+        FD_SET(socketFileDescriptor, &set); // adds FD to the set
+        tv.tv_sec = 0;
+        tv.tv_usec = WIFI_CLIENT_SELECT_TIMEOUT_US;
+        retry--;
+
+        if(select(socketFileDescriptor + 1, NULL, &set, NULL, &tv) < 0) {
+            return 0;
+        }
+
+        if(FD_ISSET(socketFileDescriptor, &set)) {
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov;
+            msg.msg_iovlen = iovcnt;
+            res = sendmsg(socketFileDescriptor, &msg, MSG_DONTWAIT);
+            if(res > 0) {
+                totalBytesSent += res;
+                // drop what went out, the rest is retried
+                size_t sent = res;
+                while(iovcnt && sent >= iov->iov_len) {
+                    sent -= iov->iov_len;
+                    iov++;
+                    iovcnt--;
+                }
+                if(iovcnt) {
+                    iov->iov_base = (uint8_t*)iov->iov_base + sent;
+                    iov->iov_len -= sent;
+                }
+                retry = WIFI_CLIENT_MAX_WRITE_RETRY;
+            }
+            else if(res < 0) {
+                log_e("fail on fd %d, errno: %d, \"%s\"", fd(), errno, strerror(errno));
+                if(errno != EAGAIN) {
+                    //if resource was busy, can try again, otherwise give up
+                    stop();
+                    res = 0;
+                    retry = 0;
+                }
+            }
+            else {
+                // Try again
+            }
+        }
+    }
+    return totalBytesSent;
+}
+
 size_t WiFiClient::write_P(PGM_P buf, size_t size)
 {
     return write(buf, size);
@@ -498,6 +561,24 @@ int WiFiClient::available()
     return res;
 }
 
+// lwip has no ioctl for the free send buffer, but a socket only selects
+// writable while more than TCP_SNDLOWAT bytes of it are free
+int WiFiClient::availableForWrite()
+{
+    int socketFileDescriptor = fd();
+    if(!_connected || (socketFileDescriptor < 0)) {
+        return 0;
+    }
+    fd_set set;
+    struct timeval tv = {0, 0};
+    FD_ZERO(&set);
+    FD_SET(socketFileDescriptor, &set);
+    if(select(socketFileDescriptor + 1, NULL, &set, NULL, &tv) <= 0 || !FD_ISSET(socketFileDescriptor, &set)) {
+        return 0;
+    }
+    return TCP_SNDLOWAT;
+}
+
 // Though flushing means to send all pending data,
 // seems that in Arduino it also means to clear RX
 void WiFiClient::flush() {
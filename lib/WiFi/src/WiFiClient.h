@@ -25,6 +25,8 @@
 #include "Client.h"
 #include <memory>
 
+struct iovec;
+
 class WiFiClientSocketHandle;
 class WiFiClientRxBuffer;
 
@@ -57,7 +59,9 @@ public:
     size_t write(const uint8_t *buf, size_t size);
     size_t write_P(PGM_P buf, size_t size);
     size_t write(Stream &stream);
+    size_t writev(struct iovec *iov, int iovcnt); // gathers into as few segments as it can, consumes iov
     int available();
+    int availableForWrite();
     int read();
     int read(uint8_t *buf, size_t size);
     int peek();
@@ -25,6 +25,7 @@
 #include "WiFi.h"
 #include "WiFiGeneric.h"
 #include "WiFiSTA.h"
+#include <Preferences.h>
 
 extern "C" {
 #include <stdint.h>
@@ -118,6 +119,8 @@ bool WiFiSTAClass::_useStaticIp = false;
 wifi_auth_mode_t WiFiSTAClass::_minSecurity = WIFI_AUTH_WPA2_PSK;
 wifi_scan_method_t WiFiSTAClass::_scanMethod = WIFI_FAST_SCAN;
 wifi_sort_method_t WiFiSTAClass::_sortMethod = WIFI_CONNECT_AP_BY_SIGNAL;
+bool WiFiSTAClass::_fastLease = false;
+bool WiFiSTAClass::_fastConnected = false;
 
 static wl_status_t _sta_status = WL_NO_SHIELD;
 static EventGroupHandle_t _sta_status_group = NULL;
@@ -322,6 +325,108 @@ wl_status_t WiFiSTAClass::begin()
     return status();
 }
 
+// Last good association, kept in NVS for beginFast()
+typedef struct {
+    char ssid[33];
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+} wifi_fast_cache_t;
+
+static const char * WIFI_FAST_NAMESPACE = "wifi_fast";
+
+static bool wifi_fast_load(wifi_fast_cache_t &cache)
+{
+    Preferences prefs;
+    if(!prefs.begin(WIFI_FAST_NAMESPACE, true)) {
+        return false;
+    }
+    bool ok = prefs.getBytes("cache", &cache, sizeof(cache)) == sizeof(cache);
+    prefs.end();
+    return ok && cache.channel;
+}
+
+static void wifi_fast_store(const wifi_fast_cache_t &cache)
+{
+    wifi_fast_cache_t current;
+    if(wifi_fast_load(current) && !memcmp(&current, &cache, sizeof(cache))) {
+        return; // unchanged, spare the flash
+    }
+    Preferences prefs;
+    if(prefs.begin(WIFI_FAST_NAMESPACE, false)) {
+        prefs.putBytes("cache", &cache, sizeof(cache));
+        prefs.end();
+    }
+}
+
+/**
+ * Connect using the cached BSSID, channel and lease, falling back to a scan.
+ * A reused lease is a static configuration: DHCP is not run until the
+ * next scan connect, which also refreshes the cache.
+ * @param ssid          const char*          Pointer to the SSID string.
+ * @param passphrase    const char *         Optional. Passphrase. Valid characters in a passphrase must be between ASCII 32-126 (decimal).
+ * @param timeout_ms    uint32_t             Time allowed for each of the two attempts
+ * @param reuseLease    bool                 Apply the cached IP configuration on the directed attempt
+ * @return wl_status_t
+ */
+wl_status_t WiFiSTAClass::beginFast(const char* ssid, const char *passphrase, uint32_t timeout_ms, bool reuseLease)
+{
+    wifi_fast_cache_t cache;
+    _fastConnected = false;
+    if(ssid && wifi_fast_load(cache) && !strncmp(cache.ssid, ssid, sizeof(cache.ssid))) {
+        if(reuseLease && cache.ip) {
+            _fastLease = config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.subnet), IPAddress(cache.dns));
+        }
+        if(begin(ssid, passphrase, cache.channel, cache.bssid) != WL_CONNECT_FAILED
+           && WiFiGenericClass::waitStatusBits(STA_HAS_IP_BIT, timeout_ms)) {
+            _fastConnected = true;
+            return WL_CONNECTED;
+        }
+        log_w("cached AP did not answer, scanning");
+        forgetFast();
+        esp_wifi_disconnect();
+    }
+
+    if(begin(ssid, passphrase) == WL_CONNECT_FAILED || !WiFiGenericClass::waitStatusBits(STA_HAS_IP_BIT, timeout_ms)) {
+        return status();
+    }
+    memset(&cache, 0, sizeof(cache));
+    _wifi_strncpy(cache.ssid, ssid, sizeof(cache.ssid) - 1);
+    uint8_t* bssid = BSSID();
+    if(bssid) {
+        memcpy(cache.bssid, bssid, 6);
+        wifi_second_chan_t second;
+        esp_wifi_get_channel(&cache.channel, &second);
+        cache.ip = localIP();
+        cache.gateway = gatewayIP();
+        cache.subnet = subnetMask();
+        cache.dns = dnsIP();
+        wifi_fast_store(cache);
+    }
+    return WL_CONNECTED;
+}
+
+/**
+ * Erase the fast connect cache and go back to DHCP if a cached lease
+ * was applied. The next beginFast() scans.
+ */
+void WiFiSTAClass::forgetFast()
+{
+    Preferences prefs;
+    if(prefs.begin(WIFI_FAST_NAMESPACE, false)) {
+        prefs.remove("cache");
+        prefs.end();
+    }
+    if(_fastLease) {
+        set_esp_interface_ip(ESP_IF_WIFI_STA);
+        _useStaticIp = false;
+        _fastLease = false;
+    }
+}
+
 /**
  * will force a disconnect and then start reconnecting to AP
  * @return true when successful
@@ -49,6 +49,13 @@ public:
     wl_status_t begin(char* ssid, char *passphrase = NULL, int32_t channel = 0, const uint8_t* bssid = NULL, bool connect = true);
     wl_status_t begin();
 
+    // Fast connect: directed connect to the AP (and IP lease) cached by the last
+    // successful connect, then a full scan with DHCP if that does not come up.
+    // Blocks on the event group until an address is obtained or timeout_ms.
+    wl_status_t beginFast(const char* ssid, const char *passphrase, uint32_t timeout_ms = 10000, bool reuseLease = true);
+    void forgetFast();
+    bool fastConnected() const { return _fastConnected; }
+
     bool config(IPAddress local_ip, IPAddress gateway, IPAddress subnet, IPAddress dns1 = (uint32_t)0x00000000, IPAddress dns2 = (uint32_t)0x00000000);
 
     bool reconnect();
@@ -104,6 +111,8 @@ protected:
     static wifi_auth_mode_t _minSecurity;
     static wifi_scan_method_t _scanMethod;
     static wifi_sort_method_t _sortMethod;
+    static bool _fastLease;
+    static bool _fastConnected;
 
 public: 
     bool beginSmartConfig(smartconfig_type_t type = SC_TYPE_ESPTOUCH, char* crypt_key = NULL);
@@ -52,6 +52,7 @@ class WiFiServer : public Server {
     void setNoDelay(bool nodelay);
     bool getNoDelay();
     bool hasClient();
+    int fd() const { return sockfd; }
     size_t write(const uint8_t *data, size_t len);
     size_t write(uint8_t data){
       return write(&data, 1);
@@ -0,0 +1,87 @@
+#include "Calibration.h"
+
+Calibration::Calibration() : _lock(NULL), _count(0)
+{
+}
+
+bool Calibration::begin()
+{
+  if (!_lock)
+  {
+    _lock = xSemaphoreCreateMutex();
+  }
+  _prefs.begin("calibration", false);
+  size_t len = _prefs.getBytesLength("table");
+  if (len == 0 || len % sizeof(CalibrationPoint) || len > sizeof(_points))
+  {
+    return false;
+  }
+  _count = _prefs.getBytes("table", _points, len) / sizeof(CalibrationPoint);
+  return _count > 0;
+}
+
+bool Calibration::set(const CalibrationPoint *points, size_t count)
+{
+  if (count < 2 || count > CALIBRATION_MAX_POINTS)
+  {
+    return false;
+  }
+  CalibrationPoint sorted[CALIBRATION_MAX_POINTS];
+  memcpy(sorted, points, count * sizeof(CalibrationPoint));
+  // Insertion sort, the table is tiny
+  for (size_t i = 1; i < count; i++)
+  {
+    CalibrationPoint p = sorted[i];
+    size_t j = i;
+    while (j > 0 && sorted[j - 1].freq > p.freq)
+    {
+      sorted[j] = sorted[j - 1];
+      j--;
+    }
+    sorted[j] = p;
+  }
+  for (size_t i = 1; i < count; i++)
+  {
+    if (sorted[i].freq == sorted[i - 1].freq)
+    {
+      return false;
+    }
+  }
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  memcpy(_points, sorted, count * sizeof(CalibrationPoint));
+  _count = count;
+  xSemaphoreGive(_lock);
+  // Written from the copy, lookups need not wait for the flash
+  _prefs.putBytes("table", sorted, count * sizeof(CalibrationPoint));
+  return true;
+}
+
+size_t Calibration::get(CalibrationPoint *points)
+{
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  size_t count = _count;
+  memcpy(points, _points, count * sizeof(CalibrationPoint));
+  xSemaphoreGive(_lock);
+  return count;
+}
+
+bool Calibration::position(uint32_t freq, long &position)
+{
+  bool found = false;
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  if (_count >= 2 && freq >= _points[0].freq && freq <= _points[_count - 1].freq)
+  {
+    size_t i = 1;
+    while (i < _count - 1 && _points[i].freq < freq)
+    {
+      i++;
+    }
+    const CalibrationPoint &a = _points[i - 1];
+    const CalibrationPoint &b = _points[i];
+    int64_t span = (int64_t)b.position - a.position;
+    position = a.position + span * (int64_t)(freq - a.freq) / (int64_t)(b.freq - a.freq);
+    found = true;
+  }
+  xSemaphoreGive(_lock);
+  return found;
+}
@@ -0,0 +1,115 @@
+#include "Commands.h"
+
+// Park creeps in short moves so the endstop is checked between them
+#define PARK_STEP 5
+#define PARK_ACCEL 1000
+
+Commands::Commands(Motion &motion, uint8_t endstopPin, short accel, short decel)
+    : _motion(motion), _endstopPin(endstopPin), _accel(accel), _decel(decel)
+{
+}
+
+CommandResult Commands::execute(const Command &cmd)
+{
+  short accel = cmd.accel ? cmd.accel : _accel;
+  short decel = cmd.decel ? cmd.decel : _decel;
+  // The endstop sits at the positive end and reads LOW when hit
+  bool endstop = digitalRead(_endstopPin) == LOW;
+  MotionSegment seg = {};
+  long target;
+
+  switch (cmd.type)
+  {
+  case CMD_MOVE:
+  case CMD_MOVE_TO:
+    target = cmd.type == CMD_MOVE ? _motion.target() + cmd.arg : cmd.arg;
+    // Moving away from the endstop is allowed
+    if (endstop && target > _motion.position())
+    {
+      return CMD_ENDSTOP;
+    }
+    return _result(_motion.moveTo(target, accel, decel));
+  case CMD_VELOCITY:
+    if (endstop && cmd.arg > 0)
+    {
+      return CMD_ENDSTOP;
+    }
+    return _result(_motion.jog(cmd.arg, accel, decel));
+  case CMD_STOP:
+    if (cmd.flags & CMD_FLAG_HARD)
+    {
+      _motion.stop();
+    }
+    else
+    {
+      _motion.brake();
+    }
+    return CMD_OK;
+  case CMD_STATUS:
+    return CMD_OK;
+  case CMD_STEP:
+    if (endstop)
+    {
+      return CMD_ENDSTOP;
+    }
+    // As /move always has: the position, not the target, against max_step
+    if (_motion.position() > _motion.maxLimit())
+    {
+      return CMD_MAX_POSITION;
+    }
+    seg.target[0] = cmd.arg;
+    seg.relative = true;
+    return _result(_motion.run(&seg, 1, accel, decel, false));
+  case CMD_PROGRAM:
+    if (!cmd.segments || !cmd.count || cmd.count > MOTION_MAX_SEGMENTS)
+    {
+      return CMD_INVALID;
+    }
+    // Only the endstop level is known up front
+    if (endstop)
+    {
+      return CMD_ENDSTOP;
+    }
+    return _result(_motion.run(cmd.segments, cmd.count, accel, decel));
+  case CMD_PARK:
+    while (digitalRead(_endstopPin) != LOW)
+    {
+      seg = {};
+      seg.target[0] = PARK_STEP;
+      seg.relative = true;
+      Motion::Error err = _motion.run(&seg, 1, PARK_ACCEL, PARK_ACCEL, false);
+      if (err != Motion::OK)
+      {
+        return _result(err);
+      }
+      delayMicroseconds(10);
+    }
+    return CMD_OK;
+  default:
+    return CMD_UNKNOWN;
+  }
+}
+
+CommandResult Commands::_result(Motion::Error err)
+{
+  switch (err)
+  {
+  case Motion::OK:
+    return CMD_OK;
+  case Motion::OUT_OF_RANGE:
+    return CMD_OUT_OF_RANGE;
+  case Motion::EMPTY:
+  case Motion::TOO_LONG:
+    return CMD_INVALID;
+  default:
+    return CMD_BUSY;
+  }
+}
+
+void Commands::status(CommandStatus &status)
+{
+  status.state = _motion.state();
+  status.position = _motion.position();
+  status.target = _motion.target();
+  status.endstop = digitalRead(_endstopPin);
+}
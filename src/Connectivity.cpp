@@ -0,0 +1,182 @@
+#include "Connectivity.h"
+#include <ESP32Ping.h>
+#include "Metrics.h"
+#include "Trace.h"
+
+static const uint32_t pingBuckets[] = {1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000};
+static const uint32_t recoveryBuckets[] = {1000, 5000, 15000, 30000, 60000, 120000, 300000, 900000};
+
+static Histogram pingRtt("ping_rtt_microseconds", "Round trip of the connectivity probe", pingBuckets, sizeof(pingBuckets) / sizeof(pingBuckets[0]));
+static Counter pingFailures("ping_failures_total", "Connectivity probes without an answer");
+static Counter wifiDisconnects("wifi_disconnects_total", "Station disconnects");
+static Counter wifiReconnects("wifi_reconnects_total", "Addresses obtained again after a disconnect");
+static Counter outagesMetric("connectivity_outages_total", "Outages detected");
+static LabeledCounter actionsMetric("connectivity_actions_total", "Recovery actions taken", "action");
+static Histogram recoveryMetric("connectivity_recovery_milliseconds", "Time from detection to recovery", recoveryBuckets, sizeof(recoveryBuckets) / sizeof(recoveryBuckets[0]));
+
+Connectivity::Connectivity(Motion &motion, const IPAddress &probeHost)
+    : _motion(motion), _host(probeHost), _ssid(NULL), _pass(NULL), _wake(NULL),
+      _linkDown(false), _state(ONLINE), _attempts(0), _backoff(CONNECTIVITY_BACKOFF_MIN), _due(0),
+      _downSince(0), _outages(0), _recoveries(0), _downtime(0), _lastOutage(0)
+{
+}
+
+void Connectivity::begin(const char *ssid, const char *pass)
+{
+  _ssid = ssid;
+  _pass = pass;
+  _wake = xSemaphoreCreateBinary();
+  _due = millis();
+  // Registered once connected, so every later GOT_IP is a reconnect
+  WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t)
+               { _onEvent(event); });
+}
+
+void Connectivity::_onEvent(arduino_event_id_t event)
+{
+  if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED)
+  {
+    wifiDisconnects.inc();
+    Trace::log(TRACE_WIFI_DISCONNECTED);
+    // The driver keeps retrying and reports each failure, wake only once
+    if (!_linkDown)
+    {
+      _linkDown = true;
+      xSemaphoreGive(_wake);
+    }
+  }
+  else if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP)
+  {
+    wifiReconnects.inc();
+    Trace::log(TRACE_WIFI_GOT_IP);
+    _linkDown = false;
+    xSemaphoreGive(_wake);
+  }
+}
+
+bool Connectivity::_probe()
+{
+  if (_linkDown || WiFi.status() != WL_CONNECTED)
+  {
+    return false;
+  }
+  if (!Ping.ping(_host, 1))
+  {
+    pingFailures.inc();
+    return false;
+  }
+  pingRtt.observe(Ping.averageTime() * 1000);
+  return true;
+}
+
+void Connectivity::loop()
+{
+  int32_t wait = (int32_t)(_due - millis());
+  if (wait > 0)
+  {
+    xSemaphoreTake(_wake, wait / portTICK_PERIOD_MS);
+  }
+  bool healthy = _probe();
+  if (_state == ONLINE)
+  {
+    if (!healthy)
+    {
+      _outages++;
+      Trace::log(TRACE_NET_LOST, _outages);
+      outagesMetric.inc();
+      _downSince = millis();
+      _state = PROBING;
+      _attempts = 1;
+      _backoff = CONNECTIVITY_BACKOFF_MIN;
+      _due = millis() + _backoff;
+      return;
+    }
+    _due = millis() + CONNECTIVITY_PROBE_INTERVAL;
+    return;
+  }
+  if (healthy)
+  {
+    _recovered();
+    _due = millis() + CONNECTIVITY_PROBE_INTERVAL;
+    return;
+  }
+  if ((int32_t)(_due - millis()) > 0)
+  {
+    // Woken early by an event that did not help, sit out the backoff
+    return;
+  }
+  if (_motion.state() != Motion::IDLE)
+  {
+    _due = millis() + CONNECTIVITY_BACKOFF_MIN;
+    return;
+  }
+  _act();
+  _backoff = min(_backoff * 2, (uint32_t)CONNECTIVITY_BACKOFF_MAX);
+  _due = millis() + _backoff;
+}
+
+void Connectivity::_act()
+{
+  static const uint8_t limits[] = {0, CONNECTIVITY_PROBES, CONNECTIVITY_RECONNECTS, CONNECTIVITY_REINITS, 1};
+  if (_attempts >= limits[_state])
+  {
+    _state = (State)(_state + 1);
+    _attempts = 0;
+  }
+  _attempts++;
+  switch (_state)
+  {
+  case RECONNECTING:
+    Trace::log(TRACE_NET_RECONNECT, _attempts);
+    actionsMetric.inc("reconnect");
+    WiFi.reconnect();
+    break;
+  case REINITIALIZING:
+    Trace::log(TRACE_NET_REINIT, _attempts);
+    actionsMetric.inc("reinit");
+    // Scan and DHCP from scratch, the cached AP or lease may be the problem
+    WiFi.forgetFast();
+    WiFi.disconnect(true);
+    WiFi.mode(WIFI_STA);
+    WiFi.begin(_ssid, _pass);
+    break;
+  case REBOOTING:
+    Trace::log(TRACE_NET_REBOOT);
+    actionsMetric.inc("reboot");
+    _motion.flush();
+    // The ring does not survive the restart, leave it on the console
+    Trace::dump(Serial);
+    ESP.restart();
+    break;
+  default:
+    actionsMetric.inc("probe");
+  }
+}
+
+void Connectivity::_recovered()
+{
+  uint32_t took = millis() - _downSince;
+  _recoveries++;
+  _downtime += took;
+  _lastOutage = took;
+  recoveryMetric.observe(took);
+  Trace::log(TRACE_NET_RECOVERED, took, _state);
+  _state = ONLINE;
+}
+
+const char *Connectivity::stateName(State state)
+{
+  switch (state)
+  {
+  case PROBING:
+    return "probing";
+  case RECONNECTING:
+    return "reconnecting";
+  case REINITIALIZING:
+    return "reinitializing";
+  case REBOOTING:
+    return "rebooting";
+  default:
+    return "online";
+  }
+}
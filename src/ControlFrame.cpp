@@ -0,0 +1,22 @@
+#include "ControlFrame.h"
+#include <limits.h>
+
+bool controlFrameCommand(const ControlCommandFrame &frame, Command &cmd)
+{
+  // CMD_STEP, CMD_PROGRAM and CMD_PARK wait or lift the limits, never remote
+  if (frame.type < CMD_MOVE || frame.type > CMD_STATUS)
+  {
+    return false;
+  }
+  if (frame.accel > SHRT_MAX || frame.decel > SHRT_MAX)
+  {
+    return false;
+  }
+  cmd = Command();
+  cmd.type = frame.type;
+  cmd.flags = frame.flags;
+  cmd.arg = frame.arg;
+  cmd.accel = frame.accel;
+  cmd.decel = frame.decel;
+  return true;
+}
@@ -0,0 +1,202 @@
+#include "EventStream.h"
+
+// Motion state as streamed: ramp phases while moving, then dwell/idle
+enum
+{
+  STREAM_IDLE,
+  STREAM_ACCELERATING,
+  STREAM_CRUISING,
+  STREAM_DECELERATING,
+  STREAM_DWELLING
+};
+
+static const char streamHeaders[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: keep-alive\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "\r\n";
+
+EventStream::EventStream(Motion &motion, uint8_t endstopPin)
+    : _motion(motion), _endstopPin(endstopPin), _lock(NULL)
+{
+  for (uint8_t i = 0; i < EVENT_STREAM_CLIENTS; i++)
+  {
+    _subscribers[i].active = false;
+  }
+}
+
+void EventStream::begin()
+{
+  _lock = xSemaphoreCreateMutex();
+}
+
+bool EventStream::add(WiFiClient client, uint8_t rate)
+{
+  if (rate == 0)
+  {
+    rate = EVENT_STREAM_DEFAULT_RATE;
+  }
+  rate = min(rate, (uint8_t)EVENT_STREAM_MAX_RATE);
+  bool added = false;
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  for (uint8_t i = 0; i < EVENT_STREAM_CLIENTS; i++)
+  {
+    Subscriber &sub = _subscribers[i];
+    if (sub.active)
+    {
+      continue;
+    }
+    if (client.write((const uint8_t *)streamHeaders, sizeof(streamHeaders) - 1) != sizeof(streamHeaders) - 1)
+    {
+      break;
+    }
+    sub.client = client;
+    sub.active = true;
+    sub.interval = 1000 / rate;
+    sub.lastSent = millis() - sub.interval;
+    sub.lastWrite = millis();
+    // Nothing has been sent yet, make the first snapshot differ
+    memset(&sub.last, 0xFF, sizeof(sub.last));
+    added = true;
+    break;
+  }
+  xSemaphoreGive(_lock);
+  return added;
+}
+
+uint8_t EventStream::count()
+{
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < EVENT_STREAM_CLIENTS; i++)
+  {
+    n += _subscribers[i].active;
+  }
+  return n;
+}
+
+void EventStream::_snapshot(Snapshot &snap)
+{
+  memset(&snap, 0, sizeof(snap));
+  snap.position = _motion.position();
+  snap.target = _motion.target();
+  snap.endstop = digitalRead(_endstopPin);
+  snap.segments = _motion.segments();
+  snap.segment = snap.segments ? _motion.segment() : 0;
+  switch (_motion.state())
+  {
+  case Motion::MOVING:
+    switch (_motion.phase())
+    {
+    case BasicStepperDriver::ACCELERATING:
+      snap.state = STREAM_ACCELERATING;
+      break;
+    case BasicStepperDriver::DECELERATING:
+      snap.state = STREAM_DECELERATING;
+      break;
+    default:
+      snap.state = STREAM_CRUISING;
+    }
+    break;
+  case Motion::DWELLING:
+    snap.state = STREAM_DWELLING;
+    break;
+  default:
+    snap.state = STREAM_IDLE;
+  }
+}
+
+const char *EventStream::_stateName(uint8_t state)
+{
+  switch (state)
+  {
+  case STREAM_ACCELERATING:
+    return "ACCELERATING";
+  case STREAM_CRUISING:
+    return "CRUISING";
+  case STREAM_DECELERATING:
+    return "DECELERATING";
+  case STREAM_DWELLING:
+    return "DWELLING";
+  default:
+    return "IDLE";
+  }
+}
+
+void EventStream::loop()
+{
+  unsigned long now = millis();
+  bool taken = false;
+  Snapshot snap;
+  char buf[160];
+
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  for (uint8_t i = 0; i < EVENT_STREAM_CLIENTS; i++)
+  {
+    Subscriber &sub = _subscribers[i];
+    if (!sub.active)
+    {
+      continue;
+    }
+    if (!sub.client.connected())
+    {
+      sub.client.stop();
+      sub.active = false;
+      continue;
+    }
+    if (now - sub.lastSent < sub.interval)
+    {
+      continue;
+    }
+    if (!taken)
+    {
+      _snapshot(snap);
+      taken = true;
+    }
+    int len = 0;
+    bool changed = memcmp(&snap, &sub.last, sizeof(snap)) != 0;
+    if (changed)
+    {
+      len = snprintf(buf, sizeof(buf),
+                     "event: status\ndata: {\"step_count\":%ld,\"target\":%ld,\"state\":\"%s\","
+                     "\"endstop\":%u,\"segment\":%u,\"segments\":%u}\n\n",
+                     snap.position, snap.target, _stateName(snap.state), snap.endstop,
+                     snap.segment, snap.segments);
+    }
+    else if (now - sub.lastWrite >= EVENT_STREAM_HEARTBEAT_MS)
+    {
+      len = snprintf(buf, sizeof(buf), ":\n\n");
+    }
+    sub.lastSent = now;
+    if (len == 0)
+    {
+      continue;
+    }
+    if (sub.client.availableForWrite() < len)
+    {
+      // A write would block every other subscriber behind this one. Skip
+      // it, the next event carries the newer state; drop a peer that
+      // has not drained for EVENT_STREAM_STALL_MS
+      if (now - sub.lastWrite >= EVENT_STREAM_STALL_MS)
+      {
+        sub.client.stop();
+        sub.active = false;
+      }
+      continue;
+    }
+    if (sub.client.write((const uint8_t *)buf, len) != (size_t)len)
+    {
+      // Peer gone or too slow to keep up, don't let it stall the others
+      sub.client.stop();
+      sub.active = false;
+      continue;
+    }
+    if (changed)
+    {
+      sub.last = snap;
+    }
+    sub.lastWrite = now;
+  }
+  xSemaphoreGive(_lock);
+}
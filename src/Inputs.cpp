@@ -0,0 +1,178 @@
+#include "Inputs.h"
+#include "Metrics.h"
+
+static const uint32_t latencyBuckets[] = {10, 25, 50, 100, 250, 500, 1000, 2500, 10000};
+
+static Counter edgesMetric("input_edges_total", "Edges seen by input interrupts");
+static Counter eventsMetric("input_events_total", "Debounced input changes delivered");
+static Counter droppedMetric("input_edges_dropped_total", "Edges lost to a full ring");
+static Histogram latencyMetric("input_latency_microseconds", "Interrupt to first subscriber call", latencyBuckets, sizeof(latencyBuckets) / sizeof(latencyBuckets[0]));
+
+Inputs::Inputs()
+    : _count(0), _subscriberCount(0), _head(0), _tail(0), _push(portMUX_INITIALIZER_UNLOCKED), _dropped(0),
+      _droppedSeen(0), _maxLatency(0), _task(NULL)
+{
+}
+
+int Inputs::add(uint8_t pin, uint8_t mode, uint32_t debounceUs)
+{
+  if (_count == INPUTS_MAX)
+  {
+    return -1;
+  }
+  pinMode(pin, mode);
+  Input &in = _inputs[_count];
+  in.owner = this;
+  in.index = _count;
+  in.pin = pin;
+  in.debounce = debounceUs;
+  in.stable = digitalRead(pin);
+  in.settling = false;
+  in.changed = 0;
+  return _count++;
+}
+
+bool Inputs::subscribe(int input, InputCallback callback, void *context)
+{
+  if (input < 0 || input >= _count || _subscriberCount == INPUTS_MAX_SUBSCRIBERS)
+  {
+    return false;
+  }
+  _subscribers[_subscriberCount++] = {(uint8_t)input, callback, context};
+  return true;
+}
+
+void Inputs::begin()
+{
+  _task = xTaskGetCurrentTaskHandle();
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    _inputs[i].stable = digitalRead(_inputs[i].pin);
+    attachInterruptArg(_inputs[i].pin, _isr, &_inputs[i], CHANGE);
+  }
+}
+
+void IRAM_ATTR Inputs::_isr(void *arg)
+{
+  Input *in = (Input *)arg;
+  Inputs *self = in->owner;
+  // Every pin's interrupt produces into the ring, one push at a time
+  portENTER_CRITICAL_ISR(&self->_push);
+  uint16_t head = self->_head.load(std::memory_order_relaxed);
+  uint16_t next = (head + 1) & (INPUTS_RING_SIZE - 1);
+  if (next == self->_tail.load(std::memory_order_acquire))
+  {
+    // Full: the task resyncs every input from its pin afterwards
+    self->_dropped++;
+  }
+  else
+  {
+    InputEvent &e = self->_ring[head];
+    e.input = in->index;
+    e.level = digitalRead(in->pin);
+    e.micros = micros();
+    self->_head.store(next, std::memory_order_release);
+  }
+  portEXIT_CRITICAL_ISR(&self->_push);
+  BaseType_t woken = pdFALSE;
+  if (self->_task)
+  {
+    vTaskNotifyGiveFromISR(self->_task, &woken);
+  }
+  portYIELD_FROM_ISR(woken);
+}
+
+bool Inputs::_pop(InputEvent &event)
+{
+  uint16_t tail = _tail.load(std::memory_order_relaxed);
+  if (tail == _head.load(std::memory_order_acquire))
+  {
+    return false;
+  }
+  event = _ring[tail];
+  _tail.store((tail + 1) & (INPUTS_RING_SIZE - 1), std::memory_order_release);
+  return true;
+}
+
+void Inputs::loop()
+{
+  // Sleep until an edge arrives or the first debounce window closes
+  TickType_t wait = portMAX_DELAY;
+  uint32_t now = micros();
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    Input &in = _inputs[i];
+    if (in.settling)
+    {
+      uint32_t elapsed = now - in.changed;
+      uint32_t left = elapsed < in.debounce ? in.debounce - elapsed : 0;
+      TickType_t ticks = (left + 999) / 1000 / portTICK_PERIOD_MS;
+      wait = min(wait, ticks);
+    }
+  }
+  ulTaskNotifyTake(pdTRUE, wait);
+
+  InputEvent event;
+  uint32_t edges = 0;
+  while (_pop(event))
+  {
+    edges++;
+    Input &in = _inputs[event.input];
+    if (!in.settling && event.level != in.stable)
+    {
+      uint32_t latency = micros() - event.micros;
+      _maxLatency = max(_maxLatency, latency);
+      latencyMetric.observe(latency);
+      _accept(in, event.level, event.micros);
+    }
+  }
+  edgesMetric.inc(edges);
+  uint32_t dropped = _dropped;
+  droppedMetric.inc(dropped - _droppedSeen);
+  if (dropped != _droppedSeen)
+  {
+    // A lost edge may have been the last one on a quiet input, which no
+    // closing window would read again
+    for (uint8_t i = 0; i < _count; i++)
+    {
+      Input &in = _inputs[i];
+      uint8_t level = digitalRead(in.pin);
+      if (!in.settling && level != in.stable)
+      {
+        _accept(in, level, micros());
+      }
+    }
+  }
+  _droppedSeen = dropped;
+
+  now = micros();
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    Input &in = _inputs[i];
+    if (in.settling && now - in.changed >= in.debounce)
+    {
+      in.settling = false;
+      uint8_t level = digitalRead(in.pin);
+      if (level != in.stable)
+      {
+        _accept(in, level, now);
+      }
+    }
+  }
+}
+
+void Inputs::_accept(Input &in, uint8_t level, uint32_t at)
+{
+  in.stable = level;
+  in.settling = true;
+  in.changed = at;
+  InputEvent event = {in.index, level, at};
+  eventsMetric.inc();
+  for (uint8_t i = 0; i < _subscriberCount; i++)
+  {
+    if (_subscribers[i].input == in.index)
+    {
+      _subscribers[i].callback(event, _subscribers[i].context);
+    }
+  }
+}
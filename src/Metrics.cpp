@@ -0,0 +1,166 @@
+#include "Metrics.h"
+#include <inttypes.h>
+
+Metric *Metric::_first = NULL;
+
+Metric::Metric(const char *name, const char *help, const char *type)
+    : _name(name), _help(help), _type(type), _next(NULL)
+{
+  // Keep registration order so the scrape output reads like the source
+  Metric **tail = &_first;
+  while (*tail)
+  {
+    tail = &(*tail)->_next;
+  }
+  *tail = this;
+}
+
+void Metric::renderAll(Print &out)
+{
+  for (Metric *m = _first; m; m = m->_next)
+  {
+    m->render(out);
+  }
+}
+
+void Metric::header(Print &out)
+{
+  // print() rather than printf(): help strings can outgrow printf's stack buffer
+  out.print("# HELP ");
+  out.print(_name);
+  out.print(' ');
+  out.print(_help);
+  out.print("\n# TYPE ");
+  out.print(_name);
+  out.print(' ');
+  out.print(_type);
+  out.print('\n');
+}
+
+void Counter::render(Print &out)
+{
+  header(out);
+  out.printf("%s %" PRIu32 "\n", _name, value());
+}
+
+LabeledCounter::LabeledCounter(const char *name, const char *help, const char *label)
+    : Metric(name, help, "counter"), _label(label), _used(0), _lock(portMUX_INITIALIZER_UNLOCKED)
+{
+  for (uint8_t i = 0; i < METRICS_MAX_LABELS; i++)
+  {
+    _slots[i].value[0] = 0;
+    _slots[i].count = 0;
+  }
+}
+
+void LabeledCounter::inc(const char *value, uint32_t n)
+{
+  uint8_t used = _used.load(std::memory_order_acquire);
+  for (uint8_t i = 0; i < used; i++)
+  {
+    if (!strncmp(_slots[i].value, value, METRICS_LABEL_LEN - 1))
+    {
+      _slots[i].count.fetch_add(n, std::memory_order_relaxed);
+      return;
+    }
+  }
+  // New label value: slots are only ever appended, under the lock.
+  // The last slot is kept for "other" once the table is full.
+  portENTER_CRITICAL(&_lock);
+  used = _used.load(std::memory_order_relaxed);
+  if (used >= METRICS_MAX_LABELS - 1)
+  {
+    value = "other";
+  }
+  uint8_t i = 0;
+  while (i < used && strncmp(_slots[i].value, value, METRICS_LABEL_LEN - 1))
+  {
+    i++;
+  }
+  if (i == used)
+  {
+    strncpy(_slots[i].value, value, METRICS_LABEL_LEN - 1);
+    _slots[i].value[METRICS_LABEL_LEN - 1] = 0;
+    _used.store(used + 1, std::memory_order_release);
+  }
+  portEXIT_CRITICAL(&_lock);
+  _slots[i].count.fetch_add(n, std::memory_order_relaxed);
+}
+
+void LabeledCounter::render(Print &out)
+{
+  header(out);
+  uint8_t used = _used.load(std::memory_order_acquire);
+  for (uint8_t i = 0; i < used; i++)
+  {
+    out.printf("%s{%s=\"%s\"} %" PRIu32 "\n", _name, _label, _slots[i].value,
+               _slots[i].count.load(std::memory_order_relaxed));
+  }
+}
+
+void Gauge::render(Print &out)
+{
+  header(out);
+  if (_read)
+  {
+    out.printf("%s %g\n", _name, _read());
+  }
+  else
+  {
+    out.printf("%s %" PRId32 "\n", _name, value());
+  }
+}
+
+void LabeledGauge::emit(Print &out, const char *value, double reading)
+{
+  out.printf("%s{%s=\"%s\"} %g\n", _name, _label, value, reading);
+}
+
+void LabeledGauge::render(Print &out)
+{
+  header(out);
+  _collect(*this, out);
+}
+
+Histogram::Histogram(const char *name, const char *help, const uint32_t *bounds, uint8_t count)
+    : Metric(name, help, "histogram"), _bounds(bounds), _count(min(count, MAX_BUCKETS)),
+      _observations(0), _sum(0), _lock(portMUX_INITIALIZER_UNLOCKED)
+{
+  for (uint8_t i = 0; i <= MAX_BUCKETS; i++)
+  {
+    _buckets[i] = 0;
+  }
+}
+
+void Histogram::observe(uint32_t value)
+{
+  uint8_t i = 0;
+  while (i < _count && value > _bounds[i])
+  {
+    i++;
+  }
+  // Buckets are stored non-cumulative and summed up at scrape time
+  _buckets[i].fetch_add(1, std::memory_order_relaxed);
+  _observations.fetch_add(1, std::memory_order_relaxed);
+  portENTER_CRITICAL(&_lock);
+  _sum += value;
+  portEXIT_CRITICAL(&_lock);
+}
+
+void Histogram::render(Print &out)
+{
+  header(out);
+  uint32_t cumulative = 0;
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    cumulative += _buckets[i].load(std::memory_order_relaxed);
+    out.printf("%s_bucket{le=\"%" PRIu32 "\"} %" PRIu32 "\n", _name, _bounds[i], cumulative);
+  }
+  cumulative += _buckets[_count].load(std::memory_order_relaxed);
+  out.printf("%s_bucket{le=\"+Inf\"} %" PRIu32 "\n", _name, cumulative);
+  portENTER_CRITICAL(&_lock);
+  uint64_t sum = _sum;
+  portEXIT_CRITICAL(&_lock);
+  out.printf("%s_sum %" PRIu64 "\n", _name, sum);
+  out.printf("%s_count %" PRIu32 "\n", _name, _observations.load(std::memory_order_relaxed));
+}
@@ -0,0 +1,541 @@
+#include "Motion.h"
+#include "Metrics.h"
+#include "Trace.h"
+#include <limits.h>
+
+static Counter stepsMetric("motion_steps_total", "Steps made by the driver");
+static Counter movesMetric("motion_moves_total", "Moves executed, one per segment");
+static LabeledCounter stopsMetric("motion_stops_total", "Moves ended, by reason", "reason");
+static Gauge stepRateMetric("motion_step_rate", "Average step rate of the last move in steps/s");
+
+Motion::Motion(BasicStepperDriver &stepper, PositionStore &store)
+    : _axes(0), _group(NULL), _lock(NULL), _start(NULL), _done(NULL), _wake(NULL), _moving(0), _state(IDLE),
+      _abort(false), _endstop(false), _brake(false), _running(false), _results(NULL), _count(0), _current(0),
+      _rejected(0), _rejectedAxis(0), _used(0), _accel(1000), _decel(1000), _extend(0), _retarget(false),
+      _nextAccel(1000), _nextDecel(1000)
+{
+  addAxis(stepper, store);
+}
+
+int Motion::addAxis(BasicStepperDriver &stepper, PositionStore &store)
+{
+  if (_axes == MOTION_MAX_AXES)
+  {
+    return -1;
+  }
+  Axis &ax = _axis[_axes];
+  ax.stepper = &stepper;
+  ax.store = &store;
+  ax.min = LONG_MIN;
+  ax.max = LONG_MAX;
+  ax.rpm = 0;
+  ax.position = 0;
+  ax.from = 0;
+  _drivers[_axes] = &stepper;
+  return _axes++;
+}
+
+void Motion::begin()
+{
+  _lock = xSemaphoreCreateMutex();
+  _start = xSemaphoreCreateBinary();
+  _done = xSemaphoreCreateBinary();
+  _wake = xSemaphoreCreateBinary();
+  for (uint8_t a = 0; a < _axes; a++)
+  {
+    Axis &ax = _axis[a];
+    ax.rpm = ax.stepper->getRPM();
+    ax.position = ax.store->restored() ? ax.store->position() : 0;
+  }
+  if (_axes > 1)
+  {
+    _group = new Group(_axes, _drivers);
+  }
+}
+
+void Motion::checkpoint()
+{
+  for (uint8_t a = 0; a < _axes; a++)
+  {
+    _axis[a].store->loop();
+  }
+}
+
+bool Motion::flush()
+{
+  bool ok = true;
+  for (uint8_t a = 0; a < _axes; a++)
+  {
+    ok = _axis[a].store->flush() && ok;
+  }
+  return ok;
+}
+
+void Motion::setLimits(long min, long max, uint8_t axis)
+{
+  _axis[axis].min = min;
+  _axis[axis].max = max;
+}
+
+long Motion::position(uint8_t axis)
+{
+  Axis &ax = _axis[axis];
+  if (_state == MOVING && (_moving & (1 << axis)))
+  {
+    return ax.from + ax.stepper->getDirection() * ax.stepper->getStepsCompleted();
+  }
+  return ax.position;
+}
+
+BasicStepperDriver::State Motion::phase()
+{
+  if (_state == MOVING)
+  {
+    return _axis[0].stepper->getCurrentState();
+  }
+  return BasicStepperDriver::STOPPED;
+}
+
+long Motion::target(uint8_t axis)
+{
+  if (_retarget)
+  {
+    // Non-blocking targets only ever move axis 0
+    return axis == 0 ? _next.target[0] : _axis[axis].position;
+  }
+  if (_running && _current < _count)
+  {
+    return _program[_current].target[axis];
+  }
+  return _axis[axis].position;
+}
+
+Motion::Error Motion::_load(MotionSegment *segments, size_t count, short accel, short decel, bool limits)
+{
+  if (count == 0)
+  {
+    return EMPTY;
+  }
+  if (count > MOTION_MAX_SEGMENTS)
+  {
+    return TOO_LONG;
+  }
+  long target[MOTION_MAX_AXES];
+  for (uint8_t a = 0; a < _axes; a++)
+  {
+    target[a] = _axis[a].position;
+  }
+  for (size_t i = 0; i < count; i++)
+  {
+    MotionSegment &seg = segments[i];
+    uint8_t axes = seg.axes ? seg.axes : 1;
+    _program[i] = seg;
+    for (uint8_t a = 0; a < MOTION_MAX_AXES; a++)
+    {
+      if (!(axes & (1 << a)))
+      {
+        continue;
+      }
+      if (a >= _axes)
+      {
+        _rejected = i;
+        _rejectedAxis = a;
+        return OUT_OF_RANGE;
+      }
+      target[a] = seg.relative ? target[a] + seg.target[a] : seg.target[a];
+      if (limits && (target[a] < _axis[a].min || target[a] > _axis[a].max))
+      {
+        _rejected = i;
+        _rejectedAxis = a;
+        return OUT_OF_RANGE;
+      }
+    }
+    for (uint8_t a = 0; a < _axes; a++)
+    {
+      _program[i].target[a] = target[a];
+      _program[i].reached[a] = _axis[a].position;
+    }
+    _program[i].axes = axes;
+    _program[i].relative = false;
+    _program[i].status = SEGMENT_PENDING;
+  }
+  _count = count;
+  _current = 0;
+  _accel = accel;
+  _decel = decel;
+  _abort = false;
+  _endstop = false;
+  _brake = false;
+  _extend = 0;
+  return OK;
+}
+
+Motion::Error Motion::run(MotionSegment *segments, size_t count, short accel, short decel, bool limits)
+{
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  if (_running)
+  {
+    xSemaphoreGive(_lock);
+    return BUSY;
+  }
+  Error err = _load(segments, count, accel, decel, limits);
+  if (err != OK)
+  {
+    xSemaphoreGive(_lock);
+    return err;
+  }
+  _running = true;
+  _results = segments;
+  xSemaphoreGive(_lock);
+
+  xSemaphoreGive(_start);
+  xSemaphoreTake(_done, portMAX_DELAY);
+  return OK;
+}
+
+Motion::Error Motion::moveTo(long target, short accel, short decel, float rpm)
+{
+  Axis &ax = _axis[0];
+  if (target < ax.min || target > ax.max)
+  {
+    return OUT_OF_RANGE;
+  }
+  MotionSegment seg = {};
+  seg.target[0] = target;
+  seg.rpm = rpm;
+
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  if (_running && _results)
+  {
+    xSemaphoreGive(_lock);
+    return BUSY;
+  }
+  if (!_running)
+  {
+    _load(&seg, 1, accel, decel, true);
+    _running = true;
+    xSemaphoreGive(_lock);
+    xSemaphoreGive(_start);
+    return OK;
+  }
+  MotionSegment &cur = _program[_current];
+  long ahead = target - cur.target[0];
+  bool forward = cur.target[0] >= ax.from;
+  if (_state == MOVING && !_retarget && !_abort && cur.axes == 1 && seg.rpm == cur.rpm && ahead != 0 && (ahead > 0) == forward)
+  {
+    // Further along the same way: stretch the running move, no brake
+    cur.target[0] = target;
+    _extend += labs(ahead);
+    xSemaphoreGive(_lock);
+    return OK;
+  }
+  // Replace whatever is queued; only the latest target gets planned
+  _next = seg;
+  _nextAccel = accel;
+  _nextDecel = decel;
+  _retarget = true;
+  _abort = true;
+  _brake = true;
+  xSemaphoreGive(_lock);
+  xSemaphoreGive(_wake);
+  return OK;
+}
+
+Motion::Error Motion::jog(long velocity, short accel, short decel)
+{
+  if (velocity == 0)
+  {
+    brake();
+    return OK;
+  }
+  Axis &ax = _axis[0];
+  float rpm = labs(velocity) * 60.0 / ax.stepper->getSteps() / ax.stepper->getMicrostep();
+  return moveTo(velocity > 0 ? ax.max : ax.min, accel, decel, rpm);
+}
+
+void Motion::brake()
+{
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  _retarget = false;
+  _abort = true;
+  _brake = true;
+  xSemaphoreGive(_lock);
+  xSemaphoreGive(_wake);
+}
+
+void Motion::stop(bool endstop)
+{
+  _endstop = endstop;
+  _abort = true;
+  for (uint8_t a = 0; a < _axes; a++)
+  {
+    _axis[a].stepper->stop();
+  }
+  xSemaphoreGive(_wake);
+}
+
+void Motion::_runSingle(long *planned, bool &braked)
+{
+  BasicStepperDriver &stepper = *_axis[0].stepper;
+  while (stepper.nextAction())
+  {
+    if (_brake)
+    {
+      _brake = false;
+      braked = true;
+      stepper.startBrake();
+    }
+    if (_extend)
+    {
+      xSemaphoreTake(_lock, portMAX_DELAY);
+      if (stepper.extendMove(_extend))
+      {
+        planned[0] += _extend;
+      }
+      _extend = 0;
+      xSemaphoreGive(_lock);
+    }
+  }
+}
+
+void Motion::_runGroup(const long *steps, uint8_t moving, bool &braked)
+{
+  bool cut = false;
+  while (_group->nextAction())
+  {
+    if (_brake)
+    {
+      _brake = false;
+      braked = true;
+      _group->startBrake();
+    }
+    for (uint8_t a = 0; a < _axes && !cut && !braked; a++)
+    {
+      BasicStepperDriver &stepper = *_axis[a].stepper;
+      if ((moving & (1 << a)) && !stepper.getStepsRemaining() && stepper.getStepsCompleted() < labs(steps[a]))
+      {
+        // One axis was stopped short (endstop, stop()), the rest follow
+        cut = true;
+        for (uint8_t b = 0; b < _axes; b++)
+        {
+          _axis[b].stepper->stop();
+        }
+      }
+    }
+  }
+}
+
+bool Motion::_runSegment(MotionSegment &seg)
+{
+  long steps[MAX_MOTORS] = {};
+  long planned[MOTION_MAX_AXES];
+  uint8_t moving = 0;
+  for (uint8_t a = 0; a < _axes; a++)
+  {
+    Axis &ax = _axis[a];
+    ax.from = ax.position;
+    steps[a] = seg.target[a] - ax.position;
+    planned[a] = labs(steps[a]);
+    if (steps[a])
+    {
+      moving |= 1 << a;
+    }
+    if (seg.rpm > 0)
+    {
+      ax.stepper->setRPM(seg.rpm);
+    }
+  }
+  Trace::log(TRACE_MOVE_START, _axis[0].from, seg.target[0], moving);
+  uint32_t started = micros();
+  bool braked = false;
+  _moving = moving;
+  if (moving & ~1)
+  {
+    // Several axes: all arrive together
+    _group->startMove(steps[0], steps[1], steps[2]);
+    _state = MOVING;
+    _runGroup(steps, moving, braked);
+  }
+  else
+  {
+    _axis[0].stepper->startMove(steps[0]);
+    _state = MOVING;
+    _runSingle(planned, braked);
+  }
+  // Count only the steps actually made, the endstop may cut the move short
+  long made = 0;
+  bool cut = false;
+  for (uint8_t a = 0; a < _axes; a++)
+  {
+    Axis &ax = _axis[a];
+    if (moving & (1 << a))
+    {
+      long done = ax.stepper->getStepsCompleted();
+      ax.position = ax.from + (steps[a] < 0 ? -done : done);
+      made += done;
+      cut |= done < planned[a];
+    }
+  }
+  uint32_t elapsed = micros() - started;
+  stepsMetric.inc(made);
+  movesMetric.inc();
+  if (made && elapsed)
+  {
+    stepRateMetric.set((uint64_t)made * 1000000 / elapsed);
+  }
+  // Braking or stop() set _abort; a short move without it was the endstop
+  bool stopped = _abort && !_endstop;
+  stopsMetric.inc(!cut ? "completed" : braked ? "braked" : stopped ? "stopped" : "endstop");
+  Trace::log(!cut ? TRACE_MOVE_DONE : braked ? TRACE_MOVE_BRAKED : stopped ? TRACE_MOVE_STOPPED : TRACE_MOVE_ENDSTOP, _axis[0].position, made);
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  if (!cut && _axis[0].position != seg.target[0] && !_abort)
+  {
+    // Extended too late (already braking, or just finished): go again
+    _next = seg;
+    _nextAccel = _accel;
+    _nextDecel = _decel;
+    _retarget = true;
+    _abort = true;
+  }
+  _extend = 0;
+  xSemaphoreGive(_lock);
+  _state = IDLE;
+  _moving = 0;
+  for (uint8_t a = 0; a < _axes; a++)
+  {
+    Axis &ax = _axis[a];
+    if (seg.rpm > 0)
+    {
+      ax.stepper->setRPM(ax.rpm);
+    }
+    seg.reached[a] = ax.position;
+  }
+  if (cut)
+  {
+    seg.status = SEGMENT_STOPPED;
+    return false;
+  }
+  seg.status = SEGMENT_DONE;
+  if (seg.dwell && !_abort)
+  {
+    _state = DWELLING;
+    xSemaphoreTake(_wake, 0);
+    xSemaphoreTake(_wake, seg.dwell / portTICK_PERIOD_MS);
+    _state = IDLE;
+  }
+  return true;
+}
+
+void Motion::loop()
+{
+  xSemaphoreTake(_start, portMAX_DELAY);
+  _used = 0;
+  while (true)
+  {
+    // Checkpoint and power each axis the program moves, once per wake-up
+    uint8_t axes = 0;
+    for (size_t i = 0; i < _count; i++)
+    {
+      axes |= _program[i].axes;
+    }
+    for (uint8_t a = 0; a < _axes; a++)
+    {
+      Axis &ax = _axis[a];
+      if ((axes & ~_used) & (1 << a))
+      {
+        ax.store->motionStarted(ax.position);
+        ax.stepper->enable();
+      }
+      ax.stepper->setSpeedProfile(BasicStepperDriver::LINEAR_SPEED, _accel, _decel);
+    }
+    _used |= axes;
+    for (size_t i = 0; i < _count; i++)
+    {
+      MotionSegment &seg = _program[i];
+      _current = i;
+      if (_abort)
+      {
+        for (uint8_t a = 0; a < _axes; a++)
+        {
+          seg.reached[a] = _axis[a].position;
+        }
+        seg.status = SEGMENT_SKIPPED;
+        continue;
+      }
+      if (!_runSegment(seg))
+      {
+        _abort = true;
+      }
+    }
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    if (_retarget)
+    {
+      _retarget = false;
+      _load(&_next, 1, _nextAccel, _nextDecel, true);
+      xSemaphoreGive(_lock);
+      continue;
+    }
+    if (_results)
+    {
+      for (size_t i = 0; i < _count; i++)
+      {
+        for (uint8_t a = 0; a < _axes; a++)
+        {
+          _results[i].target[a] = _program[i].target[a];
+          _results[i].reached[a] = _program[i].reached[a];
+        }
+        _results[i].axes = _program[i].axes;
+        _results[i].relative = false;
+        _results[i].status = _program[i].status;
+      }
+    }
+    bool waited = _results != NULL;
+    _results = NULL;
+    _running = false;
+    _count = 0;
+    xSemaphoreGive(_lock);
+    for (uint8_t a = 0; a < _axes; a++)
+    {
+      Axis &ax = _axis[a];
+      if (_used & (1 << a))
+      {
+        ax.stepper->disable();
+        ax.store->motionStopped(ax.position);
+      }
+    }
+    if (waited)
+    {
+      xSemaphoreGive(_done);
+    }
+    return;
+  }
+}
+
+const char *Motion::stateName(State state)
+{
+  switch (state)
+  {
+  case MOVING:
+    return "moving";
+  case DWELLING:
+    return "dwelling";
+  default:
+    return "idle";
+  }
+}
+
+const char *Motion::segmentStatusName(uint8_t status)
+{
+  switch (status)
+  {
+  case SEGMENT_DONE:
+    return "done";
+  case SEGMENT_STOPPED:
+    return "stopped";
+  case SEGMENT_SKIPPED:
+    return "skipped";
+  default:
+    return "pending";
+  }
+}
@@ -0,0 +1,162 @@
+#include "PositionStore.h"
+
+bool NvsPositionBackend::read(uint8_t slot, void *data, size_t len)
+{
+  char key[8];
+  snprintf(key, sizeof(key), "s%u", slot);
+  return _prefs.getBytes(key, data, len) == len;
+}
+
+bool NvsPositionBackend::write(uint8_t slot, const void *data, size_t len)
+{
+  char key[8];
+  snprintf(key, sizeof(key), "s%u", slot);
+  return _prefs.putBytes(key, data, len) == len;
+}
+
+PositionStore::PositionStore(PositionBackend &backend)
+    : _backend(backend), _lock(NULL), _seq(0), _slot(POSITION_STORE_SLOTS - 1),
+      _persistedClean(false), _persistedPosition(0), _unmarked(false), _unmarkedPosition(0), _pending(false),
+      _pendingPosition(0), _pendingSince(0), _restored(false), _position(0)
+{
+}
+
+uint32_t PositionStore::_crc32(const uint8_t *data, size_t len)
+{
+  uint32_t crc = 0xFFFFFFFF;
+  while (len--)
+  {
+    crc ^= *data++;
+    for (uint8_t i = 0; i < 8; i++)
+    {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+bool PositionStore::begin()
+{
+  if (!_lock)
+  {
+    _lock = xSemaphoreCreateMutex();
+  }
+  bool found = false;
+  Record newest;
+  for (uint8_t slot = 0; slot < POSITION_STORE_SLOTS; slot++)
+  {
+    Record rec;
+    if (!_backend.read(slot, &rec, sizeof(rec)))
+    {
+      continue;
+    }
+    if (rec.crc != _crc32((const uint8_t *)&rec, offsetof(Record, crc)))
+    {
+      continue;
+    }
+    if (!found || (int32_t)(rec.seq - newest.seq) > 0)
+    {
+      newest = rec;
+      _slot = slot;
+      found = true;
+    }
+  }
+  if (!found)
+  {
+    return false;
+  }
+  _seq = newest.seq;
+  _persistedClean = newest.clean;
+  _persistedPosition = newest.position;
+  _restored = newest.clean;
+  _position = newest.position;
+  return _restored;
+}
+
+bool PositionStore::_commit(long position, bool clean)
+{
+  Record rec;
+  memset(&rec, 0, sizeof(rec));
+  rec.seq = _seq + 1;
+  rec.position = position;
+  rec.clean = clean;
+  rec.crc = _crc32((const uint8_t *)&rec, offsetof(Record, crc));
+  uint8_t slot = (_slot + 1) % POSITION_STORE_SLOTS;
+  if (!_backend.write(slot, &rec, sizeof(rec)))
+  {
+    return false;
+  }
+  _seq = rec.seq;
+  _slot = slot;
+  _persistedClean = clean;
+  _persistedPosition = position;
+  _unmarked = false;
+  return true;
+}
+
+void PositionStore::motionStarted(long position)
+{
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  _pending = false;
+  // One dirty marker per burst of motion: if power goes away from here on,
+  // the next boot must not trust the stored position.
+  if ((_persistedClean || _unmarked) && !_commit(position, false))
+  {
+    // Flash still says clean; loop() keeps trying
+    _unmarked = true;
+    _unmarkedPosition = position;
+  }
+  xSemaphoreGive(_lock);
+}
+
+void PositionStore::motionStopped(long position)
+{
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  _pending = true;
+  _pendingPosition = position;
+  _pendingSince = millis();
+  xSemaphoreGive(_lock);
+}
+
+void PositionStore::loop()
+{
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  if (_pending && millis() - _pendingSince >= POSITION_COMMIT_DELAY_MS)
+  {
+    if (!_persistedClean || _persistedPosition != _pendingPosition)
+    {
+      _commit(_pendingPosition, true);
+    }
+    else
+    {
+      // Came back to where flash says it is, the marker is moot
+      _unmarked = false;
+    }
+    _pending = false;
+  }
+  else if (_unmarked)
+  {
+    _commit(_unmarkedPosition, false);
+  }
+  xSemaphoreGive(_lock);
+}
+
+bool PositionStore::flush()
+{
+  bool ok = true;
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  if (_pending)
+  {
+    if (!_persistedClean || _persistedPosition != _pendingPosition)
+    {
+      ok = _commit(_pendingPosition, true);
+    }
+    else
+    {
+      _unmarked = false;
+    }
+    _pending = false;
+  }
+  xSemaphoreGive(_lock);
+  return ok;
+}
@@ -0,0 +1,275 @@
+#include "RigctlServer.h"
+
+// Answer to \dump_state for protocol version 0: no ranges, no features.
+// Hamlib only needs it to be well formed.
+static const char dumpState[] =
+    "0\n"
+    "2\n"
+    "2\n"
+    "0.000000 0.000000 0x0 -1 -1 0x0 0x0\n"
+    "0 0 0 0 0 0 0\n"
+    "0 0 0 0 0 0 0\n"
+    "0 0\n"
+    "0 0\n"
+    "0\n"
+    "0\n"
+    "0\n"
+    "0\n"
+    "0 0 0 0 0 0 0 0\n"
+    "0 0 0 0 0 0 0 0\n"
+    "0x0\n"
+    "0x0\n"
+    "0x0\n"
+    "0x0\n"
+    "0x0\n"
+    "0x0\n";
+
+// Long command names and the short form they stand for
+static const struct
+{
+  const char *name;
+  char cmd;
+} longCommands[] = {
+    {"set_freq", 'F'},
+    {"get_freq", 'f'},
+    {"set_mode", 'M'},
+    {"get_mode", 'm'},
+    {"set_vfo", 'V'},
+    {"get_vfo", 'v'},
+    {"set_ptt", 'T'},
+    {"get_ptt", 't'},
+    {"set_split_vfo", 'S'},
+    {"get_split_vfo", 's'},
+    {"quit", 'q'},
+};
+
+RigctlServer::RigctlServer(Motion &motion, Calibration &calibration, uint8_t endstopPin, short accel, short decel)
+    : _motion(motion), _calibration(calibration), _endstopPin(endstopPin), _accel(accel), _decel(decel),
+      _freq(0), _pending(false), _pendingTarget(0)
+{
+  for (uint8_t i = 0; i < RIGCTL_CLIENTS; i++)
+  {
+    _sessions[i].active = false;
+  }
+}
+
+void RigctlServer::begin(uint16_t port)
+{
+  _server.begin(port);
+  _server.setNoDelay(true);
+}
+
+void RigctlServer::loop()
+{
+  _accept();
+  for (uint8_t i = 0; i < RIGCTL_CLIENTS; i++)
+  {
+    if (_sessions[i].active)
+    {
+      _read(_sessions[i]);
+    }
+  }
+  if (_pending)
+  {
+    // Busy means an HTTP program is running: keep the target and retry
+    if (_motion.moveTo(_pendingTarget, _accel, _decel) != Motion::BUSY)
+    {
+      _pending = false;
+    }
+  }
+}
+
+void RigctlServer::_accept()
+{
+  if (!_server.hasClient())
+  {
+    return;
+  }
+  WiFiClient client = _server.available();
+  for (uint8_t i = 0; i < RIGCTL_CLIENTS; i++)
+  {
+    Session &s = _sessions[i];
+    if (!s.active)
+    {
+      s.client = client;
+      s.active = true;
+      s.len = 0;
+      s.overflow = false;
+      return;
+    }
+  }
+  client.stop();
+}
+
+void RigctlServer::_read(Session &s)
+{
+  if (!s.client.connected())
+  {
+    s.client.stop();
+    s.active = false;
+    return;
+  }
+  uint8_t buf[64];
+  int n;
+  while (s.active && s.client.available() > 0 && (n = s.client.read(buf, sizeof(buf))) > 0)
+  {
+    for (int i = 0; i < n && s.active; i++)
+    {
+      char c = buf[i];
+      if (c == '\r')
+      {
+        continue;
+      }
+      if (c != '\n')
+      {
+        if (s.len < RIGCTL_LINE_MAX - 1)
+        {
+          s.line[s.len++] = c;
+        }
+        else
+        {
+          s.overflow = true;
+        }
+        continue;
+      }
+      s.line[s.len] = 0;
+      if (s.overflow)
+      {
+        _report(s, RIG_EINVAL);
+      }
+      else if (s.len)
+      {
+        _command(s, s.line);
+      }
+      s.len = 0;
+      s.overflow = false;
+    }
+  }
+}
+
+void RigctlServer::_command(Session &s, char *line)
+{
+  char cmd = line[0];
+  char *arg = line + 1;
+  if (cmd == '\\')
+  {
+    char *name = line + 1;
+    char *end = name;
+    while (*end && *end != ' ')
+    {
+      end++;
+    }
+    arg = end;
+    if (*end)
+    {
+      *end = 0;
+      arg = end + 1;
+    }
+    if (!strcmp(name, "dump_state"))
+    {
+      s.client.write((const uint8_t *)dumpState, sizeof(dumpState) - 1);
+      return;
+    }
+    if (!strcmp(name, "chk_vfo"))
+    {
+      s.client.print("0\n");
+      return;
+    }
+    if (!strcmp(name, "get_powerstat"))
+    {
+      s.client.print("1\n");
+      return;
+    }
+    if (!strcmp(name, "set_powerstat"))
+    {
+      _report(s, RIG_OK);
+      return;
+    }
+    cmd = 0;
+    for (size_t i = 0; i < sizeof(longCommands) / sizeof(longCommands[0]); i++)
+    {
+      if (!strcmp(name, longCommands[i].name))
+      {
+        cmd = longCommands[i].cmd;
+        break;
+      }
+    }
+  }
+  while (*arg == ' ')
+  {
+    arg++;
+  }
+
+  char reply[24];
+  switch (cmd)
+  {
+  case 'F':
+    _report(s, _setFrequency(arg));
+    break;
+  case 'f':
+    snprintf(reply, sizeof(reply), "%lu\n", (unsigned long)_freq);
+    s.client.print(reply);
+    break;
+  case 'm':
+    s.client.print("USB\n3000\n");
+    break;
+  case 'v':
+    s.client.print("VFOA\n");
+    break;
+  case 't':
+    s.client.print("0\n");
+    break;
+  case 's':
+    s.client.print("0\nVFOA\n");
+    break;
+  case 'M':
+  case 'V':
+  case 'T':
+  case 'S':
+    // Nothing to do for an antenna tuner, accept and ignore
+    _report(s, RIG_OK);
+    break;
+  case 'q':
+  case 'Q':
+    s.client.stop();
+    s.active = false;
+    break;
+  default:
+    _report(s, RIG_ENIMPL);
+  }
+}
+
+int RigctlServer::_setFrequency(const char *arg)
+{
+  char *end;
+  double hz = strtod(arg, &end);
+  if (end == arg || hz < 0 || hz > 4294967295.0)
+  {
+    return RIG_EINVAL;
+  }
+  long target;
+  if (!_calibration.position((uint32_t)hz, target))
+  {
+    return RIG_EINVAL;
+  }
+  if (target < _motion.minLimit() || target > _motion.maxLimit())
+  {
+    return RIG_EINVAL;
+  }
+  // The endstop sits at the positive end, moving away from it is allowed
+  if (digitalRead(_endstopPin) == LOW && target > _motion.position())
+  {
+    return RIG_EINVAL;
+  }
+  _freq = (uint32_t)hz;
+  _pendingTarget = target;
+  _pending = true;
+  return RIG_OK;
+}
+
+void RigctlServer::_report(Session &s, int code)
+{
+  char reply[16];
+  snprintf(reply, sizeof(reply), "RPRT %d\n", code);
+  s.client.print(reply);
+}
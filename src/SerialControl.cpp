@@ -0,0 +1,77 @@
+#include "SerialControl.h"
+
+SerialControl::SerialControl(Commands &commands, Stream &stream)
+    : _commands(commands), _stream(stream), _len(0)
+{
+}
+
+uint8_t SerialControl::crc8(const uint8_t *data, size_t len)
+{
+  uint8_t crc = 0;
+  while (len--)
+  {
+    crc ^= *data++;
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+      crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+void SerialControl::loop()
+{
+  while (_stream.available() > 0)
+  {
+    uint8_t c = _stream.read();
+    if (_len == 0 && c != CONTROL_FRAME_MAGIC)
+    {
+      continue;
+    }
+    _buf[_len++] = c;
+    if (_len < sizeof(_buf))
+    {
+      continue;
+    }
+    if (crc8(_buf, sizeof(ControlCommandFrame)) == _buf[sizeof(ControlCommandFrame)])
+    {
+      ControlCommandFrame frame;
+      memcpy(&frame, _buf, sizeof(frame));
+      _len = 0;
+      _handle(frame);
+      continue;
+    }
+    // Not a frame: resume the hunt at the next magic byte
+    size_t next = 1;
+    while (next < _len && _buf[next] != CONTROL_FRAME_MAGIC)
+    {
+      next++;
+    }
+    memmove(_buf, _buf + next, _len - next);
+    _len -= next;
+  }
+}
+
+void SerialControl::_handle(const ControlCommandFrame &frame)
+{
+  Command cmd;
+  uint8_t result = controlFrameCommand(frame, cmd) ? _commands.execute(cmd) : CMD_INVALID;
+
+  CommandStatus status;
+  _commands.status(status);
+  uint8_t out[sizeof(ControlStatusFrame) + 1];
+  ControlStatusFrame reply;
+  memset(&reply, 0, sizeof(reply));
+  reply.magic = CONTROL_FRAME_MAGIC;
+  reply.type = CONTROL_MSG_REPLY;
+  reply.result = result;
+  reply.state = status.state;
+  reply.seq = frame.seq;
+  reply.position = status.position;
+  reply.target = status.target;
+  reply.endstop = status.endstop;
+  reply.millis = millis();
+  memcpy(out, &reply, sizeof(reply));
+  out[sizeof(reply)] = crc8(out, sizeof(reply));
+  _stream.write(out, sizeof(out));
+}
@@ -0,0 +1,239 @@
+#include "TaskProfiler.h"
+
+TaskProfiler *TaskProfiler::_instance = NULL;
+
+TaskProfiler::TaskProfiler(Motion &motion)
+    : _motion(motion), _timer(NULL), _lock(NULL), _mux(portMUX_INITIALIZER_UNLOCKED), _last(NULL),
+      _lastTotal(0), _sampling(false), _rate(0), _samples(0), _movingSamples(0)
+{
+  memset(_slots, 0, sizeof(_slots));
+}
+
+void TaskProfiler::begin()
+{
+  _lock = xSemaphoreCreateMutex();
+  _instance = this;
+}
+
+bool TaskProfiler::runTimeStats()
+{
+#if configGENERATE_RUN_TIME_STATS
+  return true;
+#else
+  return false;
+#endif
+}
+
+// Find the slot of a task, claiming a free one on first sight.
+// Freed slots leave holes, so the whole table is searched first.
+// Called with interrupts masked.
+TaskProfiler::Slot *IRAM_ATTR TaskProfiler::_slot(TaskHandle_t handle)
+{
+  if (!handle)
+  {
+    return NULL;
+  }
+  Slot *free = NULL;
+  for (uint8_t i = 0; i < PROFILER_MAX_TASKS; i++)
+  {
+    if (_slots[i].handle == handle)
+    {
+      return &_slots[i];
+    }
+    if (!_slots[i].handle && !free)
+    {
+      free = &_slots[i];
+    }
+  }
+  if (free)
+  {
+    free->handle = handle;
+  }
+  return free;
+}
+
+// Free the slots of tasks missing from the count in _status, so a new
+// task, or one that got a deleted task's handle, starts from zero.
+// Called with _lock held.
+void TaskProfiler::_reclaim(size_t count)
+{
+  portENTER_CRITICAL(&_mux);
+  for (uint8_t i = 0; i < PROFILER_MAX_TASKS; i++)
+  {
+    Slot &slot = _slots[i];
+    if (!slot.handle)
+    {
+      continue;
+    }
+    size_t t = 0;
+    while (t < count && _status[t].xHandle != slot.handle)
+    {
+      t++;
+    }
+    if (t == count)
+    {
+      if (_last == slot.handle)
+      {
+        _last = NULL;
+      }
+      memset(&slot, 0, sizeof(slot));
+    }
+  }
+  portEXIT_CRITICAL(&_mux);
+}
+
+void TaskProfiler::reclaim()
+{
+#if configUSE_TRACE_FACILITY
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  size_t count = uxTaskGetSystemState(_status, PROFILER_MAX_TASKS, NULL);
+  // 0 when there are more tasks than _status holds
+  if (count)
+  {
+    _reclaim(count);
+  }
+  xSemaphoreGive(_lock);
+#endif
+}
+
+size_t TaskProfiler::snapshot(TaskProfile *profiles, size_t max)
+{
+#if configUSE_TRACE_FACILITY
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  uint32_t total = 0;
+  size_t count = uxTaskGetSystemState(_status, PROFILER_MAX_TASKS, &total);
+  uint32_t elapsed = total - _lastTotal;
+  _lastTotal = total;
+  if (count)
+  {
+    _reclaim(count);
+  }
+  uint32_t samples = _samples;
+  size_t n = 0;
+  for (size_t i = 0; i < count && n < max; i++)
+  {
+    const TaskStatus_t &st = _status[i];
+    TaskProfile &p = profiles[n++];
+    p.name = st.pcTaskName;
+    p.priority = st.uxCurrentPriority;
+    p.state = st.eCurrentState;
+    p.stackFree = st.usStackHighWaterMark;
+    p.runtime = runTimeStats() ? st.ulRunTimeCounter : 0;
+    p.cpu = 0;
+    p.samples = p.movingSamples = p.switches = 0;
+
+    portENTER_CRITICAL(&_mux);
+    Slot *slot = _slot(st.xHandle);
+    if (slot)
+    {
+      p.samples = slot->samples;
+      p.movingSamples = slot->moving;
+      p.switches = slot->switches;
+      if (runTimeStats() && elapsed)
+      {
+        p.cpu = 100.0f * (uint32_t)(st.ulRunTimeCounter - slot->runtime) / elapsed;
+      }
+      slot->runtime = st.ulRunTimeCounter;
+    }
+    portEXIT_CRITICAL(&_mux);
+    if (!runTimeStats() && samples)
+    {
+      p.cpu = 100.0f * p.samples / samples;
+    }
+  }
+  xSemaphoreGive(_lock);
+  return n;
+#else
+  (void)profiles;
+  (void)max;
+  return 0;
+#endif
+}
+
+void TaskProfiler::startSampling(uint32_t hz)
+{
+  stopSampling();
+  portENTER_CRITICAL(&_mux);
+  for (uint8_t i = 0; i < PROFILER_MAX_TASKS; i++)
+  {
+    _slots[i].samples = _slots[i].moving = _slots[i].switches = 0;
+  }
+  _samples = _movingSamples = 0;
+  _last = NULL;
+  portEXIT_CRITICAL(&_mux);
+
+  if (!_timer)
+  {
+    // 80 MHz APB / 80: one tick per microsecond
+    _timer = timerBegin(PROFILER_TIMER, 80, true);
+    timerAttachInterrupt(_timer, _onSample, true);
+  }
+  _rate = hz;
+  timerAlarmWrite(_timer, 1000000 / hz, true);
+  _sampling = true;
+  timerAlarmEnable(_timer);
+}
+
+void TaskProfiler::stopSampling()
+{
+  if (_timer)
+  {
+    timerAlarmDisable(_timer);
+  }
+  _sampling = false;
+}
+
+void IRAM_ATTR TaskProfiler::_onSample()
+{
+  if (_instance)
+  {
+    _instance->_sample();
+  }
+}
+
+void IRAM_ATTR TaskProfiler::_sample()
+{
+  // In the ISR the "current" task is the one that was interrupted
+  TaskHandle_t current = xTaskGetCurrentTaskHandle();
+  bool moving = _motion.state() == Motion::MOVING;
+  portENTER_CRITICAL_ISR(&_mux);
+  Slot *slot = _slot(current);
+  if (slot)
+  {
+    slot->samples++;
+    if (moving)
+    {
+      slot->moving++;
+    }
+    if (current != _last)
+    {
+      slot->switches++;
+    }
+  }
+  _last = current;
+  _samples++;
+  if (moving)
+  {
+    _movingSamples++;
+  }
+  portEXIT_CRITICAL_ISR(&_mux);
+}
+
+const char *TaskProfiler::stateName(eTaskState state)
+{
+  switch (state)
+  {
+  case eRunning:
+    return "running";
+  case eReady:
+    return "ready";
+  case eBlocked:
+    return "blocked";
+  case eSuspended:
+    return "suspended";
+  case eDeleted:
+    return "deleted";
+  default:
+    return "invalid";
+  }
+}
@@ -0,0 +1,58 @@
+#include "Trace.h"
+
+static const char *const formats[TRACE_EVENT_COUNT] = {
+#define TRACE_FORMAT(id, format) format,
+    TRACE_EVENTS(TRACE_FORMAT)
+#undef TRACE_FORMAT
+};
+
+// A slot whose seq does not match the record number being read is
+// either not written yet, being written, or already overwritten
+static const uint32_t TRACE_WRITING = 0xFFFFFFFF;
+
+Trace::Record Trace::_ring[TRACE_RING_SIZE];
+std::atomic<uint32_t> Trace::_next(0);
+
+void IRAM_ATTR Trace::log(TraceEvent event, int32_t a, int32_t b, int32_t c)
+{
+  uint32_t seq = _next.fetch_add(1, std::memory_order_relaxed);
+  Record &r = _ring[seq & (TRACE_RING_SIZE - 1)];
+  r.seq.store(TRACE_WRITING, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  r.micros = micros();
+  r.event = event;
+  r.args[0] = a;
+  r.args[1] = b;
+  r.args[2] = c;
+  r.seq.store(seq, std::memory_order_release);
+}
+
+uint32_t Trace::dump(Print &out, uint32_t since)
+{
+  uint32_t end = next();
+  if (end - since > TRACE_RING_SIZE)
+  {
+    since = end - TRACE_RING_SIZE;
+  }
+  char line[96];
+  for (uint32_t seq = since; seq != end; seq++)
+  {
+    Record &r = _ring[seq & (TRACE_RING_SIZE - 1)];
+    if (r.seq.load(std::memory_order_acquire) != seq)
+    {
+      continue;
+    }
+    uint32_t at = r.micros;
+    uint16_t event = r.event;
+    int32_t args[3] = {r.args[0], r.args[1], r.args[2]};
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (r.seq.load(std::memory_order_relaxed) != seq || event >= TRACE_EVENT_COUNT)
+    {
+      continue;
+    }
+    int n = snprintf(line, sizeof(line), "%lu %lu.%06lu ", (unsigned long)seq, (unsigned long)(at / 1000000), (unsigned long)(at % 1000000));
+    snprintf(line + n, sizeof(line) - n, formats[event], (int)args[0], (int)args[1], (int)args[2]);
+    out.println(line);
+  }
+  return end;
+}
@@ -0,0 +1,137 @@
+#include "UdpControl.h"
+
+UdpControl::UdpControl(Commands &commands) : _commands(commands), _lastStatus(0)
+{
+  for (uint8_t i = 0; i < UDP_CONTROL_CLIENTS; i++)
+  {
+    _clients[i].valid = false;
+  }
+}
+
+bool UdpControl::begin(uint16_t port)
+{
+  return _udp.begin(port);
+}
+
+void UdpControl::loop()
+{
+  while (_udp.parsePacket() > 0)
+  {
+    ControlCommandFrame frame;
+    if (_udp.available() != sizeof(frame))
+    {
+      _udp.flush();
+      continue;
+    }
+    _udp.read((uint8_t *)&frame, sizeof(frame));
+    if (frame.magic != CONTROL_FRAME_MAGIC)
+    {
+      continue;
+    }
+    _handle(frame);
+  }
+
+  unsigned long now = millis();
+  unsigned long interval = _commands.idle() ? UDP_STATUS_IDLE_INTERVAL_MS : UDP_STATUS_INTERVAL_MS;
+  if (now - _lastStatus < interval)
+  {
+    return;
+  }
+  _lastStatus = now;
+  ControlStatusFrame frame;
+  _fillStatus(frame, CONTROL_MSG_STATUS);
+  for (uint8_t i = 0; i < UDP_CONTROL_CLIENTS; i++)
+  {
+    Client &c = _clients[i];
+    if (c.valid && now - c.lastSeen < UDP_CONTROL_CLIENT_TIMEOUT_MS)
+    {
+      _send(c.ip, c.port, frame);
+    }
+  }
+}
+
+UdpControl::Client &UdpControl::_client(IPAddress ip, uint16_t port)
+{
+  Client *slot = NULL;
+  for (uint8_t i = 0; i < UDP_CONTROL_CLIENTS; i++)
+  {
+    Client &c = _clients[i];
+    if (c.valid && c.ip == ip && c.port == port)
+    {
+      return c;
+    }
+    if (!slot || (slot->valid && (!c.valid || (long)(c.lastSeen - slot->lastSeen) < 0)))
+    {
+      slot = &c;
+    }
+  }
+  // Unknown client takes over a free or the least recently heard slot
+  slot->ip = ip;
+  slot->port = port;
+  slot->valid = false;
+  return *slot;
+}
+
+void UdpControl::_handle(const ControlCommandFrame &frame)
+{
+  IPAddress ip = _udp.remoteIP();
+  uint16_t port = _udp.remotePort();
+  Client &c = _client(ip, port);
+  c.lastSeen = millis();
+
+  if (c.valid && frame.seq == c.seq)
+  {
+    // Retransmission: the command already ran, repeat its answer
+    _send(ip, port, c.reply);
+    return;
+  }
+  if (c.valid && (int32_t)(frame.seq - c.seq) < 0)
+  {
+    ControlStatusFrame stale;
+    _fillStatus(stale, CONTROL_MSG_REPLY);
+    stale.result = CMD_STALE;
+    stale.seq = frame.seq;
+    _send(ip, port, stale);
+    return;
+  }
+
+  Command cmd;
+  if (!controlFrameCommand(frame, cmd))
+  {
+    ControlStatusFrame invalid;
+    _fillStatus(invalid, CONTROL_MSG_REPLY);
+    invalid.result = CMD_INVALID;
+    invalid.seq = frame.seq;
+    _send(ip, port, invalid);
+    return;
+  }
+
+  uint8_t result = _commands.execute(cmd);
+  c.valid = true;
+  c.seq = frame.seq;
+  _fillStatus(c.reply, CONTROL_MSG_REPLY);
+  c.reply.result = result;
+  c.reply.seq = frame.seq;
+  _send(ip, port, c.reply);
+}
+
+void UdpControl::_fillStatus(ControlStatusFrame &frame, uint8_t type)
+{
+  CommandStatus status;
+  _commands.status(status);
+  memset(&frame, 0, sizeof(frame));
+  frame.magic = CONTROL_FRAME_MAGIC;
+  frame.type = type;
+  frame.state = status.state;
+  frame.position = status.position;
+  frame.target = status.target;
+  frame.endstop = status.endstop;
+  frame.millis = millis();
+}
+
+void UdpControl::_send(IPAddress ip, uint16_t port, const ControlStatusFrame &frame)
+{
+  _udp.beginPacket(ip, port);
+  _udp.write((const uint8_t *)&frame, sizeof(frame));
+  _udp.endPacket();
+}
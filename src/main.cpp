@@ -1,10 +1,23 @@
 #include "A4988.h"
 #include <Arduino.h>
 #include <ArduinoJson.h>
-#include <ESP32Ping.h>
+#include <Calibration.h>
+#include <Commands.h>
+#include <Connectivity.h>
+#include <EventStream.h>
+#include <Inputs.h>
+#include <Metrics.h>
+#include <Motion.h>
+#include <PositionStore.h>
 #include <RGBLed.h>
+#include <RigctlServer.h>
+#include <SerialControl.h>
+#include <TaskProfiler.h>
+#include <Trace.h>
+#include <UdpControl.h>
 #include <WebServer.h>
 #include <WiFi.h>
+#include <limits.h>
 #define PIN_WHITE GPIO_NUM_19
 #define PIN_YELLOW GPIO_NUM_18
 #define PIN_BLUE GPIO_NUM_3
@@ -22,175 +35,569 @@
 #define STEPS 8000
 #define S_DELAY_MS 100
 #define HTTP_REST_PORT 8080
+#define UDP_CONTROL_PORT 8081
+#define RIGCTL_PORT 4532
+// Axes driven, the first one is the stepper above; see axisConfig
+#ifndef MOTOR_AXES
+#define MOTOR_AXES 1
+#endif
 #define AP_SSID "Neurotoxin2"
 #define AP_PASS "Mxbb2Col"
 // Минимальный таймаут между событиями нажатия кнопки
 #define TM_BUTTON 100
-uint32_t ms_btn = 0;
-bool state_btn  = true;
-void Task_Endstop( void *pvParameters );
-SemaphoreHandle_t endstopSemaphore;
 
 const char *hostname = "magloop-ctrl";
 bool flag = false;
 bool step_delay = true;
-int step_count = 0;
+// /move only ever refused to start above max_step. /moves and jogs need
+// a floor too, and as the count starts wherever the carriage stood at
+// first boot the travel is taken to be the same either way
+int min_step = -7000;
 int max_step = 7000;
 
 WebServer server(HTTP_REST_PORT);
 
 A4988 stepper(MOTOR_STEPS, PIN_DIR, PIN_STEP, PIN_EN);
 
+NvsPositionBackend positionBackend;
+PositionStore positionStore(positionBackend);
+
+// Axes after the first (split stator, matching capacitor), same motor type
+struct AxisConfig
+{
+  uint8_t dir;
+  uint8_t step;
+  uint8_t en;
+  const char *store; // NVS namespace of the position checkpoint
+  long min;
+  long max;
+};
+const AxisConfig axisConfig[] = {
+    {GPIO_NUM_0, GPIO_NUM_1, GPIO_NUM_2, "position1", -7000, 7000},
+};
+static_assert(MOTOR_AXES >= 1 && MOTOR_AXES - 1 <= sizeof(axisConfig) / sizeof(axisConfig[0]), "axisConfig too short");
+static_assert(MOTOR_AXES <= MOTION_MAX_AXES, "MOTOR_AXES above MOTION_MAX_AXES");
+
+struct ExtraAxis
+{
+  ExtraAxis(const AxisConfig &config)
+      : stepper(MOTOR_STEPS, config.dir, config.step, config.en), backend(config.store), store(backend) {}
+  A4988 stepper;
+  NvsPositionBackend backend;
+  PositionStore store;
+};
+ExtraAxis *extraAxes[MOTION_MAX_AXES];
+Motion motion(stepper, positionStore);
+Commands commands(motion, ENDSTOP, MOTOR_ACCEL, MOTOR_DECEL);
+UdpControl udpControl(commands);
+SerialControl serialControl(commands, Serial);
+EventStream events(motion, ENDSTOP);
+Calibration calibration;
+RigctlServer rigctl(motion, calibration, ENDSTOP, MOTOR_ACCEL, MOTOR_DECEL);
+TaskProfiler profiler(motion);
+Connectivity connectivity(motion, IPAddress(10, 175, 1, 1));
+
 RGBLed led(PIN_BLUE, PIN_GREEN, PIN_RED, RGBLed::COMMON_CATHODE);
 
-void IRAM_ATTR ISR_endstop(){
-// Прерывание по кнопке, отпускаем семафор  
-   xSemaphoreGiveFromISR(endstopSemaphore, NULL );
-}
-
-void Task_Endstop( void *pvParameters ){
-// Создаем семафор     
-   endstopSemaphore = xSemaphoreCreateBinary();
-// Сразу "берем" семафор чтобы не было первого ложного срабатывания кнопки   
-   xSemaphoreTake( endstopSemaphore, 100 );
-   Serial.println("Endstop task Start");
-   while(true){
-// Запускаем обработчик прерывания (кнопка замыкает GPIO на землю)
-      attachInterrupt(ENDSTOP, ISR_endstop, CHANGE);   
-// Ждем "отпускание" семафора
-      xSemaphoreTake( endstopSemaphore, portMAX_DELAY );
-// Отключаем прерывание для устранения повторного срабатывания прерывания во время обработки
-      detachInterrupt(ENDSTOP);
-      bool st = digitalRead(ENDSTOP);
-      uint32_t ms = millis();
-// Проверка изменения состояния кнопки или превышение таймаута      
-      if( st != state_btn || ms - ms_btn > TM_BUTTON){
-          state_btn = st;
-          ms_btn    = ms;
-          if( st == LOW ){
-               Serial.println("Endstop triggered");
-              stepper.stop();
-          }
-// Задержка для устранения дребезга контактов
-          vTaskDelay(TM_BUTTON);
-      }
-   }
-   vTaskDelete( NULL );
+Inputs inputs;
+int endstopInput;
+
+TaskHandle_t tasks[9];
+
+enum BootPhase
+{
+  BOOT_HARDWARE,
+  BOOT_STEPPER,
+  BOOT_POSITION,
+  BOOT_WIFI,
+  BOOT_SERVER,
+  BOOT_FIRST_REQUEST,
+  BOOT_PHASES
+};
+const char *const bootPhaseNames[BOOT_PHASES] = {"hardware", "stepper", "position", "wifi", "server", "first_request"};
+// millis() at which each phase finished, valid once its bit is set in bootDone
+uint32_t bootPhases[BOOT_PHASES];
+uint8_t bootDone = 0;
+
+void bootPhase(BootPhase phase)
+{
+  bootPhases[phase] = millis();
+  bootDone |= 1 << phase;
+  Trace::log(TRACE_BOOT_PHASE, phase, bootPhases[phase]);
 }
 
-void IRAM_ATTR onEndstopTimer()
+// Microseconds; /move and /moves answer only once the carriage stops
+const uint32_t httpBuckets[] = {100, 250, 500, 1000, 2500, 5000, 10000, 25000, 100000, 1000000, 10000000};
+
+double readRssi() { return WiFi.RSSI(); }
+double readFreeHeap() { return ESP.getFreeHeap(); }
+double readMinFreeHeap() { return ESP.getMinFreeHeap(); }
+double readFastConnect() { return WiFi.fastConnected(); }
+
+void collectStacks(LabeledGauge &gauge, Print &out)
 {
-  if (!digitalRead(ENDSTOP))
+  for (size_t i = 0; i < sizeof(tasks) / sizeof(tasks[0]); i++)
   {
-    stepper.stop();
+    if (tasks[i])
+    {
+      gauge.emit(out, pcTaskGetName(tasks[i]), uxTaskGetStackHighWaterMark(tasks[i]));
+    }
   }
 }
 
+void collectBootPhases(LabeledGauge &gauge, Print &out)
+{
+  for (uint8_t i = 0; i < BOOT_PHASES; i++)
+  {
+    if (bootDone & (1 << i))
+    {
+      gauge.emit(out, bootPhaseNames[i], bootPhases[i]);
+    }
+  }
+}
+
+LabeledCounter httpRequests("http_requests_total", "HTTP requests, by route", "route");
+Histogram httpParse("http_parse_microseconds", "Time to read and parse a request", httpBuckets, sizeof(httpBuckets) / sizeof(httpBuckets[0]));
+Histogram httpHandle("http_handle_microseconds", "Time spent in the route handler", httpBuckets, sizeof(httpBuckets) / sizeof(httpBuckets[0]));
+Gauge wifiRssi("wifi_rssi_dbm", "Signal strength of the access point", readRssi);
+Gauge heapFree("heap_free_bytes", "Free heap", readFreeHeap);
+Gauge heapMinFree("heap_min_free_bytes", "Lowest free heap since boot", readMinFreeHeap);
+LabeledGauge bootPhaseMetric("boot_phase_milliseconds", "Time after power-on at which each boot phase finished", "phase", collectBootPhases);
+Gauge wifiFastConnect("wifi_fast_connect", "1 if the station joined the cached AP without a scan", readFastConnect);
+LabeledGauge stackFree("task_stack_free_min_bytes", "Stack high water mark, by task", "task", collectStacks);
+
+/*
+ * Print that hands its output to the current response in chunks.
+ */
+class ResponsePrint : public Print
+{
+public:
+  ResponsePrint() : _len(0) {}
+  ~ResponsePrint() { flush(); }
+  size_t write(uint8_t c) override
+  {
+    if (_len == sizeof(_buf))
+    {
+      flush();
+    }
+    _buf[_len++] = c;
+    return 1;
+  }
+  void flush()
+  {
+    if (_len)
+    {
+      server.sendContent(_buf, _len);
+      _len = 0;
+    }
+  }
+
+private:
+  char _buf[256];
+  size_t _len;
+};
+
+void onEndstop(const InputEvent &event, void *)
+{
+  if (event.level == LOW)
+  {
+    motion.stop(true);
+  }
+  Trace::log(TRACE_ENDSTOP, event.level);
+}
+
 void statusResponce(String status)
 {
+  CommandStatus st;
+  commands.status(st);
   DynamicJsonDocument doc(512);
   doc["status"] = status;
-  doc["step_count"] = step_count;
-  doc["endstop"] = digitalRead(ENDSTOP);
-  String buf;
-  serializeJson(doc, buf);
-  server.send(200, F("application/json"), buf);
+  doc["step_count"] = st.position;
+  doc["endstop"] = st.endstop;
+  server.sendJson(200, doc);
 }
 
-void moveTo(int dir, int step, int accel, int decel)
+/*
+ * Answer a command that did not run the way /move and /park always have.
+ */
+void resultResponce(CommandResult result)
 {
-  stepper.setSpeedProfile(stepper.LINEAR_SPEED, accel, decel);
-  stepper.enable();
-  if (dir == 0)
-  {
-    stepper.move(step);
-    step_count += step;
-  }
-  else
+  switch (result)
   {
-    stepper.move(-step);
-    step_count -= step;
+  case CMD_ENDSTOP:
+    statusResponce("Endstop Triggered!");
+    break;
+  case CMD_MAX_POSITION:
+    statusResponce("Maximum position reached");
+    break;
+  default:
+    statusResponce("Busy");
   }
-  stepper.disable();
 }
 
 void setMove()
 {
-  int dir, step, accel, decel;
-
-  String postBody = server.arg("plain");
   DynamicJsonDocument doc(512);
-  DeserializationError error = deserializeJson(doc, postBody);
+  DeserializationError error = server.readJson(doc);
   if (error)
   {
     String msg = error.c_str();
     server.send(400, F("text/html"),
                 "Error in parsin json body! <br>" + msg);
+    return;
+  }
+  JsonObject postObj = doc.as<JsonObject>();
+  if (!postObj.containsKey("direction") || !postObj.containsKey("step") || !postObj.containsKey("acceleration") || !postObj.containsKey("deceleration"))
+  {
+    doc.clear();
+    doc["status"] = "KO";
+    doc["message"] = F("No data found, or incorrect!");
+    server.sendJson(400, doc);
+    return;
+  }
+  int dir = postObj[F("direction")];
+  int step = postObj[F("step")];
+  Command cmd = {CMD_STEP, 0, dir == 0 ? step : -step, postObj[F("acceleration")].as<short>(), postObj[F("deceleration")].as<short>(), NULL, 0};
+  CommandResult result = commands.execute(cmd);
+  if (result == CMD_OK)
+  {
+    statusResponce("Complete");
   }
   else
   {
-    JsonObject postObj = doc.as<JsonObject>();
-    if (server.method() == HTTP_POST)
+    resultResponce(result);
+  }
+}
+
+void getPark()
+{
+  Command cmd = {};
+  cmd.type = CMD_PARK;
+  CommandResult result = commands.execute(cmd);
+  if (result == CMD_OK)
+  {
+    statusResponce("Parked");
+  }
+  else
+  {
+    resultResponce(result);
+  }
+}
+
+/*
+ * "to" or "by" of a /moves segment: a number moves axis 0, an array moves
+ * every axis whose entry is not null.
+ */
+bool parseTargets(JsonVariant value, MotionSegment &seg)
+{
+  if (!value.is<JsonArray>())
+  {
+    seg.target[0] = value;
+    return true;
+  }
+  JsonArray list = value;
+  if (list.size() > MOTION_MAX_AXES)
+  {
+    return false;
+  }
+  uint8_t axis = 0;
+  for (JsonVariant item : list)
+  {
+    if (!item.isNull())
     {
-      if (postObj.containsKey("direction") && postObj.containsKey("step") && postObj.containsKey("acceleration") && postObj.containsKey("deceleration"))
-      {
-        // Here store data or doing operation
-        dir = int(postObj[F("direction")]);
-        step = int(postObj[F("step")]);
-        accel = int(postObj[F("acceleration")]);
-        decel = int(postObj[F("deceleration")]);
-
-        if (digitalRead(ENDSTOP) == true)
-        {
-          if (step_count <= max_step)
-          {
-            moveTo(dir, step, accel, decel);
-            statusResponce("Complete");
-          }
-          else
-          {
-            statusResponce("Maximum position reached");
-          }
-        }
-        else
-        {
-          statusResponce("Endstop Triggered!");
-        }
-      }
+      seg.target[axis] = item;
+      seg.axes |= 1 << axis;
+    }
+    axis++;
+  }
+  return seg.axes != 0;
+}
+
+void setMoves()
+{
+  const size_t capacity = JSON_OBJECT_SIZE(3) + JSON_ARRAY_SIZE(MOTION_MAX_SEGMENTS) +
+                          MOTION_MAX_SEGMENTS * (JSON_OBJECT_SIZE(3) + 2 * JSON_ARRAY_SIZE(MOTION_MAX_AXES)) + 256;
+  // Only the web server task gets here, keep the program off its stack
+  static MotionSegment segments[MOTION_MAX_SEGMENTS];
+  size_t count = 0;
+
+  DynamicJsonDocument doc(capacity);
+  DeserializationError error = server.readJson(doc);
+  JsonArray list = doc["segments"];
+  if (error || list.isNull())
+  {
+    String msg = error ? error.c_str() : "segments missing";
+    server.send(400, F("text/html"), "Error in parsin json body! <br>" + msg);
+    return;
+  }
+  if (list.size() == 0 || list.size() > MOTION_MAX_SEGMENTS)
+  {
+    server.send(400, F("text/html"), "Segments: 1.." + String(MOTION_MAX_SEGMENTS));
+    return;
+  }
+  for (JsonObject item : list)
+  {
+    MotionSegment &seg = segments[count];
+    seg = {};
+    bool parsed;
+    if (item.containsKey("to"))
+    {
+      parsed = parseTargets(item["to"], seg);
+    }
+    else if (item.containsKey("by"))
+    {
+      parsed = parseTargets(item["by"], seg);
+      seg.relative = true;
     }
     else
     {
-      DynamicJsonDocument doc(512);
-      doc["status"] = "KO";
-      doc["message"] = F("No data found, or incorrect!");
-      String buf;
-      serializeJson(doc, buf);
-
-      server.send(400, F("application/json"), buf);
+      server.send(400, F("text/html"), "Segment " + String(count) + ": \"to\" or \"by\" required");
+      return;
+    }
+    if (!parsed)
+    {
+      server.send(400, F("text/html"), "Segment " + String(count) + ": 1.." + String(MOTION_MAX_AXES) + " axes");
+      return;
     }
+    seg.dwell = item["dwell"] | 0;
+    count++;
+  }
+  long accel = doc["acceleration"] | 0L;
+  long decel = doc["deceleration"] | 0L;
+  if (accel < 0 || accel > SHRT_MAX || decel < 0 || decel > SHRT_MAX)
+  {
+    server.send(400, F("text/html"), "Acceleration, deceleration: 0.." + String(SHRT_MAX));
+    return;
+  }
+  Command cmd = {CMD_PROGRAM, 0, 0, (short)accel, (short)decel, segments, count};
+  CommandResult result = commands.execute(cmd);
+  if (result == CMD_OUT_OF_RANGE)
+  {
+    uint8_t axis = motion.rejectedAxis();
+    String msg = "Segment " + String(commands.rejected());
+    if (motion.axes() > 1)
+    {
+      msg += " axis " + String(axis);
+    }
+    if (axis < motion.axes())
+    {
+      msg += ": outside " + String(motion.minLimit(axis)) + ".." + String(motion.maxLimit(axis));
+    }
+    else
+    {
+      msg += ": no such axis";
+    }
+    server.send(400, F("text/html"), msg);
+    return;
+  }
+  if (result != CMD_OK)
+  {
+    resultResponce(result);
+    return;
   }
-}
 
-void getPark()
-{
-  while (digitalRead(ENDSTOP))
+  doc.clear();
+  bool complete = segments[count - 1].status == Motion::SEGMENT_DONE;
+  CommandStatus st;
+  commands.status(st);
+  doc["status"] = complete ? "Complete" : "Stopped";
+  doc["step_count"] = st.position;
+  doc["endstop"] = st.endstop;
+  JsonArray results = doc.createNestedArray("segments");
+  for (size_t i = 0; i < count; i++)
   {
-    moveTo(0, 5, 1000, 1000);
-    delayMicroseconds(10);
+    JsonObject item = results.createNestedObject();
+    if (motion.axes() > 1)
+    {
+      JsonArray target = item.createNestedArray("target");
+      JsonArray reached = item.createNestedArray("reached");
+      for (uint8_t a = 0; a < motion.axes(); a++)
+      {
+        target.add(segments[i].target[a]);
+        reached.add(segments[i].reached[a]);
+      }
+    }
+    else
+    {
+      item["target"] = segments[i].target[0];
+      item["reached"] = segments[i].reached[0];
+    }
+    item["status"] = Motion::segmentStatusName(segments[i].status);
   }
-  statusResponce("Parked");
+  server.sendJson(200, doc);
 }
 
 void getInfo()
 {
-  DynamicJsonDocument doc(512);
+  DynamicJsonDocument doc(512 + JSON_ARRAY_SIZE(MOTION_MAX_AXES) + MOTION_MAX_AXES * JSON_OBJECT_SIZE(4));
   doc["status"] = "Ok";
-  doc["step_count"] = step_count;
+  doc["step_count"] = motion.position();
   doc["endstop"] = digitalRead(ENDSTOP);
+  doc["motion"] = Motion::stateName(motion.state());
+  if (motion.segments())
+  {
+    doc["segment"] = motion.segment();
+    doc["segments"] = motion.segments();
+  }
+  doc["position_restored"] = positionStore.restored();
+  JsonArray axes = doc.createNestedArray("axes");
+  for (uint8_t a = 0; a < motion.axes(); a++)
+  {
+    JsonObject axis = axes.createNestedObject();
+    axis["position"] = motion.position(a);
+    axis["target"] = motion.target(a);
+    axis["min"] = motion.minLimit(a);
+    axis["max"] = motion.maxLimit(a);
+  }
+  doc["event_streams"] = events.count();
+  doc["input_latency_max_us"] = inputs.maxLatency();
+  doc["network"] = Connectivity::stateName(connectivity.state());
+  doc["outages"] = connectivity.outages();
+  doc["mttr_ms"] = connectivity.meanTimeToRecover();
   doc["ip"] = WiFi.localIP();
-  String buf;
-  serializeJson(doc, buf);
-  server.send(200, F("application/json"), buf);
+  server.sendJson(200, doc);
+}
+
+void getMetrics()
+{
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, F("text/plain; version=0.0.4"), "");
+  ResponsePrint out;
+  Metric::renderAll(out);
+}
+
+/*
+ * Trace records, oldest first. ?since= resumes from the number given on
+ * the closing "# next" line of the previous dump.
+ */
+void getTrace()
+{
+  uint32_t since = server.hasArg("since") ? strtoul(server.arg("since").c_str(), NULL, 10) : 0;
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, F("text/plain"), "");
+  ResponsePrint out;
+  uint32_t next = Trace::dump(out, since);
+  out.printf("# next %lu\n", (unsigned long)next);
+}
+
+void countRequest()
+{
+  if (!(bootDone & (1 << BOOT_FIRST_REQUEST)))
+  {
+    bootPhase(BOOT_FIRST_REQUEST);
+  }
+  httpRequests.inc(server.matched() ? server.uri().c_str() : "unmatched");
+  httpParse.observe(server.parseMicros());
+  httpHandle.observe(server.handleMicros());
+  Trace::log(TRACE_HTTP_REQUEST, server.method(), server.parseMicros(), server.handleMicros());
+}
+
+void getTasks()
+{
+  static TaskProfile profiles[PROFILER_MAX_TASKS];
+  size_t count = profiler.snapshot(profiles, PROFILER_MAX_TASKS);
+
+  DynamicJsonDocument doc(JSON_OBJECT_SIZE(6) + JSON_ARRAY_SIZE(PROFILER_MAX_TASKS) +
+                          PROFILER_MAX_TASKS * JSON_OBJECT_SIZE(9));
+  doc["run_time_stats"] = TaskProfiler::runTimeStats();
+  doc["sampling"] = profiler.sampling();
+  doc["sample_rate"] = profiler.sampleRate();
+  doc["samples"] = profiler.samples();
+  doc["moving_samples"] = profiler.movingSamples();
+  JsonArray tasks = doc.createNestedArray("tasks");
+  for (size_t i = 0; i < count; i++)
+  {
+    const TaskProfile &p = profiles[i];
+    JsonObject task = tasks.createNestedObject();
+    task["name"] = p.name;
+    task["priority"] = p.priority;
+    task["state"] = TaskProfiler::stateName(p.state);
+    task["stack_free"] = p.stackFree;
+    task["runtime"] = p.runtime;
+    task["cpu"] = serialized(String(p.cpu, 1));
+    task["samples"] = p.samples;
+    task["moving_samples"] = p.movingSamples;
+    task["switches"] = p.switches;
+  }
+  server.sendJson(200, doc);
+}
+
+void setTaskSampling()
+{
+  DynamicJsonDocument doc(128);
+  DeserializationError error = server.readJson(doc);
+  if (error || !doc.containsKey("enable"))
+  {
+    server.send(400, F("text/html"), F("Error in parsin json body! <br>{enable, rate}"));
+    return;
+  }
+  if (doc["enable"])
+  {
+    profiler.startSampling(constrain(doc["rate"] | PROFILER_SAMPLE_HZ, 10, 10000));
+  }
+  else
+  {
+    profiler.stopSampling();
+  }
+  getTasks();
+}
+
+void getEvents()
+{
+  long rate = EVENT_STREAM_DEFAULT_RATE;
+  if (server.hasArg("rate"))
+  {
+    rate = constrain(server.arg("rate").toInt(), 1, EVENT_STREAM_MAX_RATE);
+  }
+  if (!events.add(server.client(), rate))
+  {
+    server.send(503, F("text/plain"), F("Too many event streams"));
+  }
+}
+
+void getCalibration()
+{
+  DynamicJsonDocument doc(JSON_OBJECT_SIZE(2) + JSON_ARRAY_SIZE(CALIBRATION_MAX_POINTS) +
+                          CALIBRATION_MAX_POINTS * JSON_OBJECT_SIZE(2));
+  doc["frequency"] = rigctl.frequency();
+  JsonArray points = doc.createNestedArray("points");
+  CalibrationPoint table[CALIBRATION_MAX_POINTS];
+  size_t count = calibration.get(table);
+  for (size_t i = 0; i < count; i++)
+  {
+    JsonObject point = points.createNestedObject();
+    point["freq"] = table[i].freq;
+    point["position"] = table[i].position;
+  }
+  server.sendJson(200, doc);
+}
+
+void setCalibration()
+{
+  CalibrationPoint points[CALIBRATION_MAX_POINTS];
+  size_t count = 0;
+
+  DynamicJsonDocument doc(JSON_OBJECT_SIZE(1) + JSON_ARRAY_SIZE(CALIBRATION_MAX_POINTS) +
+                          CALIBRATION_MAX_POINTS * JSON_OBJECT_SIZE(2) + 256);
+  DeserializationError error = server.readJson(doc);
+  JsonArray list = doc["points"];
+  if (error || list.isNull() || list.size() > CALIBRATION_MAX_POINTS)
+  {
+    server.send(400, F("text/html"), F("Error in parsin json body! <br>points: [{freq, position}]"));
+    return;
+  }
+  for (JsonObject item : list)
+  {
+    points[count].freq = item["freq"];
+    points[count].position = item["position"];
+    count++;
+  }
+  if (!calibration.set(points, count))
+  {
+    server.send(400, F("text/html"), "Calibration: 2.." + String(CALIBRATION_MAX_POINTS) + " points, distinct frequencies");
+    return;
+  }
+  getCalibration();
 }
 
 void restServerRouting()
@@ -200,7 +607,15 @@ void restServerRouting()
                           F("Variable Capacitor Controller Web Server")); });
   server.on(F("/park"), HTTP_GET, getPark);
   server.on(F("/info"), HTTP_GET, getInfo);
-  server.on(F("/move"), HTTP_POST, setMove);
+  server.onBody(F("/move"), HTTP_POST, setMove);
+  server.onBody(F("/moves"), HTTP_POST, setMoves);
+  server.on(F("/events"), HTTP_GET, getEvents);
+  server.on(F("/metrics"), HTTP_GET, getMetrics);
+  server.on(F("/trace"), HTTP_GET, getTrace);
+  server.on(F("/debug/tasks"), HTTP_GET, getTasks);
+  server.onBody(F("/debug/tasks/sample"), HTTP_POST, setTaskSampling);
+  server.on(F("/calibration"), HTTP_GET, getCalibration);
+  server.onBody(F("/calibration"), HTTP_POST, setCalibration);
 }
 
 void handleNotFound()
@@ -232,23 +647,84 @@ void Task_WebServer(void *pvParameters)
   vTaskDelete( NULL );
 }
 
-void Task_Ping(void *pvParameters)
+void Task_EventStream(void *pvParameters)
 {
-  const IPAddress remote_ip(10, 175, 1, 1);
   (void)pvParameters;
-  Serial.println("Ping task: Start");
+  Serial.println("Event stream task: Start");
   while (1)
   {
-    if (Ping.ping(remote_ip))
-    {
-      Serial.println("PING: Ok");
-    }
-    else
-    {
-      Serial.println("Error :(");
-      ESP.restart();
-    }
-    vTaskDelay(60000 / portTICK_PERIOD_MS);
+    events.loop();
+    vTaskDelay(10 / portTICK_PERIOD_MS);
+  }
+  vTaskDelete( NULL );
+}
+
+void Task_Rigctl(void *pvParameters)
+{
+  (void)pvParameters;
+  Serial.println("Rigctl task: Start");
+  while (1)
+  {
+    rigctl.loop();
+    vTaskDelay(5 / portTICK_PERIOD_MS);
+  }
+  vTaskDelete( NULL );
+}
+
+void Task_Inputs(void *pvParameters)
+{
+  (void)pvParameters;
+  Serial.println("Inputs task: Start");
+  inputs.begin();
+  while (1)
+  {
+    inputs.loop();
+  }
+  vTaskDelete( NULL );
+}
+
+void Task_UdpControl(void *pvParameters)
+{
+  (void)pvParameters;
+  Serial.println("UDP control task: Start");
+  while (1)
+  {
+    udpControl.loop();
+    vTaskDelay(1);
+  }
+  vTaskDelete( NULL );
+}
+
+void Task_SerialControl(void *pvParameters)
+{
+  (void)pvParameters;
+  Serial.println("Serial control task: Start");
+  while (1)
+  {
+    serialControl.loop();
+    vTaskDelay(1);
+  }
+  vTaskDelete( NULL );
+}
+
+void Task_Motion(void *pvParameters)
+{
+  (void)pvParameters;
+  Serial.println("Motion task: Start");
+  while (1)
+  {
+    motion.loop();
+  }
+  vTaskDelete( NULL );
+}
+
+void Task_Connectivity(void *pvParameters)
+{
+  (void)pvParameters;
+  Serial.println("Connectivity task: Start");
+  while (1)
+  {
+    connectivity.loop();
   }
   vTaskDelete( NULL );
 }
@@ -260,6 +736,12 @@ void Task_HEARTBEAT(void *pvParameters)
   while (1)
   {
     led.flash(RGBLed::CYAN, 20);
+    motion.checkpoint();
+    if (profiler.sampling())
+    {
+      // Tasks may come and go between two reads of /tasks
+      profiler.reclaim();
+    }
     vTaskDelay(2500 / portTICK_PERIOD_MS);
   }
   vTaskDelete( NULL );
@@ -267,7 +749,8 @@ void Task_HEARTBEAT(void *pvParameters)
 
 void initHardware()
 {
-  pinMode(ENDSTOP, INPUT);
+  endstopInput = inputs.add(ENDSTOP, INPUT, TM_BUTTON * 1000);
+  inputs.subscribe(endstopInput, onEndstop);
   pinMode(PIN_WHITE, OUTPUT);
   pinMode(PIN_YELLOW, OUTPUT);
   led.brightness(RGBLed::YELLOW, 25);
@@ -278,43 +761,104 @@ void initHardware()
   Serial.println("Hardware: initialized");
 }
 
-void initStepperDriver()
+void initStepper(A4988 &stepper)
 {
   stepper.begin(RPM, MICROSTEPS);
   stepper.setEnableActiveState(LOW);
   stepper.setSpeedProfile(stepper.LINEAR_SPEED, MOTOR_ACCEL, MOTOR_DECEL);
   stepper.setMicrostep(16);
-  Serial.println("Stepper: initialized");
+}
+
+void initStepperDriver()
+{
+  initStepper(stepper);
+  for (int i = 0; i < MOTOR_AXES - 1; i++)
+  {
+    extraAxes[i] = new ExtraAxis(axisConfig[i]);
+    initStepper(extraAxes[i]->stepper);
+  }
+  Serial.printf("Stepper: initialized, %d axes\n", MOTOR_AXES);
+}
+
+void initPositionStore()
+{
+  positionBackend.begin();
+  if (positionStore.begin())
+  {
+    Serial.printf("Position: restored %ld\n", positionStore.position());
+  }
+  else
+  {
+    Serial.println("Position: unknown, park required");
+  }
+  motion.setLimits(min_step, max_step);
+  for (int i = 0; i < MOTOR_AXES - 1; i++)
+  {
+    ExtraAxis &axis = *extraAxes[i];
+    axis.backend.begin();
+    if (axis.store.begin())
+    {
+      Serial.printf("Position %d: restored %ld\n", i + 1, axis.store.position());
+    }
+    else
+    {
+      Serial.printf("Position %d: unknown\n", i + 1);
+    }
+    int index = motion.addAxis(axis.stepper, axis.store);
+    motion.setLimits(axisConfig[i].min, axisConfig[i].max, index);
+  }
+  motion.begin();
 }
 
 void createTasks()
 {
-  xTaskCreateUniversal(Task_HEARTBEAT, "HEARTBEAT", 1024, NULL, 3, NULL, ARDUINO_RUNNING_CORE);
-  xTaskCreateUniversal(Task_Ping, "Ping", 1024, NULL, 3, NULL, ARDUINO_RUNNING_CORE);
-  xTaskCreateUniversal(Task_WebServer, "WebServer", 4096, NULL, 3, NULL, ARDUINO_RUNNING_CORE);
-  xTaskCreateUniversal(Task_Endstop, "Endstop", 1024, NULL, 5, NULL,1);
+  xTaskCreateUniversal(Task_HEARTBEAT, "HEARTBEAT", 2048, NULL, 3, &tasks[0], ARDUINO_RUNNING_CORE);
+  xTaskCreateUniversal(Task_Connectivity, "Connectivity", 3072, NULL, 3, &tasks[1], ARDUINO_RUNNING_CORE);
+  xTaskCreateUniversal(Task_WebServer, "WebServer", 4096, NULL, 3, &tasks[2], ARDUINO_RUNNING_CORE);
+  xTaskCreateUniversal(Task_Motion, "Motion", 2048, NULL, 3, &tasks[3], ARDUINO_RUNNING_CORE);
+  xTaskCreateUniversal(Task_UdpControl, "UdpControl", 3072, NULL, 3, &tasks[4], ARDUINO_RUNNING_CORE);
+  xTaskCreateUniversal(Task_EventStream, "EventStream", 3072, NULL, 3, &tasks[5], ARDUINO_RUNNING_CORE);
+  xTaskCreateUniversal(Task_Rigctl, "Rigctl", 3072, NULL, 3, &tasks[6], ARDUINO_RUNNING_CORE);
+  xTaskCreateUniversal(Task_Inputs, "Inputs", 2048, NULL, 5, &tasks[7], ARDUINO_RUNNING_CORE);
+  xTaskCreateUniversal(Task_SerialControl, "SerialControl", 3072, NULL, 3, &tasks[8], ARDUINO_RUNNING_CORE);
 }
 
 void setup()
 {
   Serial.begin(115200);
   initHardware();
+  bootPhase(BOOT_HARDWARE);
   initStepperDriver();
+  bootPhase(BOOT_STEPPER);
+  initPositionStore();
+  if (!calibration.begin())
+  {
+    Serial.println("Calibration: empty, rigctl frequencies rejected");
+  }
+  bootPhase(BOOT_POSITION);
   WiFi.mode(WIFI_STA);
-  WiFi.begin(AP_SSID, AP_PASS);
-  while (WiFi.status() != WL_CONNECTED)
+  while (WiFi.beginFast(AP_SSID, AP_PASS) != WL_CONNECTED)
   {
     led.flash(RGBLed::YELLOW, 100);
-    delay(500);
   }
-  Serial.printf("Network connected, ip: ");
+  bootPhase(BOOT_WIFI);
+  Serial.printf("Network connected%s, ip: ", WiFi.fastConnected() ? " to cached AP" : "");
   Serial.println(WiFi.localIP());
+  connectivity.begin(AP_SSID, AP_PASS);
   restServerRouting();
   // Set not found response
   server.onNotFound(handleNotFound);
+  server.onRequestComplete(countRequest);
   // Start server
   server.begin();
-  Serial.println("Setup Complete");
+  udpControl.begin(UDP_CONTROL_PORT);
+  events.begin();
+  rigctl.begin(RIGCTL_PORT);
+  profiler.begin();
+  bootPhase(BOOT_SERVER);
+  Serial.printf("Setup Complete: hardware %u, stepper %u, position %u, wifi %u, server %u ms\n",
+                bootPhases[BOOT_HARDWARE], bootPhases[BOOT_STEPPER], bootPhases[BOOT_POSITION],
+                bootPhases[BOOT_WIFI], bootPhases[BOOT_SERVER]);
   createTasks();
 }
 
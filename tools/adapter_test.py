@@ -0,0 +1,202 @@
+#!/usr/bin/env python3
+"""Checks that the HTTP, UDP and serial adapters agree.
+
+Starts the native firmware (`pio run -e native`) and runs the same
+commands through each control channel in turn: a relative move, a move
+past the soft limits and a move with an acceleration that does not fit a
+Command. Each one is reduced to a CommandResult and the distance the
+carriage moved, and the three channels have to give the same answer.
+The frame channels must also refuse the frame types that only the
+firmware may run (CMD_STEP, CMD_PROGRAM, CMD_PARK). Exits nonzero on any
+mismatch. Only the standard library is used.
+
+    tools/adapter_test.py --exec .pio/build/native/program
+"""
+
+import argparse
+import json
+import os
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import urllib.error
+import urllib.request
+
+HTTP_PORT = 8080
+UDP_PORT = 8081
+
+CMD_MOVE, CMD_MOVE_TO, CMD_STATUS, CMD_STEP, CMD_PROGRAM, CMD_PARK = 1, 2, 5, 6, 7, 8
+RESULTS = {0: "ok", 2: "out_of_range", 6: "invalid"}
+
+MAGIC = 0xCA
+COMMAND = struct.Struct("<BBHIiHH")
+STATUS = struct.Struct("<BBBBIiiB3sI")
+MSG_REPLY = 0x81
+IDLE = 0
+
+
+def crc8(data):
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+class Http:
+    name = "http"
+
+    def post(self, body):
+        request = urllib.request.Request("http://127.0.0.1:%d/moves" % HTTP_PORT, json.dumps(body).encode())
+        try:
+            with urllib.request.urlopen(request, timeout=10) as response:
+                return response.status, response.read().decode()
+        except urllib.error.HTTPError as error:
+            return error.code, error.read().decode()
+
+    def position(self):
+        with urllib.request.urlopen("http://127.0.0.1:%d/info" % HTTP_PORT, timeout=5) as response:
+            return json.load(response)["step_count"]
+
+    def run(self, kind, arg, accel=0):
+        body = {"segments": [{"by": arg} if kind == CMD_MOVE else {"to": arg}]}
+        if accel:
+            body["acceleration"] = accel
+        status, text = self.post(body)
+        if status == 200 and json.loads(text)["status"] == "Complete":
+            return 0
+        if status == 400 and "outside" in text:
+            return 2
+        if status == 400 and text.startswith("Acceleration"):
+            return 6
+        raise RuntimeError("http: unexpected answer %d %s" % (status, text))
+
+
+class Frames:
+    """What the UDP and serial channels share: frames and waiting for idle."""
+
+    seq = 1
+
+    def command(self, kind, arg=0, accel=0):
+        Frames.seq += 1
+        reply = self.exchange(COMMAND.pack(MAGIC, kind, 0, Frames.seq, arg, accel, 0))
+        if reply[4] != Frames.seq:
+            raise RuntimeError("%s: reply to seq %d for %d" % (self.name, reply[4], Frames.seq))
+        return reply
+
+    def position(self):
+        while True:
+            reply = self.command(CMD_STATUS)
+            # A move is handed to the motion task, wait until it has run
+            if reply[3] == IDLE and reply[5] == reply[6]:
+                return reply[5]
+            time.sleep(0.01)
+
+    def run(self, kind, arg, accel=0):
+        return self.command(kind, arg, accel)[2]
+
+
+class Udp(Frames):
+    name = "udp"
+
+    def __init__(self):
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.connect(("127.0.0.1", UDP_PORT))
+        self.sock.settimeout(5)
+
+    def exchange(self, frame):
+        self.sock.send(frame)
+        while True:
+            reply = STATUS.unpack(self.sock.recv(64))
+            if reply[1] == MSG_REPLY:
+                return reply
+
+
+class Serial(Frames):
+    name = "serial"
+
+    def __init__(self, process):
+        self.process = process
+        self.buf = bytearray()
+        self.cond = threading.Condition()
+        threading.Thread(target=self._read, daemon=True).start()
+
+    def _read(self):
+        while True:
+            data = os.read(self.process.stdout.fileno(), 4096)
+            if not data:
+                return
+            with self.cond:
+                self.buf += data
+                self.cond.notify()
+
+    def exchange(self, frame):
+        self.process.stdin.write(frame + bytes([crc8(frame)]))
+        self.process.stdin.flush()
+        size = STATUS.size + 1
+        deadline = time.time() + 5
+        with self.cond:
+            while True:
+                # Console text shares the stream, hunt for a frame that passes its CRC
+                start = self.buf.find(MAGIC)
+                while start >= 0 and len(self.buf) - start >= size:
+                    candidate = bytes(self.buf[start:start + size])
+                    if candidate[-1] == crc8(candidate[:-1]):
+                        del self.buf[:start + size]
+                        return STATUS.unpack(candidate[:-1])
+                    start = self.buf.find(MAGIC, start + 1)
+                if not self.cond.wait(deadline - time.time()):
+                    raise RuntimeError("serial: no reply")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--exec", required=True, help="native firmware to start")
+    args = parser.parse_args()
+
+    workdir = tempfile.mkdtemp()
+    env = dict(os.environ, NATIVE_NVS_DIR=os.path.join(workdir, "nvs"), NATIVE_PING_REDIRECT="127.0.0.1")
+    process = subprocess.Popen([os.path.abspath(args.exec)], cwd=workdir, env=env,
+                               stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+    failures = 0
+    try:
+        time.sleep(2)
+        channels = [Http(), Udp(), Serial(process)]
+        cases = [
+            ("move by 400", CMD_MOVE, 400, 0),
+            ("move by -250", CMD_MOVE, -250, 0),
+            ("move to 9000", CMD_MOVE_TO, 9000, 0),
+            ("move by 40 at accel 40000", CMD_MOVE, 40, 40000),
+        ]
+        for label, kind, arg, accel in cases:
+            answers = []
+            for channel in channels:
+                before = channel.position()
+                result = channel.run(kind, arg, accel)
+                answers.append((RESULTS.get(result, result), channel.position() - before))
+            same = all(answer == answers[0] for answer in answers)
+            failures += not same
+            print("%-28s %s %s" % (label, " ".join("%s=%s/%d" % (c.name, a[0], a[1])
+                                                       for c, a in zip(channels, answers)),
+                                   "ok" if same else "MISMATCH"))
+        for channel in channels[1:]:
+            for kind in (CMD_STEP, CMD_PROGRAM, CMD_PARK, 0):
+                before = channel.position()
+                result = channel.run(kind, 100)
+                ok = result == 6 and channel.position() == before
+                failures += not ok
+                print("%-28s %s=%s %s" % ("frame type %d" % kind, channel.name, RESULTS.get(result, result),
+                                          "ok" if ok else "FAILED"))
+    finally:
+        process.kill()
+        process.wait()
+    sys.exit(1 if failures else 0)
+
+
+if __name__ == "__main__":
+    main()
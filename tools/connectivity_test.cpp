@@ -0,0 +1,126 @@
+// connectivity_test.cpp - host test of the network supervisor.
+//
+// Runs Connectivity against the native WiFi and ping stand-ins with the
+// intervals shortened, and takes the link away by creating the file
+// NATIVE_LINK_DOWN names. The supervisor has to escalate one level at a
+// time (probing, reconnecting, reinitializing), come back online once the
+// file is gone and count the outage. Left down, it has to reboot, and the
+// pending position checkpoint must be on flash when it does; that part
+// runs in a child process, since ESP.restart() ends the process.
+// Exits nonzero if any check fails.
+//
+//   g++ -O2 -std=gnu++17 -DARDUINO=10816 -DNATIVE -DCONNECTIVITY_PROBE_INTERVAL=200 -DCONNECTIVITY_BACKOFF_MIN=50 -DCONNECTIVITY_BACKOFF_MAX=400 -Ilib/NativePlatform/src -Iinclude -Ilib/StepperDriver/src tools/connectivity_test.cpp src/Connectivity.cpp src/Motion.cpp src/PositionStore.cpp src/Metrics.cpp src/Trace.cpp lib/StepperDriver/src/*.cpp lib/NativePlatform/src/*.cpp lib/NativePlatform/src/freertos/*.cpp -lpthread -o connectivity_test
+//   ./connectivity_test
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "A4988.h"
+#include "Connectivity.h"
+
+static A4988 stepper(200, 6, 7, 8);
+static NvsPositionBackend backend;
+static PositionStore store(backend);
+static Motion motion(stepper, store);
+static Connectivity connectivity(motion, IPAddress(10, 175, 1, 1));
+
+static std::string linkDown;
+static int failures;
+
+static void check(bool ok, const char *what)
+{
+  printf("%-48s %s\n", what, ok ? "ok" : "FAILED");
+  if (!ok)
+    failures++;
+}
+
+static void supervise()
+{
+  while (true)
+    connectivity.loop();
+}
+
+// Follow the state until it is want, recording every change on the way
+static bool waitFor(Connectivity::State want, std::vector<Connectivity::State> &seen, unsigned long timeout)
+{
+  unsigned long start = millis();
+  while (millis() - start < timeout)
+  {
+    Connectivity::State state = connectivity.state();
+    if (seen.empty() || seen.back() != state)
+      seen.push_back(state);
+    if (state == want)
+      return true;
+    delay(5);
+  }
+  return false;
+}
+
+void setup()
+{
+  char dir[] = "/tmp/connectivity_testXXXXXX";
+  std::string root = mkdtemp(dir);
+  linkDown = root + "/link_down";
+  setenv("NATIVE_NVS_DIR", (root + "/nvs").c_str(), 1);
+  setenv("NATIVE_LINK_DOWN", linkDown.c_str(), 1);
+  // A refused connection answers the probe
+  setenv("NATIVE_PING_REDIRECT", "127.0.0.1", 1);
+
+  backend.begin();
+  store.begin();
+  motion.begin();
+  WiFi.mode(WIFI_STA);
+  WiFi.begin("ssid", "pass");
+  connectivity.begin("ssid", "pass");
+  std::thread(supervise).detach();
+
+  std::vector<Connectivity::State> seen;
+  delay(3 * CONNECTIVITY_PROBE_INTERVAL);
+  check(connectivity.state() == Connectivity::ONLINE && connectivity.outages() == 0, "link up: online");
+
+  FILE *f = fopen(linkDown.c_str(), "w");
+  fclose(f);
+  bool reached = waitFor(Connectivity::REINITIALIZING, seen, 60000);
+  check(reached && seen.size() == 4 && seen[1] == Connectivity::PROBING && seen[2] == Connectivity::RECONNECTING,
+        "link down: probing, reconnecting, reinitializing");
+  check(connectivity.outages() == 1, "one outage counted");
+
+  unlink(linkDown.c_str());
+  unsigned long back = millis();
+  seen.clear();
+  check(waitFor(Connectivity::ONLINE, seen, 30000), "link back: online again");
+  check(connectivity.lastOutage() > 0 && connectivity.meanTimeToRecover() == connectivity.lastOutage(),
+        "recovery time kept");
+  printf("back online %lu ms after the link, outage %u ms\n", millis() - back, connectivity.lastOutage());
+
+  // Left down it reboots; the checkpoint pending from the last move must be written first
+  fflush(stdout);
+  pid_t child = fork();
+  if (child == 0)
+  {
+    // A link of its own, the parent's supervisor keeps running meanwhile
+    linkDown += ".child";
+    setenv("NATIVE_LINK_DOWN", linkDown.c_str(), 1);
+    store.motionStopped(1234);
+    FILE *f = fopen(linkDown.c_str(), "w");
+    fclose(f);
+    std::thread(supervise).detach();
+    delay(120000);
+    _exit(0); // did not reboot
+  }
+  int status;
+  waitpid(child, &status, 0);
+  unlink((linkDown + ".child").c_str());
+  check(WIFEXITED(status) && WEXITSTATUS(status) == 3, "link down for good: reboot");
+  NvsPositionBackend after;
+  after.begin();
+  PositionStore restored(after);
+  check(restored.begin() && restored.position() == 1234, "position flushed before the reboot");
+  exit(failures ? 1 : 0);
+}
+
+void loop() {}
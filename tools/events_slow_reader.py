@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+"""Slow-subscriber check for the controller's /events stream.
+
+Opens two Server-Sent Events subscriptions at the highest rate. One is
+read as it arrives, the other is never read after its headers and has a
+small receive buffer, so its send side fills while moves keep the state
+changing. The live stream must keep receiving events without a gap
+longer than --max-gap the whole time, and the stalled subscriber must
+be dropped (/info event_streams back to 1). Reports the live stream's
+event count and largest gap. Exits nonzero on failure. Only the standard
+library is used.
+
+    tools/events_slow_reader.py --exec .pio/build/native/program
+    tools/events_slow_reader.py --host 192.168.1.50
+"""
+
+import argparse
+import json
+import os
+import socket
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import urllib.request
+
+HTTP_PORT = 8080
+RATE = 50
+
+
+def http(host, path, body=None):
+    data = json.dumps(body).encode() if body is not None else None
+    with urllib.request.urlopen("http://%s:%d%s" % (host, HTTP_PORT, path), data, timeout=30) as response:
+        return json.load(response)
+
+
+def subscribe(host, rcvbuf=None):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    if rcvbuf:
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, rcvbuf)
+    sock.settimeout(10)
+    sock.connect((host, HTTP_PORT))
+    sock.sendall(b"GET /events?rate=%d HTTP/1.1\r\nHost: %s\r\n\r\n" % (RATE, host.encode()))
+    head = b""
+    while b"\r\n\r\n" not in head:
+        chunk = sock.recv(1)
+        if not chunk:
+            raise OSError("closed before the stream headers")
+        head += chunk
+    if not head.startswith(b"HTTP/1.1 200"):
+        raise OSError("refused: %r" % head.split(b"\r\n")[0])
+    return sock
+
+
+def fail(message):
+    print("FAILED: " + message)
+    sys.exit(1)
+
+
+def run(host, seconds, max_gap):
+    live = subscribe(host)
+    stalled = subscribe(host, rcvbuf=1024)
+    if http(host, "/info")["event_streams"] != 2:
+        fail("two subscriptions expected")
+
+    stop = threading.Event()
+
+    dropped_after = []
+
+    # Keep the state changing, well inside the soft limits; the server
+    # answers nothing else during a move, so look for the drop in between
+    def mover():
+        direction = 0
+        while not stop.is_set():
+            http(host, "/move", {"direction": direction, "step": 2000, "acceleration": 2000, "deceleration": 2000})
+            direction ^= 1
+            if not dropped_after and http(host, "/info")["event_streams"] == 1:
+                dropped_after.append(time.time() - start)
+
+    start = last = time.time()
+    thread = threading.Thread(target=mover)
+    thread.start()
+    events = 0
+    gap = 0.0
+    buf = b""
+    try:
+        live.settimeout(max_gap)
+        while time.time() - start < seconds:
+            try:
+                chunk = live.recv(4096)
+            except socket.timeout:
+                fail("live stream silent for %.1f s" % max_gap)
+            if not chunk:
+                fail("live stream closed")
+            now = time.time()
+            buf += chunk
+            while b"\n\n" in buf:
+                event, buf = buf.split(b"\n\n", 1)
+                if event.startswith(b"event: status"):
+                    events += 1
+                    gap = max(gap, now - last)
+                    last = now
+    finally:
+        stop.set()
+        thread.join()
+    if gap > max_gap:
+        fail("live stream gap of %.2f s" % gap)
+    if not dropped_after:
+        fail("stalled subscriber still attached after %d s" % seconds)
+    print("live stream: %d events, largest gap %.3f s; stalled subscriber dropped after %.1f s"
+          % (events, gap, dropped_after[0]))
+    live.close()
+    stalled.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--seconds", type=float, default=30, help="how long to stream")
+    parser.add_argument("--max-gap", type=float, default=1.0, help="longest silence allowed on the live stream")
+    parser.add_argument("--exec", dest="program", help="start this native firmware build for the run")
+    args = parser.parse_args()
+    if not args.program:
+        run(args.host, args.seconds, args.max_gap)
+        return
+    workdir = tempfile.TemporaryDirectory()
+    # A send buffer the size of lwip's, the host's would take minutes to fill
+    env = dict(os.environ, NATIVE_NVS_DIR=os.path.join(workdir.name, "nvs"), NATIVE_PING_REDIRECT="127.0.0.1",
+               NATIVE_TCP_SNDBUF="5744")
+    process = subprocess.Popen([os.path.abspath(args.program)], cwd=workdir.name, env=env,
+                               stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL)
+    try:
+        time.sleep(2)
+        run(args.host, args.seconds, args.max_gap)
+    finally:
+        process.kill()
+        process.wait()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,479 @@
+#!/usr/bin/env python3
+"""Load and latency benchmark for the controller's REST API.
+
+Drives the HTTP API over the network, normally against the firmware built
+with `pio run -e native` on loopback, and reports per scenario:
+throughput, latency percentiles, response status counts, errors, TCP
+segments per response (Linux only) and the firmware heap before and after
+(from /metrics). The report is JSON, on stdout or in --out, so runs can
+be compared against a baseline.
+
+    tools/http_bench.py --exec .pio/build/native/program --out bench.json
+    tools/http_bench.py --host 192.168.1.50 --scenario info_close_c1
+
+Scenarios with moves keep the carriage inside +-3000 steps and never
+touch the endstop, so they are safe on hardware. Only the standard
+library is used.
+"""
+
+import argparse
+import json
+import os
+import random
+import re
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+
+class Response:
+    def __init__(self, status, headers, body, closed):
+        self.status = status
+        self.headers = headers
+        self.body = body
+        self.closed = closed
+
+
+def data_segments_in(sock):
+    """Segments with payload the kernel received on sock, None off Linux."""
+    try:
+        # tcpi_data_segs_in in struct tcp_info, Linux 4.6 and later
+        info = sock.getsockopt(socket.IPPROTO_TCP, socket.TCP_INFO, 160)
+    except (AttributeError, OSError):
+        return None
+    if len(info) < 156:
+        return None
+    return struct.unpack_from("I", info, 152)[0]
+
+
+class Connection:
+    """One HTTP/1.1 connection, reopened on demand."""
+
+    def __init__(self, host, port, timeout):
+        self.host = host
+        self.port = port
+        self.timeout = timeout
+        self.sock = None
+        self.buf = b""
+        self.opened = 0
+        self.connect_ms = []
+        self.segments = 0
+
+    def _open(self):
+        start = time.perf_counter()
+        self.sock = socket.create_connection((self.host, self.port), self.timeout)
+        self.connect_ms.append((time.perf_counter() - start) * 1000.0)
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.buf = b""
+        self.opened += 1
+
+    def close(self):
+        if self.sock:
+            segments = data_segments_in(self.sock)
+            if segments is None:
+                self.segments = None
+            elif self.segments is not None:
+                self.segments += segments
+            self.sock.close()
+        self.sock = None
+
+    def send(self, data):
+        if not self.sock:
+            self._open()
+        self.sock.sendall(data)
+
+    def _fill(self):
+        chunk = self.sock.recv(65536)
+        if not chunk:
+            raise EOFError("connection closed")
+        self.buf += chunk
+
+    def _line(self):
+        while b"\r\n" not in self.buf:
+            self._fill()
+        line, self.buf = self.buf.split(b"\r\n", 1)
+        return line
+
+    def _exact(self, n):
+        while len(self.buf) < n:
+            self._fill()
+        data, self.buf = self.buf[:n], self.buf[n:]
+        return data
+
+    def read_response(self):
+        status_line = self._line()
+        parts = status_line.split(b" ", 2)
+        if len(parts) < 2 or not parts[0].startswith(b"HTTP/"):
+            raise ValueError("bad status line %r" % status_line[:40])
+        status = int(parts[1])
+        headers = {}
+        while True:
+            line = self._line()
+            if not line:
+                break
+            name, _, value = line.partition(b":")
+            headers[name.strip().lower().decode()] = value.strip().decode()
+        if headers.get("transfer-encoding", "").lower() == "chunked":
+            body = b""
+            while True:
+                size = int(self._line().split(b";")[0], 16)
+                if size == 0:
+                    self._line()
+                    break
+                body += self._exact(size)
+                self._line()
+        elif "content-length" in headers:
+            body = self._exact(int(headers["content-length"]))
+        else:
+            body = self.buf
+            try:
+                while True:
+                    self._fill()
+                    body = self.buf
+            except EOFError:
+                pass
+            self.buf = b""
+        closed = headers.get("connection", "").lower() == "close" or "content-length" not in headers and "transfer-encoding" not in headers
+        if closed:
+            self.close()
+        return Response(status, headers, body, closed)
+
+
+def request_bytes(method, path, body=None, keepalive=False):
+    lines = ["%s %s HTTP/1.1" % (method, path), "Host: bench"]
+    lines.append("Connection: %s" % ("keep-alive" if keepalive else "close"))
+    data = b""
+    if body is not None:
+        data = json.dumps(body).encode()
+        lines.append("Content-Type: application/json")
+        lines.append("Content-Length: %d" % len(data))
+    return ("\r\n".join(lines) + "\r\n\r\n").encode() + data
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return None
+    k = (len(sorted_values) - 1) * p / 100.0
+    lo = int(k)
+    hi = min(lo + 1, len(sorted_values) - 1)
+    return sorted_values[lo] + (sorted_values[hi] - sorted_values[lo]) * (k - lo)
+
+
+class Stats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.latencies = []
+        self.status = {}
+        self.errors = {}
+        self.connections = 0
+        self.connect_ms = []
+        self.segments = 0
+
+    def ok(self, latency, status):
+        with self.lock:
+            self.latencies.append(latency)
+            self.status[status] = self.status.get(status, 0) + 1
+
+    def error(self, kind):
+        with self.lock:
+            self.errors[kind] = self.errors.get(kind, 0) + 1
+
+
+def error_kind(exc):
+    if isinstance(exc, socket.timeout):
+        return "timeout"
+    if isinstance(exc, ConnectionRefusedError):
+        return "refused"
+    if isinstance(exc, (ConnectionResetError, BrokenPipeError)):
+        return "reset"
+    if isinstance(exc, EOFError):
+        return "closed"
+    if isinstance(exc, ValueError):
+        return "protocol"
+    return type(exc).__name__
+
+
+def read_metrics(host, port, timeout):
+    """Heap gauges from /metrics, empty when the server does not answer."""
+    conn = Connection(host, port, timeout)
+    try:
+        conn.send(request_bytes("GET", "/metrics"))
+        text = conn.read_response().body.decode(errors="replace")
+    except Exception:
+        return {}
+    finally:
+        conn.close()
+    values = {}
+    for name in ("heap_free_bytes", "heap_min_free_bytes"):
+        m = re.search(r"^%s (\S+)$" % name, text, re.M)
+        if m:
+            values[name] = int(float(m.group(1)))
+    return values
+
+
+# Request makers: (rng, client index) -> (method, path, body)
+
+def info_request(rng, client):
+    return "GET", "/info", None
+
+
+def metrics_request(rng, client):
+    # Chunked, written in many small pieces
+    return "GET", "/metrics", None
+
+
+def mixed_request(rng, client):
+    # One read in five is a short move; the others read state
+    if rng.random() < 0.2:
+        return "POST", "/moves", {"segments": [{"to": rng.randint(-3000, 3000)}]}
+    return "GET", "/info", None
+
+
+MALFORMED = [
+    b"garbage\r\n\r\n",
+    b"GET /info\r\n\r\n",
+    b"GET /info HTTP/1.1\r\nHost: bench\r\nX-Long: " + b"a" * 8192 + b"\r\n\r\n",
+    b"POST /moves HTTP/1.1\r\nHost: bench\r\nContent-Type: application/json\r\nContent-Length: 40\r\n\r\n{\"segm",
+    b"POST /moves HTTP/1.1\r\nHost: bench\r\nContent-Type: application/json\r\nContent-Length: 8\r\n\r\n{\"a\": [}",
+    b"POST /moves HTTP/1.1\r\nHost: bench\r\nContent-Type: application/json\r\nContent-Length: 2\r\n\r\n{}",
+    b"GET /nowhere HTTP/1.1\r\nHost: bench\r\n\r\n",
+    b"\r\n\r\n",
+]
+
+
+def run_client(args, stats, deadline, make, keepalive, seed, client):
+    rng = random.Random(seed)
+    conn = Connection(args.host, args.port, args.timeout)
+    while time.monotonic() < deadline:
+        method, path, body = make(rng, client)
+        start = time.perf_counter()
+        try:
+            conn.send(request_bytes(method, path, body, keepalive))
+            response = conn.read_response()
+            stats.ok((time.perf_counter() - start) * 1000.0, response.status)
+        except Exception as exc:  # every failure is a data point
+            stats.error(error_kind(exc))
+            conn.close()
+            time.sleep(0.01)
+        if not keepalive:
+            conn.close()
+    conn.close()
+    with stats.lock:
+        stats.connections += conn.opened
+        stats.connect_ms.extend(conn.connect_ms)
+        if conn.segments is None or stats.segments is None:
+            stats.segments = None
+        else:
+            stats.segments += conn.segments
+
+
+def run_malformed(args, stats, deadline, make, keepalive, seed, client):
+    rng = random.Random(seed)
+    # The truncated body holds the server for its whole post timeout
+    timeout = max(args.timeout, 15)
+    while time.monotonic() < deadline:
+        payload = rng.choice(MALFORMED)
+        conn = Connection(args.host, args.port, timeout)
+        start = time.perf_counter()
+        try:
+            conn.send(payload)
+            try:
+                conn.sock.shutdown(socket.SHUT_WR)
+            except OSError:
+                pass
+            response = conn.read_response()
+            stats.ok((time.perf_counter() - start) * 1000.0, response.status)
+        except (EOFError, ConnectionResetError):
+            # Dropping the connection is a valid answer to garbage
+            stats.ok((time.perf_counter() - start) * 1000.0, "closed")
+        except Exception as exc:
+            stats.error(error_kind(exc))
+        conn.close()
+        with stats.lock:
+            stats.connections += 1
+
+
+def run_slowloris(args, stats, deadline, make, keepalive, seed, client):
+    """Client 0 trickles a request head a byte at a time; the others are normal."""
+    if client:
+        return run_client(args, stats, deadline, make, keepalive, seed, client)
+    head = request_bytes("GET", "/info")
+    while time.monotonic() < deadline:
+        conn = Connection(args.host, args.port, args.timeout)
+        try:
+            for byte in head[:-2]:
+                if time.monotonic() >= deadline:
+                    break
+                conn.send(bytes([byte]))
+                time.sleep(0.2)
+        except OSError:
+            pass  # the server gave up on us, start over
+        conn.close()
+        with stats.lock:
+            stats.connections += 1
+
+
+def run_mover(args, stop):
+    """Keep the carriage moving between two targets until stop is set."""
+    conn = Connection(args.host, args.port, 30)
+    target = 3000
+    while not stop.is_set():
+        try:
+            conn.send(request_bytes("POST", "/moves", {"segments": [{"to": target}]}))
+            conn.read_response()
+        except Exception:
+            time.sleep(0.1)
+        conn.close()
+        target = -target
+
+
+SCENARIOS = {
+    # name: (runner, request maker, clients, keep-alive, carriage moving)
+    "info_close_c1": (run_client, info_request, 1, False, False),
+    "info_close_c4": (run_client, info_request, 4, False, False),
+    "info_close_c16": (run_client, info_request, 16, False, False),
+    "info_keepalive_c1": (run_client, info_request, 1, True, False),
+    "info_keepalive_c4": (run_client, info_request, 4, True, False),
+    "metrics_keepalive_c1": (run_client, metrics_request, 1, True, False),
+    "mixed_close_c4": (run_client, mixed_request, 4, False, False),
+    "info_moving_c4": (run_client, info_request, 4, False, True),
+    "malformed_c4": (run_malformed, None, 4, False, False),
+    "info_slowloris_c8": (run_slowloris, info_request, 8, False, False),
+}
+
+
+def run_scenario(args, name):
+    runner, make, clients, keepalive, moving = SCENARIOS[name]
+    stats = Stats()
+    before = read_metrics(args.host, args.port, args.timeout)
+    stop = threading.Event()
+    mover = None
+    if moving:
+        mover = threading.Thread(target=run_mover, args=(args, stop), daemon=True)
+        mover.start()
+        time.sleep(0.2)
+    started = time.monotonic()
+    deadline = started + args.duration
+    threads = [threading.Thread(target=runner, args=(args, stats, deadline, make, keepalive, args.seed + i, i))
+               for i in range(clients)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    elapsed = time.monotonic() - started
+    stop.set()
+    if mover:
+        mover.join()
+    # A scenario may leave the server busy (slow clients, long moves)
+    after = read_metrics(args.host, args.port, max(args.timeout, 15))
+
+    latencies = sorted(stats.latencies)
+    connects = sorted(stats.connect_ms)
+    report = {
+        "name": name,
+        "clients": clients,
+        "keepalive": keepalive,
+        "moving": moving,
+        "duration_s": round(elapsed, 3),
+        "requests": len(latencies),
+        "errors": stats.errors,
+        "status": {str(k): v for k, v in sorted(stats.status.items(), key=lambda kv: str(kv[0]))},
+        "connections": stats.connections,
+        "requests_per_connection": round(len(latencies) / stats.connections, 1) if stats.connections else None,
+        "segments_per_response": round(stats.segments / len(latencies), 2) if stats.segments and latencies else None,
+        "throughput_rps": round(len(latencies) / elapsed, 1) if elapsed else 0,
+        "latency_ms": {
+            "mean": round(sum(latencies) / len(latencies), 3) if latencies else None,
+            "p50": percentile(latencies, 50),
+            "p90": percentile(latencies, 90),
+            "p99": percentile(latencies, 99),
+            "max": latencies[-1] if latencies else None,
+        },
+        "connect_ms": {
+            "p50": percentile(connects, 50),
+            "p99": percentile(connects, 99),
+        },
+        "heap": {
+            "free_before": before.get("heap_free_bytes"),
+            "free_after": after.get("heap_free_bytes"),
+            "min_free": after.get("heap_min_free_bytes"),
+        },
+    }
+    for key in ("p50", "p90", "p99", "max"):
+        if report["latency_ms"][key] is not None:
+            report["latency_ms"][key] = round(report["latency_ms"][key], 3)
+    for key in ("p50", "p99"):
+        if report["connect_ms"][key] is not None:
+            report["connect_ms"][key] = round(report["connect_ms"][key], 3)
+    return report
+
+
+def wait_for_port(host, port, timeout):
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        try:
+            socket.create_connection((host, port), 0.5).close()
+            return True
+        except OSError:
+            time.sleep(0.1)
+    return False
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--exec", dest="program", help="start this native firmware build for the run")
+    parser.add_argument("--duration", type=float, default=5.0, help="seconds per scenario")
+    parser.add_argument("--timeout", type=float, default=5.0, help="socket timeout in seconds")
+    parser.add_argument("--scenario", action="append", choices=sorted(SCENARIOS), help="run only these (repeatable)")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--out", help="write the JSON report here instead of stdout")
+    args = parser.parse_args()
+
+    process = None
+    workdir = None
+    if args.program:
+        workdir = tempfile.TemporaryDirectory(prefix="http_bench.")
+        env = dict(os.environ, NATIVE_NVS_DIR=os.path.join(workdir.name, "nvs"), NATIVE_PING_REDIRECT="127.0.0.1")
+        log = open(os.path.join(workdir.name, "firmware.log"), "wb")
+        process = subprocess.Popen([os.path.abspath(args.program)], cwd=workdir.name, env=env,
+                                   stdin=subprocess.DEVNULL, stdout=log, stderr=subprocess.STDOUT)
+    try:
+        if not wait_for_port(args.host, args.port, 15):
+            sys.exit("http_bench: nothing listening on %s:%d" % (args.host, args.port))
+        results = []
+        for name in args.scenario or list(SCENARIOS):
+            result = run_scenario(args, name)
+            lat = result["latency_ms"]
+            print("%-18s %7.1f req/s  p50 %s  p99 %s ms  errors %d" % (
+                name, result["throughput_rps"], lat["p50"], lat["p99"], sum(result["errors"].values())),
+                file=sys.stderr)
+            results.append(result)
+        report = {
+            "target": "%s:%d" % (args.host, args.port),
+            "native": bool(args.program),
+            "started": time.strftime("%Y-%m-%dT%H:%M:%S%z"),
+            "duration_s": args.duration,
+            "scenarios": results,
+        }
+        text = json.dumps(report, indent=2)
+        if args.out:
+            with open(args.out, "w") as f:
+                f.write(text + "\n")
+        else:
+            print(text)
+    finally:
+        if process:
+            process.terminate()
+            process.wait(5)
+        if workdir:
+            workdir.cleanup()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,164 @@
+// http_parser_bench.cpp - host micro-benchmark of the WebServer request parser.
+//
+// Times HTTPRequestParser on captured requests (tools/http_corpus), fed
+// whole and one byte at a time, next to the String-based head parsing that
+// WebServer used before it, and counts heap allocations for each. The
+// String here is the host shim's, so the old figures are indicative only.
+//
+//   g++ -O2 -std=gnu++17 -DNATIVE -Ilib/NativePlatform/src -Ilib/WebServer/src tools/http_parser_bench.cpp lib/WebServer/src/detail/HTTPRequestParser.cpp lib/NativePlatform/src/Stream.cpp lib/NativePlatform/src/WString.cpp lib/NativePlatform/src/Print.cpp -o parser_bench
+//   ./parser_bench tools/http_corpus/*.http
+#include <chrono>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#include "Arduino.h"
+#include "detail/HTTPRequestParser.h"
+
+static unsigned long allocations;
+
+void *operator new(size_t size)
+{
+  allocations++;
+  void *p = malloc(size ? size : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+// Only the clock Stream::timedRead needs; the corpus never makes it wait
+unsigned long millis() { return 0; }
+void delay(uint32_t) {}
+
+class MemoryStream : public Stream
+{
+public:
+  MemoryStream(const std::string &data) : _data(data), _pos(0) {}
+  int available() override { return _data.size() - _pos; }
+  int read() override { return _pos < _data.size() ? (uint8_t)_data[_pos++] : -1; }
+  int peek() override { return _pos < _data.size() ? (uint8_t)_data[_pos] : -1; }
+  size_t write(uint8_t) override { return 0; }
+
+private:
+  const std::string &_data;
+  size_t _pos;
+};
+
+// The request line and header handling of the String-based _parseRequest
+static int legacyParse(const std::string &data)
+{
+  MemoryStream client(data);
+  String req = client.readStringUntil('\r');
+  client.readStringUntil('\n');
+  int addr_start = req.indexOf(' ');
+  int addr_end = req.indexOf(' ', addr_start + 1);
+  if (addr_start == -1 || addr_end == -1)
+    return -1;
+  String methodStr = req.substring(0, addr_start);
+  String url = req.substring(addr_start + 1, addr_end);
+  String versionEnd = req.substring(addr_end + 8);
+  int version = atoi(versionEnd.c_str());
+  String searchStr = "";
+  int hasSearch = url.indexOf('?');
+  if (hasSearch != -1)
+  {
+    searchStr = url.substring(hasSearch + 1);
+    url = url.substring(0, hasSearch);
+  }
+  int contentLength = 0;
+  String host;
+  while (1)
+  {
+    req = client.readStringUntil('\r');
+    client.readStringUntil('\n');
+    if (req == "")
+      break;
+    int headerDiv = req.indexOf(':');
+    if (headerDiv == -1)
+      break;
+    String headerName = req.substring(0, headerDiv);
+    String headerValue = req.substring(headerDiv + 1);
+    headerValue.trim();
+    if (headerName.equalsIgnoreCase("Content-Length"))
+      contentLength = headerValue.toInt();
+    else if (headerName.equalsIgnoreCase("Host"))
+      host = headerValue;
+  }
+  return version + contentLength + url.length() + searchStr.length() + host.length();
+}
+
+static int wholeParse(const std::string &data)
+{
+  HTTPRequestParser parser;
+  if (parser.parse(data.data(), data.size()) != HTTPRequestParser::DONE)
+    return -1;
+  return parser.versionMinor + parser.contentLength + parser.path.len + parser.query.len;
+}
+
+static int bytewiseParse(const std::string &data)
+{
+  HTTPRequestParser parser;
+  for (size_t len = 1; len <= data.size(); len++)
+  {
+    if (parser.parse(data.data(), len) == HTTPRequestParser::DONE)
+      return parser.versionMinor + parser.contentLength + parser.path.len + parser.query.len;
+  }
+  return -1;
+}
+
+struct Result
+{
+  double ns;
+  double allocs;
+};
+
+template <typename F>
+static Result measure(F parse, const std::string &data)
+{
+  const int rounds = 20000;
+  volatile int sink = 0;
+  unsigned long before = allocations;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; i++)
+    sink = sink + parse(data);
+  auto end = std::chrono::steady_clock::now();
+  Result r;
+  r.ns = std::chrono::duration<double, std::nano>(end - start).count() / rounds;
+  r.allocs = (double)(allocations - before) / rounds;
+  return r;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    fprintf(stderr, "usage: %s request.http...\n", argv[0]);
+    return 2;
+  }
+  printf("%-28s %6s %12s %12s %12s %10s %10s\n", "request", "bytes", "parser ns", "bytewise ns", "legacy ns", "allocs", "legacy");
+  for (int i = 1; i < argc; i++)
+  {
+    std::ifstream in(argv[i], std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    std::string data = ss.str();
+    if (wholeParse(data) < 0)
+    {
+      fprintf(stderr, "%s: does not parse\n", argv[i]);
+      return 1;
+    }
+    Result whole = measure(wholeParse, data);
+    Result bytewise = measure(bytewiseParse, data);
+    Result legacy = measure(legacyParse, data);
+    const char *name = strrchr(argv[i], '/') ? strrchr(argv[i], '/') + 1 : argv[i];
+    printf("%-28s %6zu %12.1f %12.1f %12.1f %10.1f %10.1f\n", name, data.size(), whole.ns, bytewise.ns, legacy.ns,
+           whole.allocs, legacy.allocs);
+  }
+  return 0;
+}
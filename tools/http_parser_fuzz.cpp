@@ -0,0 +1,186 @@
+// http_parser_fuzz.cpp - fuzz harness for the WebServer request parser.
+//
+// Each input is parsed whole and again in randomly sized pieces, the way
+// it arrives off a socket; both must agree, and every view must stay inside
+// the head. Built with libFuzzer it is an ordinary fuzz target:
+//
+//   clang++ -g -O1 -fsanitize=fuzzer,address -Ilib/WebServer/src tools/http_parser_fuzz.cpp lib/WebServer/src/detail/HTTPRequestParser.cpp -o parser_fuzz
+//   ./parser_fuzz -max_len=2048 tools/http_corpus
+//
+// Without it, the same file builds a small standalone fuzzer that mutates
+// the seed requests on its own (add -fsanitize=address,undefined to taste):
+//
+//   g++ -g -O1 -DPARSER_FUZZ_MAIN -Ilib/WebServer/src tools/http_parser_fuzz.cpp lib/WebServer/src/detail/HTTPRequestParser.cpp -o parser_fuzz
+//   ./parser_fuzz 200000 tools/http_corpus/*.http
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "detail/HTTPRequestParser.h"
+
+#define CHECK(cond)                                                        \
+  do                                                                       \
+  {                                                                        \
+    if (!(cond))                                                           \
+    {                                                                      \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      abort();                                                             \
+    }                                                                      \
+  } while (0)
+
+static void checkView(const HTTPRequestParser &p, HTTPView v)
+{
+  CHECK((size_t)v.off + v.len <= p.headLength);
+}
+
+static bool sameView(HTTPView a, HTTPView b)
+{
+  return a.off == b.off && a.len == b.len;
+}
+
+static uint32_t seed = 1;
+
+static size_t nextSplit(size_t left)
+{
+  seed = seed * 1103515245 + 12345;
+  return 1 + (seed >> 16) % (left < 64 ? left : 64);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  if (size > 0xffff)
+    return 0;
+  const char *buf = (const char *)data;
+
+  HTTPRequestParser whole;
+  HTTPRequestParser::Result r = whole.parse(buf, size);
+  CHECK(whole.result() == r);
+  // a finished parser stays finished
+  CHECK(whole.parse(buf, size) == r);
+
+  HTTPRequestParser pieces;
+  HTTPRequestParser::Result rp = HTTPRequestParser::INCOMPLETE;
+  seed = size;
+  for (size_t len = 0; len < size && rp == HTTPRequestParser::INCOMPLETE;)
+  {
+    len += nextSplit(size - len);
+    rp = pieces.parse(buf, len);
+  }
+  CHECK(rp == r);
+
+  if (r != HTTPRequestParser::DONE)
+    return 0;
+  CHECK(whole.headLength > 0 && whole.headLength <= size);
+  CHECK(whole.contentLength <= 0x7fffffff);
+  CHECK(whole.headerCount <= HTTP_MAX_HEADERS);
+  CHECK(whole.method.len > 0 && whole.path.len > 0);
+  checkView(whole, whole.method);
+  checkView(whole, whole.path);
+  checkView(whole, whole.query);
+  for (uint8_t i = 0; i < whole.headerCount; i++)
+  {
+    checkView(whole, whole.headers[i].name);
+    checkView(whole, whole.headers[i].value);
+    CHECK(whole.headers[i].name.len > 0);
+  }
+
+  CHECK(pieces.headLength == whole.headLength);
+  CHECK(pieces.contentLength == whole.contentLength);
+  CHECK(pieces.versionMinor == whole.versionMinor);
+  CHECK(pieces.headerCount == whole.headerCount);
+  CHECK(sameView(pieces.method, whole.method));
+  CHECK(sameView(pieces.path, whole.path));
+  CHECK(sameView(pieces.query, whole.query));
+  for (uint8_t i = 0; i < whole.headerCount; i++)
+  {
+    CHECK(sameView(pieces.headers[i].name, whole.headers[i].name));
+    CHECK(sameView(pieces.headers[i].value, whole.headers[i].value));
+  }
+  return 0;
+}
+
+#ifdef PARSER_FUZZ_MAIN
+// Bytes that steer the parser between its states
+static const char interesting[] = " :\r\n\t?/.0123456789\x7f\x00HTTP";
+
+static std::string mutate(const std::string &in, std::mt19937 &rng)
+{
+  std::string s = in;
+  int edits = 1 + rng() % 8;
+  for (int i = 0; i < edits; i++)
+  {
+    size_t at = s.empty() ? 0 : rng() % s.size();
+    switch (rng() % 6)
+    {
+    case 0: // flip a bit
+      if (!s.empty())
+        s[at] ^= 1 << (rng() % 8);
+      break;
+    case 1: // drop a run
+      if (!s.empty())
+        s.erase(at, 1 + rng() % 8);
+      break;
+    case 2: // insert a structural byte
+      s.insert(at, 1, interesting[rng() % (sizeof(interesting) - 1)]);
+      break;
+    case 3: // duplicate a run, e.g. a whole header line
+      if (!s.empty())
+        s.insert(at, s.substr(rng() % s.size(), 1 + rng() % 40));
+      break;
+    case 4: // overwrite with a random byte
+      if (!s.empty())
+        s[at] = (char)rng();
+      break;
+    default: // cut short
+      s.resize(at);
+      break;
+    }
+  }
+  return s;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 3)
+  {
+    fprintf(stderr, "usage: %s iterations seed.http...\n", argv[0]);
+    return 2;
+  }
+  long iterations = atol(argv[1]);
+  std::vector<std::string> seeds;
+  for (int i = 2; i < argc; i++)
+  {
+    std::ifstream in(argv[i], std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    seeds.push_back(ss.str());
+  }
+
+  std::mt19937 rng(12345);
+  long done = 0;
+  for (const std::string &s : seeds)
+  {
+    LLVMFuzzerTestOneInput((const uint8_t *)s.data(), s.size());
+    HTTPRequestParser p;
+    done += p.parse(s.data(), s.size()) == HTTPRequestParser::DONE;
+  }
+  if (done != (long)seeds.size())
+    fprintf(stderr, "warning: %ld of %zu seeds do not parse\n", seeds.size() - done, seeds.size());
+
+  long parsed = 0;
+  for (long i = 0; i < iterations; i++)
+  {
+    std::string s = mutate(seeds[rng() % seeds.size()], rng);
+    LLVMFuzzerTestOneInput((const uint8_t *)s.data(), s.size());
+    HTTPRequestParser p;
+    parsed += p.parse(s.data(), s.size()) == HTTPRequestParser::DONE;
+  }
+  printf("%ld inputs, %ld complete heads, no check failed\n", iterations, parsed);
+  return 0;
+}
+#endif
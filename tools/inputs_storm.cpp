@@ -0,0 +1,142 @@
+// inputs_storm.cpp - edge-storm harness for the debounced inputs.
+//
+// Four pins bounce at once, each driven by its own thread through
+// NativePlant::inject(), so their interrupt routines run concurrently and
+// push into the shared ring together. Every edge has to be accounted
+// for, either popped by the input task or counted as dropped. After each
+// burst, the debounced level and the last level handed to the subscriber
+// have to catch up with the pin within settleMs, and again once the storm
+// is over. Reports the edge rate, drops and the worst
+// interrupt-to-subscriber latency. Exits nonzero if a check fails.
+//
+//   g++ -O2 -std=gnu++17 -DARDUINO=10816 -DNATIVE -Ilib/NativePlatform/src -Iinclude tools/inputs_storm.cpp src/Inputs.cpp src/Metrics.cpp lib/NativePlatform/src/*.cpp lib/NativePlatform/src/freertos/*.cpp -lpthread -o inputs_storm
+//   ./inputs_storm
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Inputs.h"
+#include "Metrics.h"
+#include "NativePlant.h"
+
+static const uint8_t pins[] = {2, 3, 4, 5};
+static const int pinCount = sizeof(pins) / sizeof(pins[0]);
+static const uint32_t debounceUs = 2000;
+static const int bursts = 300;
+static const unsigned long settleMs = 100;
+
+static Inputs inputs;
+static std::atomic<uint8_t> delivered[pinCount];
+static std::atomic<uint32_t> injected;
+static std::atomic<uint32_t> stale; // bursts whose level did not come through
+
+class StringPrint : public Print
+{
+public:
+  size_t write(uint8_t c) override
+  {
+    text += (char)c;
+    return 1;
+  }
+  std::string text;
+};
+
+// A counter's value as /metrics would show it
+static uint32_t metric(const char *name)
+{
+  StringPrint out;
+  Metric::renderAll(out);
+  std::string line = std::string("\n") + name + " ";
+  size_t at = out.text.find(line);
+  return at == std::string::npos ? 0 : strtoul(out.text.c_str() + at + line.size(), NULL, 10);
+}
+
+static void onInput(const InputEvent &event, void *)
+{
+  delivered[event.input] = event.level;
+}
+
+static void run()
+{
+  inputs.begin();
+  while (true)
+    inputs.loop();
+}
+
+static void bounce(int input)
+{
+  std::mt19937 rng(input + 1);
+  uint8_t level = HIGH;
+  for (int b = 0; b < bursts; b++)
+  {
+    int edges = 1 + rng() % 40;
+    for (int e = 0; e < edges; e++)
+    {
+      level = !level;
+      NativePlant::inject(pins[input], level);
+      injected++;
+    }
+    unsigned long start = millis();
+    while ((inputs.level(input) != level || delivered[input] != level) && millis() - start < settleMs)
+      delay(1);
+    if (inputs.level(input) != level || delivered[input] != level)
+      stale++;
+    delayMicroseconds(rng() % (2 * debounceUs));
+  }
+}
+
+void setup()
+{
+  for (int i = 0; i < pinCount; i++)
+  {
+    NativePlant::inject(pins[i], HIGH);
+    int input = inputs.add(pins[i], INPUT, debounceUs);
+    inputs.subscribe(input, onInput);
+    delivered[i] = HIGH;
+  }
+  std::thread(run).detach();
+  delay(10);
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> storm;
+  for (int i = 0; i < pinCount; i++)
+    storm.emplace_back(bounce, i);
+  for (std::thread &t : storm)
+    t.join();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  delay(5 * debounceUs / 1000 + 20);
+
+  int failures = 0;
+  for (int i = 0; i < pinCount; i++)
+  {
+    uint8_t pin = NativePlant::read(pins[i]);
+    if (inputs.level(i) != pin || delivered[i] != pin)
+    {
+      printf("pin %u settled %u, debounced %u, delivered %u FAILED\n", pins[i], pin, inputs.level(i),
+             (uint8_t)delivered[i]);
+      failures++;
+    }
+  }
+  if (stale)
+  {
+    printf("%u of %d bursts left a stale level FAILED\n", stale.load(), pinCount * bursts);
+    failures++;
+  }
+  uint32_t popped = metric("input_edges_total");
+  uint32_t dropped = inputs.dropped();
+  printf("%u edges in %.2f s (%.0f/s), %u popped, %u dropped, max latency %u us\n", injected.load(), seconds,
+         injected / seconds, popped, dropped, inputs.maxLatency());
+  if (popped + dropped != injected)
+  {
+    printf("%u edges unaccounted for FAILED\n", injected - popped - dropped);
+    failures++;
+  }
+  exit(failures ? 1 : 0);
+}
+
+void loop() {}
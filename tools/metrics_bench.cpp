@@ -0,0 +1,137 @@
+// metrics_bench.cpp - host benchmark of the metrics registry.
+//
+// Times the update paths the firmware takes on every request and move
+// (Counter::inc, LabeledCounter::inc over six routes, Histogram::observe),
+// alone and from four threads at once, then the Prometheus render of a
+// registry the size of the firmware's. Counts are checked afterwards, so
+// lost updates fail the run.
+//
+//   g++ -O2 -std=gnu++17 -DARDUINO=10816 -DNATIVE -Ilib/NativePlatform/src -Iinclude tools/metrics_bench.cpp src/Metrics.cpp lib/NativePlatform/src/*.cpp lib/NativePlatform/src/freertos/*.cpp -lpthread -o metrics_bench
+//   ./metrics_bench
+#include <chrono>
+#include <functional>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Metrics.h"
+
+static const uint32_t bounds[] = {50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000};
+
+static Counter counter("bench_counter_total", "Counter under test");
+static LabeledCounter labeled("bench_labeled_total", "Labelled counter under test", "route");
+static Histogram histogram("bench_histogram_microseconds", "Histogram under test", bounds,
+                           sizeof(bounds) / sizeof(bounds[0]));
+
+// Filler so the render covers about as many series as /metrics has
+static Counter fillers[] = {
+    {"bench_filler_a_total", "Filler"}, {"bench_filler_b_total", "Filler"}, {"bench_filler_c_total", "Filler"},
+    {"bench_filler_d_total", "Filler"}, {"bench_filler_e_total", "Filler"}, {"bench_filler_f_total", "Filler"},
+};
+static Histogram fillerHistograms[] = {
+    {"bench_filler_a_microseconds", "Filler", bounds, sizeof(bounds) / sizeof(bounds[0])},
+    {"bench_filler_b_microseconds", "Filler", bounds, sizeof(bounds) / sizeof(bounds[0])},
+    {"bench_filler_c_microseconds", "Filler", bounds, sizeof(bounds) / sizeof(bounds[0])},
+};
+
+static const char *routes[] = {"/info", "/move", "/moves", "/metrics", "/trace", "/park"};
+
+class CountingPrint : public Print
+{
+public:
+  size_t write(uint8_t) override
+  {
+    bytes++;
+    return 1;
+  }
+  size_t write(const uint8_t *, size_t size) override
+  {
+    bytes += size;
+    return size;
+  }
+  size_t bytes = 0;
+};
+
+class StringPrint : public Print
+{
+public:
+  size_t write(uint8_t c) override
+  {
+    text += (char)c;
+    return 1;
+  }
+  std::string text;
+};
+
+static void report(const char *name, int threads, uint64_t ops, std::function<void(uint64_t)> body)
+{
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++)
+    workers.emplace_back(body, ops);
+  for (std::thread &w : workers)
+    w.join();
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  printf("%-28s %2d threads %8.1f ns/op\n", name, threads, ns / (ops * threads));
+}
+
+void setup()
+{
+  const uint64_t ops = 2000000;
+  uint64_t expected = 0;
+  for (int threads : {1, 4})
+  {
+    report("Counter::inc", threads, ops, [](uint64_t n) {
+      for (uint64_t i = 0; i < n; i++)
+        counter.inc();
+    });
+    report("LabeledCounter::inc", threads, ops, [](uint64_t n) {
+      for (uint64_t i = 0; i < n; i++)
+        labeled.inc(routes[i % 6]);
+    });
+    report("Histogram::observe", threads, ops, [](uint64_t n) {
+      for (uint64_t i = 0; i < n; i++)
+        histogram.observe(i % 30000);
+    });
+    expected += ops * threads;
+  }
+  for (Counter &c : fillers)
+    c.inc(7);
+  for (Histogram &h : fillerHistograms)
+    h.observe(300);
+
+  CountingPrint out;
+  const int renders = 2000;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < renders; i++)
+    Metric::renderAll(out);
+  double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  printf("%-28s %8.1f us, %zu bytes\n", "Metric::renderAll", us / renders, out.bytes / renders);
+
+  // Every update has to have landed
+  uint64_t sum = 0;
+  for (uint64_t i = 0; i < ops; i++)
+    sum += i % 30000;
+  sum *= 5; // 1 + 4 threads
+  StringPrint capture;
+  Metric::renderAll(capture);
+  char line[128];
+  int failures = 0;
+  snprintf(line, sizeof(line), "bench_counter_total %" PRIu64 "\n", expected);
+  failures += capture.text.find(line) == std::string::npos;
+  snprintf(line, sizeof(line), "bench_histogram_microseconds_count %" PRIu64 "\n", expected);
+  failures += capture.text.find(line) == std::string::npos;
+  snprintf(line, sizeof(line), "bench_histogram_microseconds_sum %" PRIu64 "\n", sum);
+  failures += capture.text.find(line) == std::string::npos;
+  if (failures)
+  {
+    fprintf(stderr, "updates were lost\n");
+    exit(1);
+  }
+  exit(0);
+}
+
+void loop() {}
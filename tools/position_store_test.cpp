@@ -0,0 +1,173 @@
+// position_store_test.cpp - host test of the position checkpoint ring.
+//
+// Runs PositionStore on the NVS backend, which the native build keeps in
+// files, and cuts the power in the middle of a write: the record being
+// written is left half old, half new, and the store is begun again from
+// what is on "flash". The tear is placed between the dirty marker and the
+// clean record and on the dirty marker itself, on every slot of the ring
+// and at every byte of the record, and the newest record with a valid CRC
+// has to win each time. A dirty marker the backend refuses has to be
+// retried until it lands, so a boot after that does not trust the old
+// clean record. Exits nonzero if any check fails.
+//
+//   g++ -O2 -std=gnu++17 -DARDUINO=10816 -DNATIVE -Ilib/NativePlatform/src -Iinclude tools/position_store_test.cpp src/PositionStore.cpp lib/NativePlatform/src/*.cpp lib/NativePlatform/src/freertos/*.cpp -lpthread -o position_store_test
+//   ./position_store_test
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "PositionStore.h"
+
+static const size_t recordSize = 16; // PositionStore::Record
+
+static int failures;
+static int tornSlot = -1; // where the last power loss hit
+
+static void check(bool ok, const char *what, int slot, int torn)
+{
+  if (!ok)
+  {
+    printf("slot %d, %d bytes written: %s FAILED\n", slot, torn, what);
+    failures++;
+  }
+}
+
+/*
+ * Loses power during the write it is armed for: only the first torn
+ * bytes of the new record reach the slot, the rest is what was there.
+ * Fails the next refuse writes outright, leaving the slot alone.
+ */
+class TearingBackend : public NvsPositionBackend
+{
+public:
+  TearingBackend() : armed(false), torn(0), refuse(0) {}
+  bool write(uint8_t s, const void *data, size_t len) override
+  {
+    if (refuse)
+    {
+      refuse--;
+      return false;
+    }
+    if (!armed)
+      return NvsPositionBackend::write(s, data, len);
+    armed = false;
+    tornSlot = s;
+    uint8_t old[recordSize];
+    if (!NvsPositionBackend::read(s, old, len))
+      return NvsPositionBackend::write(s, data, torn); // a short key reads back as missing
+    memcpy(old, data, torn);
+    NvsPositionBackend::write(s, old, len);
+    return true; // the caller never learns, it is gone
+  }
+  bool armed;
+  size_t torn;
+  int refuse;
+};
+
+struct Boot
+{
+  Boot() : store(backend)
+  {
+    backend.begin();
+    restored = store.begin();
+  }
+  TearingBackend backend;
+  PositionStore store;
+  bool restored;
+};
+
+// A move from wherever the carriage is to position, checkpointed clean
+static void move(PositionStore &store, long from, long position)
+{
+  store.motionStarted(from);
+  store.motionStopped(position);
+  store.flush();
+}
+
+void setup()
+{
+  char dir[] = "/tmp/position_store_testXXXXXX";
+  setenv("NATIVE_NVS_DIR", mkdtemp(dir), 1);
+
+  long position = 0;
+  {
+    Boot boot;
+    check(!boot.restored, "empty store restores nothing", -1, 0);
+    move(boot.store, 0, 100);
+    position = 100;
+  }
+  int tears = 0;
+  // Every tear length, and around the ring many times over; the first
+  // tears land on keys that were never written
+  for (int round = 0; round < 2 * POSITION_STORE_SLOTS; round++)
+  {
+    for (size_t torn = 0; torn < recordSize; torn++)
+    {
+      // Dirty marker written, power lost while writing the clean record
+      {
+        Boot boot;
+        check(boot.restored && boot.store.position() == position, "clean record restores", -1, torn);
+        boot.store.motionStarted(position);
+        boot.store.motionStopped(position + 7);
+        boot.backend.armed = true;
+        boot.backend.torn = torn;
+        boot.store.flush();
+        tears++;
+      }
+      {
+        Boot boot;
+        check(!boot.restored && boot.store.position() == position, "torn clean record leaves the dirty marker newest",
+              tornSlot, torn);
+        // The next checkpoint goes over the torn slot and wins again
+        move(boot.store, position, position + 13);
+        position += 13;
+      }
+      // Power lost while writing the dirty marker: nothing has moved yet
+      {
+        Boot boot;
+        check(boot.restored && boot.store.position() == position, "checkpoint over a torn slot restores", -1, torn);
+        boot.backend.armed = true;
+        boot.backend.torn = torn;
+        boot.store.motionStarted(position);
+        tears++;
+      }
+      {
+        Boot boot;
+        check(boot.restored && boot.store.position() == position, "torn dirty marker leaves the clean record newest",
+              tornSlot, torn);
+        move(boot.store, position, position - 5);
+        position -= 5;
+      }
+    }
+  }
+
+  // The dirty marker is refused: loop() retries it while the move runs
+  {
+    Boot boot;
+    boot.backend.refuse = 1;
+    boot.store.motionStarted(position);
+    boot.store.loop();
+  }
+  {
+    Boot boot;
+    check(!boot.restored, "refused dirty marker retried by loop()", -1, 0);
+    move(boot.store, position, position + 3);
+    position += 3;
+  }
+  // Or the next move's start does, if it comes first
+  {
+    Boot boot;
+    boot.backend.refuse = 1;
+    boot.store.motionStarted(position);
+    boot.store.motionStopped(position + 9);
+    boot.store.motionStarted(position + 9);
+  }
+  {
+    Boot boot;
+    check(!boot.restored, "refused dirty marker retried by the next move", -1, 0);
+  }
+
+  printf("%d torn writes over %d slots, %d failures\n", tears, POSITION_STORE_SLOTS, failures);
+  exit(failures ? 1 : 0);
+}
+
+void loop() {}
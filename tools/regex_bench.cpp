@@ -0,0 +1,152 @@
+/*
+  regex_bench.cpp - host benchmark of UriRegex route matching.
+
+  For route-style patterns, times one request the way UriRegex used to
+  handle it (a std::regex built from the pattern on every call), against
+  a std::regex built once, and against UriRegex as it is now: compiled once
+  into a RegexProgram, or a cached std::regex outside that subset. Before
+  timing it checks RegexProgram against std::regex_search, match and
+  captures, on the requests and on random strings for a set of patterns
+  chosen to make it backtrack.
+
+    g++ -O2 -std=gnu++17 -DNATIVE -Ilib/NativePlatform/src -Ilib/WebServer/src \
+        tools/regex_bench.cpp lib/WebServer/src/detail/RegexProgram.cpp \
+        lib/NativePlatform/src/WString.cpp -o regex_bench
+    ./regex_bench
+*/
+#include <chrono>
+#include <random>
+#include <regex>
+#include <stdio.h>
+#include <string>
+
+#include "uri/UriRegex.h"
+
+struct Route
+{
+  const char *pattern;
+  const char *hit;
+  const char *miss;
+};
+
+static const Route routes[] = {
+    {"^/users/([0-9]+)$", "/users/1234", "/users/12a"},
+    {"^/axis/([0-2])/move$", "/axis/1/move", "/axis/3/move"},
+    {"^/api/v\\d+/items/([^/]+)/?$", "/api/v2/items/widget-7/", "/api/v2/items/a/b"},
+    {"^/files/([\\w.-]+)\\.json$", "/files/run-3.log.json", "/files/run 3.json"},
+    {"/sensor/(\\d+)/(\\w+)", "/x/sensor/12/temp", "/sensor//temp"},
+    {"^/static/.*\\.(css|js)$", "/static/app/main.js", "/static/app/main.ts"},
+};
+
+// Patterns that make the matcher give characters back
+static const char *const tricky[] = {
+    "a*b", "^(a*)(a)$", "([a-c]+)(c)", ".*(\\d)", "(a+)(b?)c", "x.y", "^$", "a?a?a?aaa",
+    "([^/]*)/([^/]*)", "\\w+\\s*\\W", "(a(b*))c", "[-a]+[\\d-]", "[^\\d]+$", "\\.\\*\\+",
+};
+
+static bool agree(const RegexProgram &program, const std::regex &rgx, const std::string &s)
+{
+  size_t captures[2 * REGEX_MAX_GROUPS];
+  bool found = program.search(s.c_str(), s.size(), captures);
+  std::cmatch m;
+  bool expect = std::regex_search(s.c_str(), m, rgx);
+  if (found != expect)
+    return false;
+  for (size_t i = 1; found && i < m.size(); i++)
+  {
+    size_t start = captures[2 * (i - 1)];
+    if (m[i].matched != (start != RegexProgram::npos))
+      return false;
+    if (m[i].matched && (start != (size_t)m.position(i) || captures[2 * (i - 1) + 1] - start != (size_t)m.length(i)))
+      return false;
+  }
+  return true;
+}
+
+static int differential()
+{
+  std::mt19937 rng(7);
+  const char alphabet[] = "ab/c1_.- x9";
+  int checked = 0;
+  for (const char *pattern : tricky)
+  {
+    RegexProgram program;
+    if (!program.compile(pattern))
+    {
+      fprintf(stderr, "%s: expected to compile\n", pattern);
+      return -1;
+    }
+    std::regex rgx(pattern);
+    for (int n = 0; n < 20000; n++)
+    {
+      std::string s;
+      for (size_t len = rng() % 12; len; len--)
+        s += alphabet[rng() % (sizeof(alphabet) - 1)];
+      if (!agree(program, rgx, s))
+      {
+        fprintf(stderr, "%s on \"%s\": differs from std::regex\n", pattern, s.c_str());
+        return -1;
+      }
+      checked++;
+    }
+  }
+  for (const Route &r : routes)
+  {
+    RegexProgram program;
+    if (!program.compile(r.pattern))
+      continue;
+    std::regex rgx(r.pattern);
+    if (!agree(program, rgx, r.hit) || !agree(program, rgx, r.miss))
+    {
+      fprintf(stderr, "%s: differs from std::regex\n", r.pattern);
+      return -1;
+    }
+    checked += 2;
+  }
+  return checked;
+}
+
+template <typename F>
+static double measure(F match, int rounds)
+{
+  volatile int sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; i++)
+    sink = sink + match();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(end - start).count() / rounds;
+}
+
+int main()
+{
+  int checked = differential();
+  if (checked < 0)
+    return 1;
+  printf("%d inputs agree with std::regex\n\n", checked);
+
+  printf("%-32s %-12s %12s %12s %12s\n", "pattern", "engine", "before us", "cached us", "now us");
+  for (const Route &r : routes)
+  {
+    String hit(r.hit);
+    UriRegex uri(r.pattern);
+    std::vector<String> args;
+    uri.initPathArgs(args);
+    RegexProgram probe;
+    const char *engine = probe.compile(r.pattern) ? "program" : "std::regex";
+
+    double before = measure([&]() {
+      std::regex rgx(r.pattern);
+      std::smatch matches;
+      std::string s(hit.c_str());
+      return (int)std::regex_search(s, matches, rgx);
+    }, 2000);
+    std::regex cachedRgx(r.pattern);
+    double cached = measure([&]() {
+      std::cmatch matches;
+      return (int)std::regex_search(hit.c_str(), matches, cachedRgx);
+    }, 100000);
+    double now = measure([&]() { return (int)uri.canHandle(hit, args); }, 100000);
+    printf("%-32s %-12s %12.3f %12.3f %12.3f\n", r.pattern, engine, before, cached, now);
+  }
+  return 0;
+}
@@ -0,0 +1,170 @@
+// response_bench.cpp - host benchmark of WebServer response heads.
+//
+// Sends typical responses through a WebServer whose socket writes are
+// replaced by a counter, and reports per response the CPU time, the heap
+// allocations (operator new, which the host String goes through) and the
+// writes handed to the socket, a gathered writev() counting as one. It
+// only uses the public API, so apart from the sendJson() case it builds
+// against older trees too for a before/after comparison. The host String
+// has a small-string buffer, so allocation counts are indicative only.
+//
+//   g++ -O2 -std=gnu++17 -DARDUINO=10816 -DNATIVE -Ilib/NativePlatform/src -Iinclude -Ilib/ArduinoJson/src -Ilib/WebServer/src tools/response_bench.cpp lib/WebServer/src/*.cpp lib/WebServer/src/detail/*.cpp lib/NativePlatform/src/*.cpp lib/NativePlatform/src/freertos/*.cpp -lpthread -o response_bench
+//   ./response_bench
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/uio.h>
+
+#include <ArduinoJson.h>
+#include "WebServer.h"
+
+static unsigned long allocations;
+
+void *operator new(size_t size)
+{
+  allocations++;
+  void *p = malloc(size ? size : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+class BenchServer : public WebServer
+{
+public:
+  BenchServer() : WebServer(0), writes(0), bytes(0)
+  {
+    _currentVersion = 1;
+    _clientKeepAlive = true;
+  }
+
+  // What the server would do between requests
+  void reset()
+  {
+    _contentLength = CONTENT_LENGTH_NOT_SET;
+    _chunked = false;
+  }
+  void finish() { _finalizeResponse(); }
+
+  unsigned long writes;
+  unsigned long bytes;
+
+protected:
+  size_t _currentClientWrite(const char *b, size_t l) override
+  {
+    (void)b;
+    writes++;
+    bytes += l;
+    return l;
+  }
+  // No override, so older trees without it still build
+  size_t _currentClientWritev(struct iovec *iov, int iovcnt)
+  {
+    size_t l = 0;
+    for (int i = 0; i < iovcnt; i++)
+      l += iov[i].iov_len;
+    writes++;
+    bytes += l;
+    return l;
+  }
+};
+
+// The firmware's /info answer
+static void infoDocument(JsonDocument &doc)
+{
+  doc["status"] = "Ok";
+  doc["step_count"] = 0;
+  doc["endstop"] = 1;
+  doc["motion"] = "idle";
+  doc["position_restored"] = false;
+  JsonObject axis = doc.createNestedArray("axes").createNestedObject();
+  axis["position"] = 0;
+  axis["target"] = 0;
+  axis["min"] = -7000;
+  axis["max"] = 7000;
+  doc["event_streams"] = 0;
+  doc["input_latency_max_us"] = 0;
+  doc["network"] = "online";
+  doc["outages"] = 0;
+  doc["mttr_ms"] = 0;
+  doc["ip"] = "127.0.0.1";
+}
+
+struct Scenario
+{
+  const char *name;
+  void (*respond)(BenchServer &server, const String &body);
+};
+
+static const Scenario scenarios[] = {
+    {"json 200", [](BenchServer &server, const String &body) { server.send(200, "application/json", body); }},
+    {"json doc to String", [](BenchServer &server, const String &body) {
+       (void)body;
+       StaticJsonDocument<512> doc;
+       infoDocument(doc);
+       String buf;
+       serializeJson(doc, buf);
+       server.send(200, "application/json", buf);
+     }},
+    {"json doc sendJson", [](BenchServer &server, const String &body) {
+       (void)body;
+       StaticJsonDocument<512> doc;
+       infoDocument(doc);
+       server.sendJson(200, doc);
+     }},
+    {"json 200 + header", [](BenchServer &server, const String &body) {
+       server.sendHeader("Cache-Control", "no-store");
+       server.send(200, "application/json", body);
+     }},
+    {"text 404", [](BenchServer &server, const String &body) {
+       (void)body;
+       server.send(404, "text/plain", "Not found: /nope");
+     }},
+    {"chunked 3 parts", [](BenchServer &server, const String &body) {
+       server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+       server.send(200, "text/plain", "");
+       for (int i = 0; i < 3; i++)
+         server.sendContent(body.c_str(), 80);
+     }},
+    {"chunked 40 parts", [](BenchServer &server, const String &body) {
+       // the way /metrics streams
+       server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+       server.send(200, "text/plain", "");
+       for (int i = 0; i < 40; i++)
+         server.sendContent(body.c_str(), 150);
+     }},
+};
+
+void setup()
+{
+  // the size of the firmware's /info answer
+  String body;
+  for (int i = 0; i < 245; i++)
+    body += (char)('a' + i % 26);
+
+  printf("%-20s %10s %10s %10s %10s\n", "response", "ns", "allocs", "writes", "bytes");
+  for (const Scenario &s : scenarios)
+  {
+    BenchServer server;
+    const int rounds = 200000;
+    unsigned long before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++)
+    {
+      server.reset();
+      s.respond(server, body);
+      server.finish();
+    }
+    auto end = std::chrono::steady_clock::now();
+    printf("%-20s %10.1f %10.1f %10.1f %10.1f\n", s.name,
+           std::chrono::duration<double, std::nano>(end - start).count() / rounds,
+           (double)(allocations - before) / rounds, (double)server.writes / rounds, (double)server.bytes / rounds);
+  }
+  exit(0);
+}
+
+void loop() {}
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+"""Stand-in rigctld client for the controller's rigctl port.
+
+Talks to the controller the way a Hamlib NET rigctl (model 2) client
+does: the connect handshake (\\chk_vfo, \\dump_state), then short and
+long commands, among them the ones this controller does not implement
+(p, P, _) and split (S), which must each get exactly one well-formed
+answer without the session losing sync. A set_freq has to move the
+carriage to the position interpolated from the calibration table. While
+a second client streams frequencies, the table is replaced over HTTP
+again and again, and every answer must still be RPRT 0 or -1. Exits
+nonzero on the first failure. Only the standard library is used.
+
+    tools/rigctl_client.py --exec .pio/build/native/program
+    tools/rigctl_client.py --host 192.168.1.50
+"""
+
+import argparse
+import json
+import os
+import re
+import socket
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import urllib.request
+
+HTTP_PORT = 8080
+RIGCTL_PORT = 4532
+
+TABLE = [{"freq": 14000000, "position": -1000}, {"freq": 14350000, "position": 2500}]
+OTHER = [{"freq": 14000000, "position": -500}, {"freq": 14350000, "position": 1500}]
+
+# (line sent, answer expected) in the order a client would send them
+SESSION = [
+    ("\\chk_vfo", r"0\n"),
+    ("\\dump_state", r"0\n2\n2\n(.*\n){16}0x0\n"),
+    ("f", r"\d+\n"),
+    ("m", r"USB\n3000\n"),
+    ("v", r"VFOA\n"),
+    ("S 0 VFOA", r"RPRT 0\n"),
+    ("s", r"0\nVFOA\n"),
+    ("p KEYSPD", r"RPRT -4\n"),
+    ("P KEYSPD 20", r"RPRT -4\n"),
+    ("_", r"RPRT -4\n"),
+    ("\\get_info", r"RPRT -4\n"),
+    ("F 13000000", r"RPRT -1\n"),
+    ("F banana", r"RPRT -1\n"),
+    ("\\set_freq 14175000", r"RPRT 0\n"),
+    ("f", r"14175000\n"),
+    ("t", r"0\n"),
+]
+
+
+class Rigctl:
+    def __init__(self, host):
+        self.sock = socket.create_connection((host, RIGCTL_PORT), 5)
+        self.buf = b""
+
+    def ask(self, line, expect):
+        """Send line and read exactly the answer expect describes."""
+        self.sock.sendall(line.encode() + b"\n")
+        pattern = re.compile(expect.encode())
+        deadline = time.time() + 5
+        while True:
+            match = pattern.match(self.buf)
+            if match and match.end() == len(self.buf):
+                self.buf = b""
+                return True
+            if time.time() > deadline:
+                return False
+            self.sock.settimeout(max(deadline - time.time(), 0.01))
+            try:
+                chunk = self.sock.recv(4096)
+            except socket.timeout:
+                continue
+            if not chunk:
+                return False
+            self.buf += chunk
+
+
+def http(host, path, body=None):
+    data = json.dumps(body).encode() if body is not None else None
+    with urllib.request.urlopen("http://%s:%d%s" % (host, HTTP_PORT, path), data, timeout=10) as response:
+        return json.load(response)
+
+
+def wait_position(host, position):
+    deadline = time.time() + 20
+    while time.time() < deadline:
+        if http(host, "/info")["step_count"] == position:
+            return True
+        time.sleep(0.05)
+    return False
+
+
+def fail(message):
+    print("FAILED: " + message)
+    sys.exit(1)
+
+
+def run(host):
+    http(host, "/calibration", {"points": TABLE})
+    rig = Rigctl(host)
+    for line, expect in SESSION:
+        if not rig.ask(line, expect):
+            fail("%r: expected %r, got %r" % (line, expect, rig.buf))
+        print("%-22s ok" % line)
+    # 14175000 is half way through the table
+    if not wait_position(host, 750):
+        fail("set_freq did not reach the interpolated position")
+    print("%-22s ok" % "moved to 750")
+
+    # Replace the table while frequencies stream in on another session
+    stop = threading.Event()
+    answers = {}
+
+    def stream():
+        other = Rigctl(host)
+        step = 0
+        while not stop.is_set():
+            step += 1
+            ok = other.ask("F %d" % (14000000 + step * 7919 % 350000), r"RPRT (0|-1)\n")
+            answers[ok] = answers.get(ok, 0) + 1
+            if not ok:
+                return
+
+    thread = threading.Thread(target=stream)
+    thread.start()
+    for i in range(50):
+        http(host, "/calibration", {"points": OTHER if i % 2 else TABLE})
+    stop.set()
+    thread.join()
+    if answers.get(False):
+        fail("a set_freq got no or a malformed answer during table updates")
+    print("%-22s ok, %d answers" % ("table updates", answers.get(True, 0)))
+
+    if not rig.ask("q", r""):
+        fail("quit")
+    http(host, "/calibration", {"points": TABLE})
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--exec", dest="program", help="start this native firmware build for the run")
+    args = parser.parse_args()
+    if not args.program:
+        run(args.host)
+        return
+    workdir = tempfile.TemporaryDirectory()
+    env = dict(os.environ, NATIVE_NVS_DIR=os.path.join(workdir.name, "nvs"), NATIVE_PING_REDIRECT="127.0.0.1")
+    process = subprocess.Popen([os.path.abspath(args.program)], cwd=workdir.name, env=env,
+                               stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL)
+    try:
+        time.sleep(2)
+        run(args.host)
+    finally:
+        process.kill()
+        process.wait()
+
+
+if __name__ == "__main__":
+    main()
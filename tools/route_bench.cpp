@@ -0,0 +1,197 @@
+/*
+  route_bench.cpp - host benchmark of WebServer request dispatch.
+
+  Registers 5 to 200 routes shaped like a REST API (mostly static paths,
+  some with {} arguments, a few globs) and times finding the
+  handler for each of them, and for a miss, through the compiled
+  RouteTable and through the handler chain it replaced, where every
+  handler is asked canHandle() in turn with the URI copied into it. Both
+  must pick the same handler with the same path arguments. Heap
+  allocations per lookup are counted too.
+
+    g++ -O2 -std=gnu++17 -DNATIVE -Ilib/NativePlatform/src -Ilib/WebServer/src \
+        tools/route_bench.cpp lib/WebServer/src/detail/RouteTable.cpp \
+        lib/NativePlatform/src/WString.cpp -o route_bench
+    ./route_bench
+*/
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "WebServer.h"
+#include "uri/UriBraces.h"
+#include "uri/UriGlob.h"
+
+static unsigned long allocations;
+
+void *operator new(size_t size)
+{
+  allocations++;
+  void *p = malloc(size ? size : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+// Matches the way FunctionRequestHandler does
+class RouteHandler : public RequestHandler
+{
+public:
+  RouteHandler(const Uri &uri, HTTPMethod method) : _uri(uri.clone()), _method(method)
+  {
+    _uri->initPathArgs(pathArgs);
+  }
+  ~RouteHandler() { delete _uri; }
+
+  bool canHandle(HTTPMethod requestMethod, String requestUri) override
+  {
+    if (_method != HTTP_ANY && _method != requestMethod)
+      return false;
+    return _uri->canHandle(requestUri, pathArgs);
+  }
+
+  size_t argCount() const { return pathArgs.size(); }
+
+private:
+  Uri *_uri;
+  HTTPMethod _method;
+};
+
+struct Request
+{
+  HTTPMethod method;
+  String path;
+};
+
+struct Api
+{
+  std::vector<RouteHandler *> handlers;
+  std::vector<Request> requests;
+  RouteTable table;
+
+  ~Api()
+  {
+    for (RouteHandler *h : handlers)
+      delete h;
+  }
+
+  void add(const Uri &uri, HTTPMethod method, const char *request, HTTPMethod requestMethod)
+  {
+    RouteHandler *h = new RouteHandler(uri, method);
+    handlers.push_back(h);
+    table.add(h, &uri, method);
+    requests.push_back({requestMethod, String(request)});
+  }
+};
+
+static void build(Api &api, int routes)
+{
+  char pattern[64], request[64];
+  for (int i = 0; i < routes; i++)
+  {
+    int resource = i / 4;
+    switch (i % 10)
+    {
+    case 3:
+      snprintf(pattern, sizeof(pattern), "/api/r%d/{}/items/{}", resource);
+      snprintf(request, sizeof(request), "/api/r%d/%d/items/x%d", resource, i, i);
+      api.add(UriBraces(pattern), HTTP_GET, request, HTTP_GET);
+      break;
+    case 7:
+      snprintf(pattern, sizeof(pattern), "/static/s%d/*.js", i);
+      snprintf(request, sizeof(request), "/static/s%d/app/main.js", i);
+      api.add(UriGlob(pattern), HTTP_GET, request, HTTP_GET);
+      break;
+    default:
+      snprintf(pattern, sizeof(pattern), "/api/r%d/action%d", resource, i);
+      api.add(Uri(pattern), i % 2 ? HTTP_POST : HTTP_GET, pattern, i % 2 ? HTTP_POST : HTTP_GET);
+      break;
+    }
+  }
+  api.requests.push_back({HTTP_GET, String("/api/r0/none")});
+}
+
+static RequestHandler *chainMatch(Api &api, const Request &r)
+{
+  for (RouteHandler *h : api.handlers)
+  {
+    if (h->canHandle(r.method, r.path))
+      return h;
+  }
+  return nullptr;
+}
+
+// Both must agree on the handler and, for compiled routes, the arguments
+static bool check(Api &api)
+{
+  for (const Request &r : api.requests)
+  {
+    RequestHandler *expect = chainMatch(api, r);
+    RouteMatch m;
+    api.table.match(r.method, r.path, m);
+    if (m.handler != expect)
+    {
+      fprintf(stderr, "%s: table and chain disagree\n", r.path.c_str());
+      return false;
+    }
+    if (m.compiled)
+    {
+      RouteHandler *h = (RouteHandler *)expect;
+      for (size_t i = 0; i < h->argCount(); i++)
+      {
+        String arg = r.path.substring(m.args[i].off, m.args[i].off + m.args[i].len);
+        if (i >= m.argCount || arg != h->pathArg(i))
+        {
+          fprintf(stderr, "%s: argument %zu differs\n", r.path.c_str(), i);
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+template <typename F>
+static double measure(Api &api, F lookup, double &allocs)
+{
+  const int rounds = 200000 / api.requests.size() + 1;
+  volatile uintptr_t sink = 0;
+  unsigned long before = allocations;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; i++)
+  {
+    for (const Request &r : api.requests)
+      sink = sink + (uintptr_t)lookup(r);
+  }
+  auto end = std::chrono::steady_clock::now();
+  double lookups = (double)rounds * api.requests.size();
+  allocs = (allocations - before) / lookups;
+  return std::chrono::duration<double, std::nano>(end - start).count() / lookups;
+}
+
+int main()
+{
+  printf("%6s %12s %12s %8s %12s %12s\n", "routes", "chain ns", "table ns", "speedup", "chain alloc", "table alloc");
+  const int sizes[] = {5, 20, 50, 100, 200};
+  for (int routes : sizes)
+  {
+    Api api;
+    build(api, routes);
+    if (!check(api))
+      return 1;
+    double chainAllocs, tableAllocs;
+    double chain = measure(api, [&](const Request &r) { return chainMatch(api, r); }, chainAllocs);
+    double table = measure(api, [&](const Request &r) {
+      RouteMatch m;
+      api.table.match(r.method, r.path, m);
+      return m.handler;
+    }, tableAllocs);
+    printf("%6d %12.1f %12.1f %7.1fx %12.1f %12.1f\n", routes, chain, table, chain / table, chainAllocs, tableAllocs);
+  }
+  return 0;
+}
@@ -0,0 +1,103 @@
+// task_profiler_test.cpp - host test of the profiler's per-task slots.
+//
+// Creates and deletes tasks in waves, many times more than the profiler
+// has slots for, and takes a snapshot after each wave the way /tasks
+// would. The slots of deleted tasks have to be handed back: a task
+// started afterwards must still get a slot, i.e. a CPU share in its
+// profile, and tasks that live through the churn keep theirs. Exits
+// nonzero if any check fails.
+//
+//   g++ -O2 -std=gnu++17 -DARDUINO=10816 -DNATIVE -Ilib/NativePlatform/src -Iinclude -Ilib/StepperDriver/src tools/task_profiler_test.cpp src/TaskProfiler.cpp src/Motion.cpp src/PositionStore.cpp src/Metrics.cpp src/Trace.cpp lib/StepperDriver/src/*.cpp lib/NativePlatform/src/*.cpp lib/NativePlatform/src/freertos/*.cpp -lpthread -o task_profiler_test
+//   ./task_profiler_test
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "A4988.h"
+#include "TaskProfiler.h"
+
+static A4988 stepper(200, 6, 7, 8);
+static NvsPositionBackend backend;
+static PositionStore store(backend);
+static Motion motion(stepper, store);
+static TaskProfiler profiler(motion);
+
+static TaskProfile profiles[PROFILER_MAX_TASKS];
+static std::atomic<int> finished;
+static int failures;
+
+static void check(bool ok, const char *what)
+{
+  printf("%-48s %s\n", what, ok ? "ok" : "FAILED");
+  if (!ok)
+    failures++;
+}
+
+static void shortLived(void *)
+{
+  delay(2);
+  finished++;
+  vTaskDelete(NULL);
+}
+
+static void spin(void *)
+{
+  while (true)
+  {
+  }
+}
+
+static const TaskProfile *find(size_t count, const char *name)
+{
+  for (size_t i = 0; i < count; i++)
+    if (!strcmp(profiles[i].name, name))
+      return &profiles[i];
+  return NULL;
+}
+
+// CPU share of the named task over period ms, as /tasks would show it
+static float cpuOver(const char *name, unsigned long period)
+{
+  profiler.snapshot(profiles, PROFILER_MAX_TASKS);
+  delay(period);
+  size_t count = profiler.snapshot(profiles, PROFILER_MAX_TASKS);
+  const TaskProfile *p = find(count, name);
+  return p ? p->cpu : -1;
+}
+
+void setup()
+{
+  char dir[] = "/tmp/task_profiler_testXXXXXX";
+  setenv("NATIVE_NVS_DIR", mkdtemp(dir), 1);
+  profiler.begin();
+
+  TaskHandle_t survivor;
+  xTaskCreate(spin, "survivor", 2048, NULL, 1, &survivor);
+  check(cpuOver("survivor", 100) > 50, "a busy task shows its CPU share");
+
+  const int waves = 20, perWave = PROFILER_MAX_TASKS / 2;
+  int created = 0;
+  for (int w = 0; w < waves; w++)
+  {
+    for (int i = 0; i < perWave; i++)
+    {
+      char name[16];
+      snprintf(name, sizeof(name), "client%d", created++);
+      xTaskCreate(shortLived, name, 2048, NULL, 1, NULL);
+    }
+    profiler.snapshot(profiles, PROFILER_MAX_TASKS);
+    while (finished < created)
+      delay(1);
+  }
+  printf("%d tasks created and deleted, %d slots\n", created, PROFILER_MAX_TASKS);
+
+  check(cpuOver("survivor", 100) > 50, "a task alive through the churn keeps its slot");
+  xTaskCreate(spin, "latecomer", 2048, NULL, 1, NULL);
+  // survivor still spins and may get half of a single CPU; without a slot
+  // the latecomer's share is 0
+  check(cpuOver("latecomer", 100) > 0, "a task started after the churn gets a slot");
+  exit(failures ? 1 : 0);
+}
+
+void loop() {}
@@ -0,0 +1,184 @@
+// udp_control_test.cpp - host test of the UDP control channel.
+//
+// Runs UdpControl over the real Commands/Motion stack on loopback, the
+// carriage simulated by NativePlant, and plays the part of a client that
+// retransmits: a repeated seq has to be answered from the reply cache
+// without moving again, an older seq with CMD_STALE, and a type that is
+// not a frame type with CMD_INVALID. Reports the latency from sending a
+// CMD_MOVE to the first STEP pulse the simulated carriage sees, and the
+// round-trip latency of CMD_STATUS. Exits nonzero if any check fails.
+//
+//   g++ -O2 -std=gnu++17 -DARDUINO=10816 -DNATIVE -Ilib/NativePlatform/src -Iinclude -Ilib/StepperDriver/src tools/udp_control_test.cpp src/UdpControl.cpp src/ControlFrame.cpp src/Commands.cpp src/Motion.cpp src/PositionStore.cpp src/Metrics.cpp src/Trace.cpp lib/StepperDriver/src/*.cpp lib/NativePlatform/src/*.cpp lib/NativePlatform/src/freertos/*.cpp -lpthread -o udp_control_test
+//   NATIVE_NVS_DIR=$(mktemp -d) ./udp_control_test
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "A4988.h"
+#include "Commands.h"
+#include "NativePlant.h"
+#include "UdpControl.h"
+
+static const int port = 8098;
+
+static A4988 stepper(200, 6, 7, 8);
+static NvsPositionBackend backend;
+static PositionStore store(backend);
+static Motion motion(stepper, store);
+static Commands commands(motion, 10, 6000, 3500);
+static UdpControl control(commands);
+
+static int fd;
+static int failures;
+
+static void check(bool ok, const char *what)
+{
+  printf("%-40s %s\n", what, ok ? "ok" : "FAILED");
+  if (!ok)
+    failures++;
+}
+
+static void send(uint8_t type, uint32_t seq, int32_t arg = 0)
+{
+  ControlCommandFrame frame = {};
+  frame.magic = CONTROL_FRAME_MAGIC;
+  frame.type = type;
+  frame.seq = seq;
+  frame.arg = arg;
+  ::send(fd, &frame, sizeof(frame), 0);
+}
+
+// Next reply, skipping the unsolicited status frames
+static bool reply(ControlStatusFrame &frame)
+{
+  while (recv(fd, &frame, sizeof(frame), 0) == sizeof(frame))
+  {
+    if (frame.type == CONTROL_MSG_REPLY)
+      return true;
+  }
+  return false;
+}
+
+static void report(const char *what, std::vector<double> &us)
+{
+  if (us.empty())
+    return;
+  std::sort(us.begin(), us.end());
+  printf("%s: p50 %.0f us, p99 %.0f us over %zu frames\n", what, us[us.size() / 2], us[us.size() * 99 / 100],
+         us.size());
+}
+
+static void serve()
+{
+  while (true)
+  {
+    control.loop();
+    delay(1);
+  }
+}
+
+static void run()
+{
+  while (true)
+    motion.loop();
+}
+
+void setup()
+{
+  stepper.begin(50, 16);
+  stepper.setEnableActiveState(LOW);
+  stepper.setSpeedProfile(stepper.LINEAR_SPEED, 6000, 3500);
+  backend.begin();
+  store.begin();
+  motion.setLimits(-7000, 7000);
+  motion.begin();
+  control.begin(port);
+  std::thread(serve).detach();
+  std::thread(run).detach();
+
+  fd = socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  connect(fd, (sockaddr *)&addr, sizeof(addr));
+  timeval timeout = {2, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  ControlStatusFrame first, again, frame;
+  send(CMD_MOVE, 10, 100);
+  check(reply(first) && first.seq == 10 && first.result == CMD_OK, "move is answered");
+  send(CMD_MOVE, 10, 100);
+  check(reply(again) && memcmp(&first, &again, sizeof(first)) == 0, "duplicate seq repeats the reply");
+  while (!commands.idle())
+    delay(5);
+  CommandStatus status;
+  commands.status(status);
+  check(status.target == first.target && status.position == first.target, "duplicate seq does not move again");
+
+  send(CMD_MOVE, 9, 100);
+  check(reply(frame) && frame.seq == 9 && frame.result == CMD_STALE, "older seq is stale");
+  send(CMD_MOVE, 10, 100);
+  check(reply(frame) && memcmp(&first, &frame, sizeof(first)) == 0, "stale seq keeps the cached reply");
+  commands.status(status);
+  check(status.target == first.target, "stale seq does not move");
+
+  send(CMD_STEP, 11, 100);
+  check(reply(frame) && frame.seq == 11 && frame.result == CMD_INVALID, "CMD_STEP is not a frame type");
+  send(CMD_PARK, 12);
+  check(reply(frame) && frame.seq == 12 && frame.result == CMD_INVALID, "CMD_PARK is not a frame type");
+  send(0, 13);
+  check(reply(frame) && frame.seq == 13 && frame.result == CMD_INVALID, "type 0 is invalid");
+  send(CMD_STATUS, 11);
+  check(reply(frame) && frame.seq == 11 && frame.result == CMD_OK, "an invalid type does not take the seq");
+
+  // Command to step: short moves back and forth, timed to the first pulse
+  std::vector<double> toStep;
+  for (uint32_t seq = 20; seq < 220; seq++)
+  {
+    unsigned long steps = NativePlant::stepsTaken();
+    auto start = std::chrono::steady_clock::now();
+    send(CMD_MOVE, seq, seq % 2 ? -50 : 50);
+    while (NativePlant::stepsTaken() == steps && std::chrono::steady_clock::now() - start < std::chrono::seconds(1))
+    {
+    }
+    if (NativePlant::stepsTaken() == steps)
+    {
+      check(false, "move reaches the STEP pin");
+      break;
+    }
+    toStep.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    if (!reply(frame) || frame.seq != seq || frame.result != CMD_OK)
+    {
+      check(false, "move is answered");
+      break;
+    }
+    while (!commands.idle())
+      delay(1);
+  }
+
+  std::vector<double> rtt;
+  for (uint32_t seq = 300; seq < 1300; seq++)
+  {
+    auto start = std::chrono::steady_clock::now();
+    send(CMD_STATUS, seq);
+    if (!reply(frame) || frame.seq != seq)
+    {
+      check(false, "status round trip");
+      break;
+    }
+    rtt.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+  }
+  report("move to first step", toStep);
+  report("status round trip", rtt);
+  exit(failures ? 1 : 0);
+}
+
+void loop() {}
@@ -0,0 +1,136 @@
+// upload_bench.cpp - host benchmark of WebServer multipart uploads.
+//
+// Runs a WebServer on loopback and posts multipart forms to it from a
+// second thread: a text field and two files of random bytes, salted with
+// CR LF, "--" and near copies of the boundary, which the parser must pass
+// through as data. Every upload has to arrive unchanged, and the text
+// field has to come through as an argument. Reports the upload rate in
+// MB/s for each file size. It only uses the public API, so it builds
+// against older trees too for a before/after comparison.
+//
+//   g++ -O2 -std=gnu++17 -DARDUINO=10816 -DNATIVE -Ilib/NativePlatform/src -Iinclude -Ilib/WebServer/src tools/upload_bench.cpp lib/WebServer/src/*.cpp lib/WebServer/src/detail/*.cpp lib/NativePlatform/src/*.cpp lib/NativePlatform/src/freertos/*.cpp -lpthread -o upload_bench
+//   ./upload_bench
+#include <arpa/inet.h>
+#include <chrono>
+#include <netinet/in.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "WebServer.h"
+
+static const int port = 8099;
+static const char boundary[] = "----BenchBoundary7MA4YWxkTrZu0gW";
+
+static WebServer server(port);
+static std::vector<std::string> received;
+static String field;
+static bool answered;
+
+static std::string randomFile(size_t size, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::string data;
+  data.reserve(size);
+  const std::string traps[] = {"\r\n", "\r\n--", "\r\n--" + std::string(boundary, sizeof(boundary) - 2), "--", "\r"};
+  while (data.size() < size)
+  {
+    if (rng() % 512 == 0)
+    {
+      data += traps[rng() % 5];
+      data += 'x'; // so a near copy does not become the boundary
+    }
+    else
+      data += (char)rng();
+  }
+  data.resize(size);
+  return data;
+}
+
+static std::string form(const std::string &first, const std::string &second)
+{
+  std::string b = std::string("--") + boundary;
+  std::string body = b + "\r\nContent-Disposition: form-data; name=\"label\"\r\n\r\ncalibration\r\n";
+  body += b + "\r\nContent-Disposition: form-data; name=\"table\"; filename=\"table.bin\"\r\n"
+              "Content-Type: application/octet-stream\r\n\r\n" + first + "\r\n";
+  body += b + "\r\nContent-Disposition: form-data; name=\"image\"; filename=\"image.bin\"\r\n"
+              "Content-Type: application/octet-stream\r\n\r\n" + second + "\r\n";
+  return body + b + "--\r\n";
+}
+
+static void post(const std::string &body)
+{
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0)
+  {
+    perror("connect");
+    exit(1);
+  }
+  std::string request = "POST /upload HTTP/1.1\r\nHost: bench\r\nConnection: close\r\n"
+                        "Content-Type: multipart/form-data; boundary=" + std::string(boundary) + "\r\n"
+                        "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+  for (size_t sent = 0; sent < request.size();)
+  {
+    ssize_t n = send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+    if (n <= 0)
+      break;
+    sent += n;
+  }
+  char buf[512];
+  while (recv(fd, buf, sizeof(buf), 0) > 0)
+  {
+  }
+  close(fd);
+}
+
+void setup()
+{
+  server.on("/upload", HTTP_POST, []() {
+    field = server.arg("label");
+    server.send(200, "text/plain", "ok");
+    answered = true;
+  }, []() {
+    HTTPUpload &upload = server.upload();
+    if (upload.status == UPLOAD_FILE_START)
+      received.emplace_back();
+    else if (upload.status == UPLOAD_FILE_WRITE)
+      received.back().append((const char *)upload.buf, upload.currentSize);
+  });
+  server.begin();
+
+  printf("%10s %10s %10s\n", "file KB", "ms", "MB/s");
+  const size_t sizes[] = {16 << 10, 256 << 10, 1 << 20, 4 << 20};
+  for (size_t size : sizes)
+  {
+    std::string first = randomFile(size, size), second = randomFile(size / 2 + 1, size + 1);
+    std::string body = form(first, second);
+    received.clear();
+    field = "";
+    answered = false;
+    auto start = std::chrono::steady_clock::now();
+    std::thread client(post, body);
+    while (!answered)
+      server.handleClient();
+    auto end = std::chrono::steady_clock::now();
+    client.join();
+    if (received.size() != 2 || received[0] != first || received[1] != second || field != "calibration")
+    {
+      fprintf(stderr, "%zu: upload did not arrive unchanged\n", size);
+      exit(1);
+    }
+    double ms = std::chrono::duration<double, std::milli>(end - start).count();
+    printf("%10zu %10.1f %10.1f\n", size >> 10, ms, body.size() / 1e6 / (ms / 1e3));
+  }
+  exit(0);
+}
+
+void loop() {}